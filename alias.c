@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alias.h"
+#include "arena.h"
+
+// Index being sorted by read_in_aliases() (qsort has no context argument)
+static const struct alias_index *sort_index;
+
+static int compare_alias(const void *a, const void *b)
+{
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    int cmp = strcmp(sort_index->pool + sort_index->key_off[i],
+                     sort_index->pool + sort_index->key_off[j]);
+    if (cmp != 0) return cmp;
+    return i - j;
+}
+
+static const char *alias_key(const void *ctx, int i)
+{
+    const struct alias_index *idx = (const struct alias_index *)ctx;
+    return idx->pool + idx->key_off[i];
+}
+
+static double alias_weight(const void *ctx, int i)
+{
+    const struct alias_index *idx = (const struct alias_index *)ctx;
+    return idx->terms[idx->canon[i]].weight;
+}
+
+static int alias_canon(const void *ctx, int i)
+{
+    return ((const struct alias_index *)ctx)->canon[i];
+}
+
+static void trim_newline(char *s)
+{
+    size_t len = strlen(s);
+    while (len > 0 && (s[len - 1] == '\n' || s[len - 1] == '\r')) {
+        s[--len] = '\0';
+    }
+}
+
+/*
+ * Position of the term equal to s, or -1.
+ * The exact term is the first of the terms that start with s.
+ */
+static int find_term(struct term *terms, int nterms, const char *s)
+{
+    int lo, hi;
+    if (prefix_range(terms, nterms, s, &lo, &hi) == 0 || strcmp(terms[lo].term, s) != 0) {
+        return -1;
+    }
+    return lo;
+}
+
+/*
+ * read_in_aliases():
+ *   - Reads the optional alias section that follows the terms in filename:
+ *       number_of_aliases
+ *       alias1<tab>canonical term1
+ *       ...
+ *   - Resolves every canonical term against the sorted terms array (as
+ *     returned by read_in_terms() for the same file), then sorts the entries.
+ *
+ * Edge cases addressed:
+ *   - No alias section: *idx = NULL, not an error.
+ *   - Malformed lines and unknown canonical terms print a warning and are skipped.
+ */
+void read_in_aliases(struct alias_index **idx, struct term *terms, int nterms, char *filename)
+{
+    read_in_aliases_arena(idx, terms, nterms, NULL, filename);
+}
+
+/*
+ * Copies an index built on the heap into arena, every array at its exact
+ * size (pool_len bytes of aliases). Returns NULL if the arena is out of memory.
+ */
+static struct alias_index *alias_to_arena(const struct alias_index *a, size_t pool_len,
+                                          struct arena *arena)
+{
+    struct alias_index *m = arena_alloc(arena, sizeof(struct alias_index));
+    if (!m) {
+        return NULL;
+    }
+    *m = *a;
+    m->arena = arena;
+    m->pool = arena_alloc(arena, pool_len > 0 ? pool_len : 1);
+    m->key_off = arena_alloc(arena, sizeof(int) * (a->n > 0 ? a->n : 1));
+    m->canon = arena_alloc(arena, sizeof(int) * (a->n > 0 ? a->n : 1));
+    if (!m->pool || !m->key_off || !m->canon) {
+        return NULL;
+    }
+    memcpy(m->pool, a->pool, pool_len);
+    memcpy(m->key_off, a->key_off, sizeof(int) * a->n);
+    memcpy(m->canon, a->canon, sizeof(int) * a->n);
+    return m;
+}
+
+/*
+ * read_in_aliases_arena():
+ *   - read_in_aliases() with the index allocated from arena (malloc if
+ *     NULL). The alias section is read into heap buffers of unknown final
+ *     size, which are copied into the arena once complete.
+ */
+void read_in_aliases_arena(struct alias_index **idx, struct term *terms, int nterms,
+                           struct arena *arena, char *filename)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s\n", filename);
+        return;
+    }
+
+    // Skip the count line and the term lines
+    char line[512];
+    int nlines = 0;
+    if (fscanf(fp, "%d", &nlines) != 1) {
+        fclose(fp);
+        return;
+    }
+    fgetc(fp);
+    for (int i = 0; i < nlines; i++) {
+        if (!fgets(line, sizeof(line), fp)) {
+            fclose(fp);
+            return;
+        }
+    }
+
+    int declared = 0;
+    if (fscanf(fp, "%d", &declared) != 1 || declared <= 0) {
+        fclose(fp);
+        return;
+    }
+    fgetc(fp);
+
+    struct alias_index *a = calloc(1, sizeof(struct alias_index));
+    int *order = malloc(sizeof(int) * declared);
+    int *offsets = malloc(sizeof(int) * declared);
+    if (a) {
+        a->pool = malloc(sizeof(line));
+        a->key_off = malloc(sizeof(int) * declared);
+        a->canon = malloc(sizeof(int) * declared);
+    }
+    if (!a || !order || !offsets || !a->pool || !a->key_off || !a->canon) {
+        fprintf(stderr, "Error: Could not allocate memory for alias index.\n");
+        fclose(fp);
+        free(order);
+        free(offsets);
+        free_alias_index(a);
+        return;
+    }
+    a->terms = terms;
+    a->nterms = nterms;
+
+    size_t used = 0;
+    size_t pool_cap = sizeof(line);
+    for (int i = 0; i < declared; i++) {
+        if (!fgets(line, sizeof(line), fp)) {
+            fprintf(stderr, "Warning: early end of alias section in %s\n", filename);
+            break;
+        }
+        trim_newline(line);
+        char *tab = strchr(line, '\t');
+        if (!tab || tab == line) {
+            fprintf(stderr, "Warning: malformed alias line %d in %s\n", i + 1, filename);
+            continue;
+        }
+        *tab = '\0';
+        int canon = find_term(terms, nterms, tab + 1);
+        if (canon < 0) {
+            fprintf(stderr, "Warning: alias \"%s\" names unknown term \"%s\"\n", line, tab + 1);
+            continue;
+        }
+
+        size_t len = strlen(line);
+        if (used + len + 1 > pool_cap) {
+            char *pool = realloc(a->pool, pool_cap * 2);
+            if (!pool) {
+                fprintf(stderr, "Error: Could not allocate memory for alias index.\n");
+                break;
+            }
+            a->pool = pool;
+            pool_cap *= 2;
+        }
+        memcpy(a->pool + used, line, len + 1);
+        a->key_off[a->n] = (int)used;
+        a->canon[a->n] = canon;
+        order[a->n] = a->n;
+        a->n++;
+        used += len + 1;
+    }
+    fclose(fp);
+
+    // Shrink the pool to what the aliases actually use
+    char *pool = realloc(a->pool, used > 0 ? used : 1);
+    if (pool) {
+        a->pool = pool;
+    }
+
+    sort_index = a;
+    qsort(order, a->n, sizeof(int), compare_alias);
+    sort_index = NULL;
+    int *canon = malloc(sizeof(int) * (a->n > 0 ? a->n : 1));
+    if (!canon) {
+        fprintf(stderr, "Error: Could not allocate memory for alias index.\n");
+        free(order);
+        free(offsets);
+        free_alias_index(a);
+        return;
+    }
+    for (int e = 0; e < a->n; e++) {
+        offsets[e] = a->key_off[order[e]];
+        canon[e] = a->canon[order[e]];
+    }
+    memcpy(a->key_off, offsets, sizeof(int) * a->n);
+    free(a->canon);
+    a->canon = canon;
+    free(order);
+    free(offsets);
+
+    if (arena) {
+        struct alias_index *moved = alias_to_arena(a, used, arena);
+        free_alias_index(a);
+        if (!moved) {
+            fprintf(stderr, "Error: Could not allocate memory for alias index.\n");
+            return;
+        }
+        a = moved;
+    }
+    if (build_range_max_arena(&a->rm, a->n, alias_weight, a, arena) != 0) {
+        free_alias_index(a);
+        return;
+    }
+    *idx = a;
+}
+
+/*
+ * alias_autocomplete():
+ *   - Returns the k heaviest canonical terms that start with substr or have
+ *     an alias starting with substr, best first.
+ *   - A canonical term is reported once however many of its aliases match.
+ *   - rm is the optional range_max of the main array (see autocomplete_top_k()).
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void alias_autocomplete(struct term **answer, int *n_answer, const struct alias_index *idx,
+                        const struct range_max *rm, const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!idx || !substr || substr[0] == '\0' || k <= 0) {
+        return;
+    }
+    if (k > idx->nterms) {
+        k = idx->nterms;
+    }
+
+    int *exact = malloc(sizeof(int) * k);
+    int *alias = malloc(sizeof(int) * k);
+    int *ids = malloc(sizeof(int) * k);
+    if (!exact || !alias || !ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(exact);
+        free(alias);
+        free(ids);
+        return;
+    }
+
+    int nexact = top_k_prefix(idx->terms, idx->nterms, rm, substr, k, exact);
+
+    int nalias = 0;
+    int lo, hi;
+    if (sorted_prefix_range(idx->n, alias_key, idx, substr, &lo, &hi) > 0) {
+        // Ties rank by canonical id, not alias position, as merge_top_k() expects
+        nalias = top_k_ranges_by_id(&idx->rm, &lo, &hi, 1, k, alias_canon, idx, alias);
+        for (int i = 0; i < nalias; i++) {
+            alias[i] = idx->canon[alias[i]];
+        }
+    }
+
+    int count = merge_top_k(idx->terms, exact, nexact, alias, nalias, k, ids);
+    terms_from_ids(answer, n_answer, idx->terms, ids, count);
+    free(exact);
+    free(alias);
+    free(ids);
+}
+
+void free_alias_index(struct alias_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    arena_free(idx->arena, idx->pool);
+    arena_free(idx->arena, idx->key_off);
+    arena_free(idx->arena, idx->canon);
+    free_range_max(&idx->rm);
+    arena_free(idx->arena, idx);
+}
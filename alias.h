@@ -0,0 +1,31 @@
+#if !defined(ALIAS_H)
+#define ALIAS_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * Alias entries ("NYC", "Big Apple") that complete to a canonical term.
+ * An entry is just the alias text plus the canonical term's position: the
+ * canonical string is not duplicated and the weight is read from the term,
+ * so aliases never need their weights kept in sync.
+ */
+typedef struct alias_index{
+    int n;
+    char *pool;          // alias strings, NUL-terminated
+    int *key_off;        // alias of entry i in pool, entries in sorted order
+    int *canon;          // canonical term of entry i
+    struct range_max rm; // best canonical weight over ranges of entries
+    struct term *terms;
+    int nterms;
+    struct arena *arena; // where the index lives, NULL for the heap
+} alias_index;
+
+void read_in_aliases(struct alias_index **idx, struct term *terms, int nterms, char *filename);
+void read_in_aliases_arena(struct alias_index **idx, struct term *terms, int nterms,
+                           struct arena *arena, char *filename);
+void alias_autocomplete(struct term **answer, int *n_answer, const struct alias_index *idx,
+                        const struct range_max *rm, const char *substr, int k);
+void free_alias_index(struct alias_index *idx);
+
+#endif
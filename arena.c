@@ -0,0 +1,247 @@
+#define _GNU_SOURCE   // MAP_ANONYMOUS, MAP_HUGETLB, madvise()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#include "arena.h"
+
+static size_t round_up(size_t n, size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+// Bytes taken by the chunk header, keeping the first allocation aligned.
+#define CHUNK_HEADER round_up(sizeof(struct arena_chunk), ARENA_ALIGN)
+
+/*
+ * arena_init():
+ *   - Starts an empty arena whose chunks hold chunk_size bytes (rounded up
+ *     to ARENA_CHUNK); 0 selects ARENA_CHUNK. Nothing is allocated yet.
+ *   - Chunks are backed as ARENA_HUGE_ADVISE; set a->huge before the first
+ *     allocation to choose another ARENA_HUGE_* mode.
+ */
+void arena_init(struct arena *a, size_t chunk_size)
+{
+    memset(a, 0, sizeof(*a));
+    a->chunk_size = round_up(chunk_size > 0 ? chunk_size : ARENA_CHUNK, ARENA_CHUNK);
+    a->huge = ARENA_HUGE_ADVISE;
+}
+
+/*
+ * hugepage_advise():
+ *   - Asks the kernel to back the whole 2 MB pages inside [p, p + len) with
+ *     transparent huge pages. Returns 0 on success, -1 if the advice was
+ *     refused or is not available on this system; either way the memory
+ *     stays usable.
+ */
+int hugepage_advise(void *p, size_t len)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    uintptr_t start = round_up((uintptr_t)p, ARENA_CHUNK);
+    uintptr_t end = ((uintptr_t)p + len) / ARENA_CHUNK * ARENA_CHUNK;
+    if (end <= start) {
+        return -1;
+    }
+    return madvise((void *)start, end - start, MADV_HUGEPAGE) == 0 ? 0 : -1;
+#else
+    (void)p;
+    (void)len;
+    return -1;
+#endif
+}
+
+/*
+ * Maps bytes (a multiple of ARENA_CHUNK) aligned to ARENA_CHUNK with the
+ * page backing of a->huge. Sets *mapped to 1 for mmap() memory, 0 for the
+ * heap fallback. Returns NULL if out of memory.
+ */
+static void *map_chunk(struct arena *a, size_t bytes, int *mapped)
+{
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+    *mapped = 1;
+#if defined(MAP_HUGETLB)
+    if (a->huge == ARENA_HUGE_EXPLICIT) {
+        void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            a->hugetlb_bytes += bytes;
+            return p;
+        }
+        // No reserved huge pages: fall through to transparent ones
+    }
+#endif
+    // Over-map by one chunk and trim, so the start is 2 MB aligned
+    char *raw = mmap(NULL, bytes + ARENA_CHUNK, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw != MAP_FAILED) {
+        char *p = (char *)round_up((uintptr_t)raw, ARENA_CHUNK);
+        if (p > raw) {
+            munmap(raw, (size_t)(p - raw));
+        }
+        if (raw + ARENA_CHUNK > p) {
+            munmap(p + bytes, (size_t)(raw + ARENA_CHUNK - p));
+        }
+#if defined(MADV_NOHUGEPAGE)
+        if (a->huge == ARENA_HUGE_OFF) {
+            madvise(p, bytes, MADV_NOHUGEPAGE);
+        } else {
+            hugepage_advise(p, bytes);
+        }
+#endif
+        return p;
+    }
+#else
+    (void)a;
+#endif
+    *mapped = 0;
+    void *mem = NULL;
+    return posix_memalign(&mem, ARENA_CHUNK, bytes) == 0 ? mem : NULL;
+}
+
+/*
+ * Adds a chunk able to hold at least size more bytes; requests larger than
+ * the chunk size get a chunk of their own. Returns NULL if out of memory.
+ */
+static struct arena_chunk *add_chunk(struct arena *a, size_t size)
+{
+    size_t bytes = a->chunk_size;
+    if (size + CHUNK_HEADER > bytes) {
+        bytes = round_up(size + CHUNK_HEADER, ARENA_CHUNK);
+    }
+
+    int mapped;
+    struct arena_chunk *c = map_chunk(a, bytes, &mapped);
+    if (!c) {
+        return NULL;
+    }
+    c->mapped = mapped;
+    c->size = bytes;
+    c->used = CHUNK_HEADER;
+    c->next = a->head;
+    a->head = c;
+    a->reserved += bytes;
+    a->nchunks++;
+    return c;
+}
+
+/*
+ * arena_alloc():
+ *   - Returns size bytes aligned to ARENA_ALIGN, valid until
+ *     arena_release(), or NULL if memory is exhausted.
+ *   - With a NULL arena, this is malloc().
+ */
+void *arena_alloc(struct arena *a, size_t size)
+{
+    if (!a) {
+        return malloc(size);
+    }
+    size = round_up(size > 0 ? size : 1, ARENA_ALIGN);
+
+    struct arena_chunk *c = a->head;
+    if (!c || c->size - c->used < size) {
+        c = add_chunk(a, size);
+        if (!c) {
+            return NULL;
+        }
+    }
+    void *p = (char *)c + c->used;
+    c->used += size;
+    return p;
+}
+
+void *arena_calloc(struct arena *a, size_t count, size_t size)
+{
+    if (!a) {
+        return calloc(count, size);
+    }
+    if (size > 0 && count > (size_t)-1 / size) {
+        return NULL;
+    }
+    void *p = arena_alloc(a, count * size);
+    if (p) {
+        memset(p, 0, count * size);
+    }
+    return p;
+}
+
+/*
+ * arena_realloc():
+ *   - Resizes p, which holds old_size bytes. The newest allocation grows or
+ *     shrinks in place when its chunk has room; otherwise the data moves to
+ *     a new block and the old one stays unused until arena_release().
+ *   - With a NULL arena, this is realloc().
+ */
+void *arena_realloc(struct arena *a, void *p, size_t old_size, size_t new_size)
+{
+    if (!a) {
+        return realloc(p, new_size);
+    }
+    if (!p) {
+        return arena_alloc(a, new_size);
+    }
+
+    struct arena_chunk *c = a->head;
+    size_t old_rounded = round_up(old_size > 0 ? old_size : 1, ARENA_ALIGN);
+    size_t new_rounded = round_up(new_size > 0 ? new_size : 1, ARENA_ALIGN);
+    if (c && (char *)p + old_rounded == (char *)c + c->used
+        && c->used - old_rounded + new_rounded <= c->size) {
+        c->used = c->used - old_rounded + new_rounded;
+        return p;
+    }
+
+    void *q = arena_alloc(a, new_size);
+    if (q) {
+        memcpy(q, p, old_size < new_size ? old_size : new_size);
+    }
+    return q;
+}
+
+/*
+ * arena_free():
+ *   - free() for a NULL arena; memory of a real arena is only returned by
+ *     arena_release(), so this does nothing.
+ */
+void arena_free(struct arena *a, void *p)
+{
+    if (!a) {
+        free(p);
+    }
+}
+
+/*
+ * arena_release():
+ *   - Frees every chunk, invalidating all allocations, and leaves the arena
+ *     empty and reusable.
+ */
+void arena_release(struct arena *a)
+{
+    if (!a) {
+        return;
+    }
+    struct arena_chunk *c = a->head;
+    while (c) {
+        struct arena_chunk *next = c->next;
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+        if (c->mapped) {
+            munmap(c, c->size);
+        } else {
+            free(c);
+        }
+#else
+        free(c);
+#endif
+        c = next;
+    }
+    a->head = NULL;
+    a->reserved = 0;
+    a->hugetlb_bytes = 0;
+    a->nchunks = 0;
+}
+
+size_t arena_reserved(const struct arena *a)
+{
+    return a ? a->reserved : 0;
+}
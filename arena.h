@@ -0,0 +1,53 @@
+#if !defined(ARENA_H)
+#define ARENA_H
+
+#include <stddef.h>
+
+// Default chunk size and alignment: one 2 MB huge page.
+#define ARENA_CHUNK ((size_t)2 << 20)
+// Alignment of every allocation.
+#define ARENA_ALIGN 16
+
+// Page backing requested for chunks (Linux; elsewhere chunks are plain heap memory).
+#define ARENA_HUGE_OFF 0       // 4 KB pages, even if transparent huge pages are on
+#define ARENA_HUGE_ADVISE 1    // madvise() transparent huge pages (the default)
+#define ARENA_HUGE_EXPLICIT 2  // MAP_HUGETLB pages, else as ARENA_HUGE_ADVISE
+
+/*
+ * Chunk header; the chunk's allocations follow it.
+ */
+typedef struct arena_chunk{
+    struct arena_chunk *next;
+    size_t size;    // bytes in the chunk, header included
+    size_t used;    // bytes handed out, header included
+    int mapped;     // 1 if from mmap(), 0 if from the heap
+} arena_chunk;
+
+/*
+ * Region allocator for everything that lives as long as one dictionary.
+ * Allocations are bumped out of huge-page-aligned chunks and never freed
+ * one by one: arena_release() returns the whole region in O(chunks), so
+ * reloading a dictionary does not fragment the heap.
+ *
+ * Every function also accepts a NULL arena and then uses the system heap,
+ * so code written against this interface serves both cases.
+ */
+typedef struct arena{
+    struct arena_chunk *head;   // newest chunk, allocations come from it
+    size_t chunk_size;
+    size_t reserved;            // bytes held in chunks
+    int nchunks;
+    int huge;                   // ARENA_HUGE_* mode for new chunks
+    size_t hugetlb_bytes;       // bytes of chunks mapped with MAP_HUGETLB
+} arena;
+
+void arena_init(struct arena *a, size_t chunk_size);
+void *arena_alloc(struct arena *a, size_t size);
+void *arena_calloc(struct arena *a, size_t count, size_t size);
+void *arena_realloc(struct arena *a, void *p, size_t old_size, size_t new_size);
+void arena_free(struct arena *a, void *p);
+void arena_release(struct arena *a);
+size_t arena_reserved(const struct arena *a);
+int hugepage_advise(void *p, size_t len);
+
+#endif
@@ -3,6 +3,9 @@
 #include <string.h>
 #include <ctype.h>
 #include "autocomplete.h"
+#include "topk.h"
+#include "arena.h"
+#include "parallel.h"
 
 /*
  * Helper function to compare two terms lexicographically (ascending).
@@ -44,19 +47,75 @@ static int starts_with(const char *str, const char *prefix)
     return 1;
 }
 
+static char *copy_attr(struct arena *arena, const char *s)
+{
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1])) {
+        len--;
+    }
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+// Term array being ordered by sort_with_attrs() (qsort has no context argument)
+static const struct term *sort_terms;
+
+static int compare_lex_index(const void *a, const void *b)
+{
+    return strcmp(sort_terms[*(const int *)a].term, sort_terms[*(const int *)b].term);
+}
+
 /*
- * read_in_terms():
- *   - Reads the number of terms (first line in the file).
- *   - Allocates memory for that many terms.
- *   - Reads each line into the array, splitting weight from the string.
- *   - Sorts the array in lexicographically ascending order using qsort.
- *
- * Edge cases addressed:
- *   - If the file can't be opened, prints an error and sets *pnterms=0,*terms=NULL.
- *   - If the file format is malformed, attempts to skip or handle as many lines as possible.
+ * Sorts terms lexicographically and applies the same permutation to attrs.
+ * Returns 0 on success, -1 if the scratch memory could not be allocated.
  */
-void read_in_terms(struct term **terms, int *pnterms, char *filename)
+static int sort_with_attrs(struct term **terms, int nterms, char **attrs, struct arena *arena)
+{
+    int *order = malloc(sizeof(int) * nterms);
+    struct term *sorted = arena_alloc(arena, sizeof(struct term) * nterms);
+    char **sorted_attrs = malloc(sizeof(char *) * nterms);
+    if (!order || !sorted || !sorted_attrs) {
+        free(order);
+        arena_free(arena, sorted);
+        free(sorted_attrs);
+        return -1;
+    }
+
+    for (int i = 0; i < nterms; i++) {
+        order[i] = i;
+    }
+    sort_terms = *terms;
+    qsort(order, nterms, sizeof(int), compare_lex_index);
+    sort_terms = NULL;
+
+    for (int i = 0; i < nterms; i++) {
+        sorted[i] = (*terms)[order[i]];
+        sorted_attrs[i] = attrs[order[i]];
+    }
+    memcpy(attrs, sorted_attrs, sizeof(char *) * nterms);
+    arena_free(arena, *terms);
+    *terms = sorted;
+    free(order);
+    free(sorted_attrs);
+    return 0;
+}
+
+/*
+ * Shared by read_in_terms(), read_in_terms_with_attrs() and
+ * read_in_terms_arena(). If attrs is NULL the attribute column is parsed
+ * but dropped. Everything returned comes from arena (malloc if NULL).
+ */
+static void load_terms(struct term **terms, int *pnterms, char ***attrs, struct arena *arena,
+                       char *filename)
 {
+    if (attrs) {
+        *attrs = NULL;
+    }
+
     FILE *fp = fopen(filename, "r");
     if (!fp) {
         fprintf(stderr, "Error: Could not open file %s\n", filename);
@@ -75,18 +134,31 @@ void read_in_terms(struct term **terms, int *pnterms, char *filename)
     }
 
     // Allocate memory for all terms
-    *terms = malloc(sizeof(struct term) * (*pnterms));
+    *terms = arena_alloc(arena, sizeof(struct term) * (*pnterms));
     if (!(*terms)) {
         fprintf(stderr, "Error: Could not allocate memory.\n");
         fclose(fp);
         *pnterms = 0;
         return;
     }
+    if (attrs) {
+        *attrs = arena_calloc(arena, *pnterms, sizeof(char *));
+        if (!(*attrs)) {
+            fprintf(stderr, "Error: Could not allocate memory.\n");
+            fclose(fp);
+            arena_free(arena, *terms);
+            *terms = NULL;
+            *pnterms = 0;
+            return;
+        }
+    }
 
     // Read each term line:
     // Format assumed:  <weight><whitespace><term string (possibly containing spaces)>
     // Example:
     //    13076300   Buenos Aires, Argentina
+    // An optional attribute column may follow the term after a tab:
+    //    13076300   Buenos Aires, Argentina\tAR
     // We use fgets to ensure we read entire lines (safer than fscanf).
     // Then we parse the line with sscanf for the weight and the term string.
 
@@ -122,6 +194,15 @@ void read_in_terms(struct term **terms, int *pnterms, char *filename)
             strcpy(temp_string, "");
         }
 
+        // Split off the optional attribute column
+        char *tab = strchr(temp_string, '\t');
+        if (tab) {
+            *tab = '\0';
+            if (attrs) {
+                (*attrs)[i] = copy_attr(arena, tab + 1);
+            }
+        }
+
         (*terms)[i].weight = weight;
         // Truncate string if needed
         strncpy((*terms)[i].term, temp_string, sizeof((*terms)[i].term) - 1);
@@ -131,7 +212,79 @@ void read_in_terms(struct term **terms, int *pnterms, char *filename)
     fclose(fp);
 
     // Sort the array in lexicographically ascending order
-    qsort(*terms, *pnterms, sizeof(struct term), compare_lex);
+    if (!attrs) {
+        qsort(*terms, *pnterms, sizeof(struct term), compare_lex);
+    } else if (sort_with_attrs(terms, *pnterms, *attrs, arena) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory.\n");
+        if (!arena) {
+            free_attrs(*attrs, *pnterms);
+        }
+        arena_free(arena, *terms);
+        *attrs = NULL;
+        *terms = NULL;
+        *pnterms = 0;
+    }
+}
+
+/*
+ * read_in_terms():
+ *   - Reads the number of terms (first line in the file).
+ *   - Allocates memory for that many terms.
+ *   - Reads each line into the array, splitting weight from the string.
+ *   - Sorts the array in lexicographically ascending order using qsort.
+ *
+ * Edge cases addressed:
+ *   - If the file can't be opened, prints an error and sets *pnterms=0,*terms=NULL.
+ *   - If the file format is malformed, attempts to skip or handle as many lines as possible.
+ *   - An attribute column after a tab is ignored.
+ */
+void read_in_terms(struct term **terms, int *pnterms, char *filename)
+{
+    load_terms(terms, pnterms, NULL, NULL, filename);
+}
+
+/*
+ * read_in_terms_with_attrs():
+ *   - Same as read_in_terms(), and also returns the optional attribute
+ *     column: (*attrs)[i] belongs to (*terms)[i] after sorting, or is NULL
+ *     if that line had no attribute.
+ *   - Release the strings with free_attrs().
+ */
+void read_in_terms_with_attrs(struct term **terms, int *pnterms, char ***attrs, char *filename)
+{
+    load_terms(terms, pnterms, attrs, NULL, filename);
+}
+
+/*
+ * read_in_terms_arena():
+ *   - Same as read_in_terms(), but the term array is allocated from arena
+ *     and released with it rather than with free().
+ */
+void read_in_terms_arena(struct term **terms, int *pnterms, struct arena *arena, char *filename)
+{
+    load_terms(terms, pnterms, NULL, arena, filename);
+}
+
+/*
+ * read_in_terms_with_attrs_arena():
+ *   - read_in_terms_with_attrs() with the terms, the attribute array and
+ *     its strings allocated from arena; do not call free_attrs() on them.
+ */
+void read_in_terms_with_attrs_arena(struct term **terms, int *pnterms, char ***attrs,
+                                    struct arena *arena, char *filename)
+{
+    load_terms(terms, pnterms, attrs, arena, filename);
+}
+
+void free_attrs(char **attrs, int nterms)
+{
+    if (!attrs) {
+        return;
+    }
+    for (int i = 0; i < nterms; i++) {
+        free(attrs[i]);
+    }
+    free(attrs);
 }
 
 /*
@@ -268,3 +421,492 @@ void autocomplete(struct term **answer, int *n_answer, struct term *terms, int n
 
     *n_answer = count;
 }
+
+/*
+ * sorted_prefix_range():
+ *   - Sets [*lo, *hi) to the keys starting with prefix, for any n keys
+ *     sorted in strcmp order and read through key(ctx, i).
+ *   - Returns the number of matching keys (an empty prefix matches all).
+ *
+ * Approach:
+ *   - One fused binary search: probes that miss the prefix narrow both
+ *     bounds at once; the first probe that matches splits the window into
+ *     a lower-bound search on its left and an upper-bound search on its right.
+ */
+int sorted_prefix_range(int n, key_fn key, const void *ctx, const char *prefix, int *lo, int *hi)
+{
+    size_t m = strlen(prefix);
+    int left = 0;
+    int right = n;
+
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        int cmp = strncmp(key(ctx, mid), prefix, m);
+        if (cmp < 0) {
+            left = mid + 1;
+        } else if (cmp > 0) {
+            right = mid;
+        } else {
+            // Everything in [left, mid) is <= prefix, everything in (mid, right) is >= prefix
+            int l = left, r = mid;
+            while (l < r) {
+                int md = l + (r - l) / 2;
+                if (strncmp(key(ctx, md), prefix, m) < 0) l = md + 1;
+                else r = md;
+            }
+            *lo = l;
+
+            l = mid + 1;
+            r = right;
+            while (l < r) {
+                int md = l + (r - l) / 2;
+                if (strncmp(key(ctx, md), prefix, m) == 0) l = md + 1;
+                else r = md;
+            }
+            *hi = l;
+            return *hi - *lo;
+        }
+    }
+
+    *lo = *hi = left;
+    return 0;
+}
+
+static const char *term_key(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].term;
+}
+
+/*
+ * prefix_range():
+ *   - Sets [*lo, *hi) to the terms starting with substr; same matches as
+ *     lowest_match()..highest_match() but in a single fused search.
+ *   - Returns the number of matches. As in autocomplete(), an empty
+ *     substr matches nothing.
+ */
+int prefix_range(struct term *terms, int nterms, const char *substr, int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (!terms || nterms <= 0 || !substr || substr[0] == '\0') {
+        return 0;
+    }
+    return sorted_prefix_range(nterms, term_key, terms, substr, lo, hi);
+}
+
+static double term_weight(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+/*
+ * top_k_prefix():
+ *   - Writes to out[] the positions of the k heaviest terms starting with
+ *     substr, best first, and returns how many were written.
+ *   - If rm (built with build_term_range_max()) is given, the answer costs
+ *     O(k log k) range_max queries however many terms match; otherwise the
+ *     range is scanned once with a bounded heap instead of being sorted,
+ *     split across threads when it is large (top_k_scan_parallel()).
+ */
+int top_k_prefix(struct term *terms, int nterms, const struct range_max *rm,
+                 const char *substr, int k, int *out)
+{
+    int lo, hi;
+    if (prefix_range(terms, nterms, substr, &lo, &hi) == 0 || k <= 0) {
+        return 0;
+    }
+    if (rm) {
+        return top_k_ranges(rm, &lo, &hi, 1, k, NULL, NULL, out);
+    }
+    return top_k_scan_parallel(lo, hi, k, term_weight, terms, out);
+}
+
+/*
+ * autocomplete_top_k():
+ *   - Like autocomplete(), but returns only the k heaviest matches, best
+ *     first, using top_k_prefix() instead of sorting the whole range.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void autocomplete_top_k(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                        const struct range_max *rm, const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = prefix_range(terms, nterms, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = top_k_prefix(terms, nterms, rm, substr, k, ids);
+    terms_from_ids(answer, n_answer, terms, ids, k);
+    free(ids);
+}
+
+/*
+ * autocomplete_scored():
+ *   - Like autocomplete_top_k(), but ranks the matches by score(ctx, i)
+ *     instead of raw weight; each returned term carries its score in the
+ *     weight field.
+ *   - bound(ctx, w) must be an upper bound on the score of any term of
+ *     weight at most w (see top_k_scored()). With rm and bound, the range
+ *     is read in weight order and abandoned once no unread term can reach
+ *     the k-th score; without them every match is scored once.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void autocomplete_scored(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                         const struct range_max *rm, const char *substr, int k,
+                         item_score_fn score, score_bound_fn bound, const void *ctx)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = prefix_range(terms, nterms, substr, &lo, &hi);
+    if (count == 0 || k <= 0 || !score) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    double *scores = malloc(sizeof(double) * k);
+    if (!ids || !scores) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(ids);
+        free(scores);
+        return;
+    }
+    k = top_k_scored(rm, &lo, &hi, 1, k, score, bound, ctx, ids, scores);
+    terms_from_ids(answer, n_answer, terms, ids, k);
+    for (int i = 0; i < *n_answer; i++) {
+        (*answer)[i].weight = scores[i];
+    }
+    free(ids);
+    free(scores);
+}
+
+// FNV-1a hash of a query prefix, which page cursors carry to detect replay
+static unsigned cursor_hash(const char *s)
+{
+    unsigned h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * autocomplete_page():
+ *   - Returns the next page_size matches of substr in descending weight
+ *     order, for "show more" style paging.
+ *   - cursor is NULL or "" for the first page, otherwise the next_cursor of
+ *     the previous page. next_cursor (cursor_cap bytes, PAGE_CURSOR_SIZE
+ *     always suffice) receives the cursor of the following page, or "end"
+ *     once every match has been returned.
+ *   - A cursor holds a hash of substr, the handle of the iterator parked
+ *     in cache, and the weight and position of the last match returned,
+ *     so it is the same size on every page.
+ *   - rm (built with build_term_range_max()) is required. With a cache
+ *     (build_range_iter_cache(), shared by all queries over rm), a page
+ *     continues the previous page's iterator: O(page_size) range_max
+ *     queries however deep the page. Without one, or once the iterator
+ *     was evicted or its cursor replayed, the iterator is rebuilt from
+ *     the cursor at one range_max query per match already returned (see
+ *     range_iter_load()).
+ *
+ * Edge cases:
+ *   - A cursor that is malformed or belongs to another prefix, or a
+ *     next_cursor buffer too small for the cursor, prints an error and
+ *     returns no results.
+ */
+void autocomplete_page(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                       const struct range_max *rm, struct range_iter_cache *cache,
+                       const char *substr, int page_size,
+                       const char *cursor, char *next_cursor, size_t cursor_cap)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (next_cursor && cursor_cap > 0) {
+        next_cursor[0] = '\0';
+    }
+    if (!rm || !next_cursor || page_size <= 0) {
+        fprintf(stderr, "Error: Paging needs a range_max, a cursor buffer and a page size.\n");
+        return;
+    }
+
+    int lo, hi;
+    prefix_range(terms, nterms, substr, &lo, &hi);
+    unsigned hash = cursor_hash(substr);
+
+    range_iter it;
+    int failed;
+    if (!cursor || cursor[0] == '\0') {
+        failed = range_iter_init(&it, rm, &lo, &hi, 1);
+    } else if (strcmp(cursor, "end") == 0) {
+        failed = range_iter_load(&it, rm, cursor, lo, hi);
+    } else {
+        char *rest, *saved = NULL;
+        unsigned long h = strtoul(cursor, &rest, 16);
+        unsigned long handle = *rest == ':' ? strtoul(rest + 1, &saved, 16) : 0;
+        if (rest == cursor || *rest != ':' || h != hash || saved == rest + 1 || *saved != ':') {
+            fprintf(stderr, "Error: Result cursor \"%s\" does not belong to \"%s\".\n",
+                    cursor, substr);
+            return;
+        }
+        failed = range_iter_resume(cache, &it, (unsigned)handle, hash, rm, lo, hi, saved + 1) != 0
+              && range_iter_load(&it, rm, saved + 1, lo, hi) != 0;
+    }
+    if (failed) {
+        return;
+    }
+
+    int *ids = malloc(sizeof(int) * page_size);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        range_iter_free(&it);
+        return;
+    }
+    int count = 0;
+    while (count < page_size) {
+        int id = range_iter_next(&it);
+        if (id < 0) {
+            break;
+        }
+        ids[count++] = id;
+    }
+
+    char state[RANGE_ITER_CURSOR];
+    range_iter_save(&it, state, sizeof(state));
+    int end = strcmp(state, "end") == 0;
+    unsigned handle = end ? 0 : range_iter_park(cache, &it, hash, lo, hi);
+    int len = end ? snprintf(next_cursor, cursor_cap, "end")
+                  : snprintf(next_cursor, cursor_cap, "%08x:%x:%s", hash, handle, state);
+    if ((size_t)len >= cursor_cap) {
+        fprintf(stderr, "Error: Cursor buffer too small (%d bytes needed).\n", len + 1);
+        next_cursor[0] = '\0';
+    } else {
+        terms_from_ids(answer, n_answer, terms, ids, count);
+    }
+    free(ids);
+    range_iter_free(&it);
+}
+
+/*
+ * build_weight_sums():
+ *   - Allocates *sums with nterms + 1 running totals: (*sums)[i] is the
+ *     weight of terms [0, i), so any range's weight is two reads.
+ *   - Totals are accumulated in long double; a range's sum is then exact to
+ *     about one part in 10^15 of the dictionary's total weight.
+ *
+ * Edge cases addressed:
+ *   - On failure prints an error and sets *sums = NULL.
+ */
+void build_weight_sums(double **sums, struct term *terms, int nterms)
+{
+    build_weight_sums_arena(sums, terms, nterms, NULL);
+}
+
+/*
+ * build_weight_sums_arena():
+ *   - build_weight_sums() allocating from arena (malloc if NULL).
+ */
+void build_weight_sums_arena(double **sums, struct term *terms, int nterms, struct arena *arena)
+{
+    *sums = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+    *sums = arena_alloc(arena, sizeof(double) * (nterms + 1));
+    if (!(*sums)) {
+        fprintf(stderr, "Error: Could not allocate memory for weight sums.\n");
+        return;
+    }
+    long double total = 0;
+    (*sums)[0] = 0;
+    for (int i = 0; i < nterms; i++) {
+        total += terms[i].weight;
+        (*sums)[i + 1] = (double)total;
+    }
+}
+
+/*
+ * prefix_stats():
+ *   - Fills *stats with the number of terms starting with substr, their
+ *     total weight and their largest weight (and its position), for match
+ *     counts and cost estimates that do not need the matches themselves.
+ *   - With sums (build_weight_sums()) and rm (build_term_range_max()) it
+ *     costs one fused range search, two reads and one range_max query.
+ *     Either may be NULL, in which case that figure is found by scanning
+ *     the range instead. Never allocates or copies a term.
+ *
+ * Edge cases:
+ *   - No match: count 0, sum 0, best -1 and max_weight 0.
+ */
+void prefix_stats(struct match_stats *stats, struct term *terms, int nterms,
+                  const double *sums, const struct range_max *rm, const char *substr)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->best = -1;
+
+    int lo, hi;
+    stats->count = prefix_range(terms, nterms, substr, &lo, &hi);
+    if (stats->count == 0) {
+        return;
+    }
+
+    if (sums) {
+        stats->weight_sum = sums[hi] - sums[lo];
+    } else {
+        for (int i = lo; i < hi; i++) {
+            stats->weight_sum += terms[i].weight;
+        }
+    }
+
+    if (rm) {
+        stats->best = range_max_query(rm, lo, hi);
+    } else {
+        stats->best = lo;
+        for (int i = lo + 1; i < hi; i++) {
+            if (terms[i].weight > terms[stats->best].weight) {
+                stats->best = i;
+            }
+        }
+    }
+    stats->max_weight = terms[stats->best].weight;
+}
+
+/*
+ * autocomplete_popular():
+ *   - Empty-prefix mode: returns the k heaviest terms of the whole
+ *     dictionary, best first, from the list kept by g (build_global_top()
+ *     over the term range_max). Neither scans nor sorts the terms.
+ *
+ * Edge cases:
+ *   - If k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void autocomplete_popular(struct term **answer, int *n_answer, struct term *terms,
+                          const struct global_top *g, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!terms || !g || k <= 0) {
+        return;
+    }
+    if (k > g->rm->n) {
+        k = g->rm->n;
+    }
+
+    int *ids = malloc(sizeof(int) * (k > 0 ? k : 1));
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = global_top_ids(g, k, ids);
+    terms_from_ids(answer, n_answer, terms, ids, k);
+    free(ids);
+}
+
+typedef struct term_range{
+    int lo, hi;
+} term_range;
+
+static int compare_range_lo(const void *a, const void *b)
+{
+    const struct term_range *x = (const struct term_range *)a;
+    const struct term_range *y = (const struct term_range *)b;
+    if (x->lo != y->lo) return x->lo - y->lo;
+    return y->hi - x->hi;
+}
+
+/*
+ * autocomplete_multi():
+ *   - Returns the k heaviest terms starting with any of the nprefixes
+ *     prefixes, best first, each term once however many prefixes it matches
+ *     (e.g. "the beat" and "beat" from a query rewriter).
+ *
+ * Approach:
+ *   - Each prefix's range comes from prefix_range(); the ranges are sorted
+ *     and merged where they overlap or touch (a prefix of another prefix
+ *     gives a range that contains it), which also removes duplicates.
+ *   - One top_k_ranges() over the merged ranges when rm is given, otherwise
+ *     one bounded-heap scan of them.
+ *
+ * Edge cases:
+ *   - Empty and NULL prefixes match nothing. If nothing matches or k <= 0,
+ *     sets *answer = NULL, *n_answer = 0.
+ */
+void autocomplete_multi(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                        const struct range_max *rm, const char **prefixes, int nprefixes, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!terms || nterms <= 0 || !prefixes || nprefixes <= 0 || k <= 0) {
+        return;
+    }
+
+    struct term_range *ranges = malloc(sizeof(struct term_range) * nprefixes);
+    int *lo = malloc(sizeof(int) * nprefixes);
+    int *hi = malloc(sizeof(int) * nprefixes);
+    if (!ranges || !lo || !hi) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(ranges);
+        free(lo);
+        free(hi);
+        return;
+    }
+
+    int nranges = 0;
+    for (int p = 0; p < nprefixes; p++) {
+        if (prefixes[p] && prefix_range(terms, nterms, prefixes[p],
+                                        &ranges[nranges].lo, &ranges[nranges].hi) > 0) {
+            nranges++;
+        }
+    }
+    qsort(ranges, nranges, sizeof(struct term_range), compare_range_lo);
+
+    int merged = 0, count = 0;
+    for (int r = 0; r < nranges; r++) {
+        if (merged > 0 && ranges[r].lo <= hi[merged - 1]) {
+            if (ranges[r].hi > hi[merged - 1]) {
+                hi[merged - 1] = ranges[r].hi;
+            }
+            continue;
+        }
+        lo[merged] = ranges[r].lo;
+        hi[merged] = ranges[r].hi;
+        merged++;
+    }
+    for (int r = 0; r < merged; r++) {
+        count += hi[r] - lo[r];
+    }
+    free(ranges);
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * (k > 0 ? k : 1));
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+    } else if (k > 0) {
+        k = rm ? top_k_ranges(rm, lo, hi, merged, k, NULL, NULL, ids)
+               : top_k_scan_ranges(lo, hi, merged, k, term_weight, terms, ids);
+        terms_from_ids(answer, n_answer, terms, ids, k);
+    }
+    free(ids);
+    free(lo);
+    free(hi);
+}
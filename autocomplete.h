@@ -1,15 +1,80 @@
 #if !defined(AUTOCOMPLETE_H)
 #define AUTOCOMPLETE_H
 
+#include <stddef.h>
+
 typedef struct term{
     char term[200]; // assume terms are not longer than 200
     double weight;
 } term;
 
+// Bytes that always hold a cursor written by autocomplete_page().
+#define PAGE_CURSOR_SIZE 64
+
+struct range_max;  // see topk.h
+struct global_top; // see topk.h
+struct range_iter_cache; // see topk.h
+struct arena;      // see arena.h
+
+/*
+ * Summary of the terms matching a prefix, see prefix_stats().
+ */
+typedef struct match_stats{
+    int count;          // number of matching terms
+    double weight_sum;  // total weight of the matches
+    double max_weight;  // weight of the heaviest match
+    int best;           // position of the heaviest match, -1 if none
+} match_stats;
+
+/*
+ * Returns the i-th key of a sorted key set; lets one range search serve the
+ * term array and every secondary index that is sorted the same way.
+ */
+typedef const char *(*key_fn)(const void *ctx, int i);
+
+/*
+ * Final ranking score of item i, e.g. its weight times a recency or
+ * user-segment boost. Larger scores rank first.
+ */
+typedef double (*item_score_fn)(const void *ctx, int i);
+
+/*
+ * Upper bound on the score of any item whose range_max value is at most
+ * value (e.g. value times the largest boost). Must not decrease as value
+ * grows; it is what lets scored selection stop before reading every item.
+ */
+typedef double (*score_bound_fn)(const void *ctx, double value);
 
 void read_in_terms(struct term **terms, int *pnterms, char *filename);
+void read_in_terms_with_attrs(struct term **terms, int *pnterms, char ***attrs, char *filename);
+void read_in_terms_arena(struct term **terms, int *pnterms, struct arena *arena, char *filename);
+void read_in_terms_with_attrs_arena(struct term **terms, int *pnterms, char ***attrs,
+                                    struct arena *arena, char *filename);
+void free_attrs(char **attrs, int nterms);
 int lowest_match(struct term *terms, int nterms, char *substr);
 int highest_match(struct term *terms, int nterms, char *substr);
 void autocomplete(struct term **answer, int *n_answer, struct term *terms, int nterms, char *substr);
 
+int sorted_prefix_range(int n, key_fn key, const void *ctx, const char *prefix, int *lo, int *hi);
+int prefix_range(struct term *terms, int nterms, const char *substr, int *lo, int *hi);
+int top_k_prefix(struct term *terms, int nterms, const struct range_max *rm,
+                 const char *substr, int k, int *out);
+void autocomplete_top_k(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                        const struct range_max *rm, const char *substr, int k);
+void autocomplete_scored(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                         const struct range_max *rm, const char *substr, int k,
+                         item_score_fn score, score_bound_fn bound, const void *ctx);
+void autocomplete_multi(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                        const struct range_max *rm, const char **prefixes, int nprefixes, int k);
+void autocomplete_popular(struct term **answer, int *n_answer, struct term *terms,
+                          const struct global_top *g, int k);
+void build_weight_sums(double **sums, struct term *terms, int nterms);
+void build_weight_sums_arena(double **sums, struct term *terms, int nterms, struct arena *arena);
+void prefix_stats(struct match_stats *stats, struct term *terms, int nterms,
+                  const double *sums, const struct range_max *rm, const char *substr);
+void autocomplete_page(struct term **answer, int *n_answer, struct term *terms, int nterms,
+                       const struct range_max *rm, struct range_iter_cache *cache,
+                       const char *substr, int page_size,
+                       const char *cursor, char *next_cursor, size_t cursor_cap);
+
 #endif
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE   // syscall()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "dictionary.h"
+
+/*
+ * TLB benchmark: loads the dictionary once per page mode and reports the
+ * data-TLB misses and time per prefix query.
+ *
+ *   ./bench_tlb cities.txt [queries]
+ *
+ * Misses come from perf_event_open(); where it is unavailable (not Linux,
+ * or perf_event_paranoid forbids it) only the time is reported.
+ */
+
+#define DEFAULT_QUERIES 200000
+#define PREFIX_LEN 3
+
+static int open_dtlb_counter(void)
+{
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+// Reads the counter, or returns -1 if there is none.
+static long long read_counter(int fd)
+{
+#if defined(__linux__)
+    long long count;
+    if (fd >= 0 && read(fd, &count, sizeof(count)) == (ssize_t)sizeof(count)) {
+        return count;
+    }
+#else
+    (void)fd;
+#endif
+    return -1;
+}
+
+static void set_counter(int fd, int on)
+{
+#if defined(__linux__)
+    if (fd >= 0) {
+        if (on) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        } else {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#else
+    (void)fd;
+    (void)on;
+#endif
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Kilobytes of anonymous memory currently on transparent huge pages, -1 if unknown.
+static long anon_huge_kb(void)
+{
+    FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+    if (!fp) {
+        return -1;
+    }
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s terms_file [queries]\n", argv[0]);
+        return 1;
+    }
+    int nqueries = argc > 2 ? atoi(argv[2]) : DEFAULT_QUERIES;
+    if (nqueries <= 0) {
+        nqueries = DEFAULT_QUERIES;
+    }
+
+    static const char *mode_names[] = { "4K pages", "THP advise", "MAP_HUGETLB" };
+    int fd = open_dtlb_counter();
+    if (fd < 0) {
+        fprintf(stderr, "Warning: dTLB counter unavailable, reporting time only.\n");
+    }
+
+    for (int mode = ARENA_HUGE_OFF; mode <= ARENA_HUGE_EXPLICIT; mode++) {
+        struct dictionary *dict;
+        load_dictionary(&dict, argv[1], mode, 0);
+        if (!dict) {
+            return 1;
+        }
+
+        // Same pseudo-random prefixes in every mode
+        char (*prefixes)[PREFIX_LEN + 1] = malloc(sizeof(*prefixes) * nqueries);
+        if (!prefixes) {
+            fprintf(stderr, "Error: Could not allocate memory for queries.\n");
+            free_dictionary(dict);
+            return 1;
+        }
+        srand(12345);
+        for (int q = 0; q < nqueries; q++) {
+            const char *t = dict->terms[rand() % dict->nterms].term;
+            size_t len = strlen(t);
+            if (len > PREFIX_LEN) {
+                len = PREFIX_LEN;
+            }
+            memcpy(prefixes[q], t, len);
+            prefixes[q][len] = '\0';
+        }
+
+        int ids[10];
+        long long checksum = 0;
+        set_counter(fd, 1);
+        double start = now_seconds();
+        for (int q = 0; q < nqueries; q++) {
+            int n = top_k_prefix(dict->terms, dict->nterms, &dict->rm, prefixes[q], 10, ids);
+            checksum += n > 0 ? ids[0] : 0;
+        }
+        double elapsed = now_seconds() - start;
+        set_counter(fd, 0);
+        long long misses = read_counter(fd);
+
+        printf("%-12s %8.0f ns/query", mode_names[mode], elapsed * 1e9 / nqueries);
+        if (misses >= 0) {
+            printf("  %7.2f dTLB misses/query", (double)misses / nqueries);
+        }
+        printf("  hugetlb %zu MB, THP %ld kB  (checksum %lld)\n",
+               dict->arena.hugetlb_bytes >> 20, anon_huge_kb(), checksum);
+        free(prefixes);
+        free_dictionary(dict);
+    }
+#if defined(__linux__)
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,663 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "btree.h"
+
+#define BTREE_MAGIC "ACBTREE1"
+#define NODE_LEAF 1
+#define NODE_INTERNAL 2
+#define NODE_HEADER 16   // type, 0, nkeys (2 bytes), first position, next leaf, unused
+#define NEXT_LEAVES 2    // leaves followed for an upper bound before searching from the root
+
+/*
+ * Node layouts after the header, all values native byte order and
+ * unaligned:
+ *   leaf entry      shared (1), suffix length (1), suffix, weight (8)
+ *   internal entry  child page (4), first position (4), max weight (8),
+ *                   key length (1), key
+ */
+
+static void put_int(unsigned char *p, int v)
+{
+    memcpy(p, &v, sizeof(int));
+}
+
+static int get_int(const unsigned char *p)
+{
+    int v;
+    memcpy(&v, p, sizeof(int));
+    return v;
+}
+
+static double get_double(const unsigned char *p)
+{
+    double v;
+    memcpy(&v, p, sizeof(double));
+    return v;
+}
+
+static int node_keys(const unsigned char *node)
+{
+    return node[2] | node[3] << 8;
+}
+
+static void start_node(unsigned char *node, int type, int first)
+{
+    memset(node, 0, BTREE_PAGE);
+    node[0] = (unsigned char)type;
+    put_int(node + 4, first);
+    put_int(node + 8, -1);
+}
+
+static void set_node_keys(unsigned char *node, int nkeys)
+{
+    node[2] = (unsigned char)(nkeys & 0xff);
+    node[3] = (unsigned char)(nkeys >> 8);
+}
+
+// One written node as seen by its parent; its separator is terms[first].term.
+typedef struct node_summary{
+    int page;
+    int first;
+    double max_weight;
+} node_summary;
+
+/*
+ * write_btree():
+ *   - Writes the sorted terms array as a B+tree file at path, filling
+ *     leaves first and then each internal level bottom-up.
+ *   - Returns 0 on success, -1 after printing an error.
+ */
+int write_btree(struct term *terms, int nterms, const char *path)
+{
+    if (!terms || nterms <= 0 || !path) {
+        return -1;
+    }
+    FILE *fp = fopen(path, "wb");
+    unsigned char *node = malloc(BTREE_PAGE);
+    struct node_summary *sums = malloc(sizeof(struct node_summary) * nterms);
+    if (!fp || !node || !sums) {
+        fprintf(stderr, "Error: Could not create B+tree file %s.\n", path);
+        if (fp) {
+            fclose(fp);
+        }
+        free(node);
+        free(sums);
+        return -1;
+    }
+
+    // Page 0 is written last, once the root is known
+    memset(node, 0, BTREE_PAGE);
+    int ok = fwrite(node, BTREE_PAGE, 1, fp) == 1;
+    int page = 1, nsums = 0;
+
+    int nkeys = 0, used = NODE_HEADER;
+    for (int i = 0; i < nterms && ok; i++) {
+        const char *key = terms[i].term;
+        size_t len = strlen(key);
+        size_t shared = 0;
+        if (nkeys > 0) {
+            const char *prev = terms[i - 1].term;
+            while (shared < 255 && shared < len && prev[shared] == key[shared]) {
+                shared++;
+            }
+        }
+        if (nkeys > 0 && used + 2 + (len - shared) + sizeof(double) > BTREE_PAGE) {
+            put_int(node + 8, page + 1);   // leaves are written in order
+            set_node_keys(node, nkeys);
+            ok = fwrite(node, BTREE_PAGE, 1, fp) == 1;
+            page++;
+            nkeys = 0;
+            used = NODE_HEADER;
+            shared = 0;
+        }
+        if (nkeys == 0) {
+            start_node(node, NODE_LEAF, i);
+            sums[nsums].page = page;
+            sums[nsums].first = i;
+            sums[nsums].max_weight = terms[i].weight;
+            nsums++;
+        }
+        node[used] = (unsigned char)shared;
+        node[used + 1] = (unsigned char)(len - shared);
+        memcpy(node + used + 2, key + shared, len - shared);
+        memcpy(node + used + 2 + (len - shared), &terms[i].weight, sizeof(double));
+        used += 2 + (int)(len - shared) + (int)sizeof(double);
+        nkeys++;
+        if (terms[i].weight > sums[nsums - 1].max_weight) {
+            sums[nsums - 1].max_weight = terms[i].weight;
+        }
+    }
+    if (ok) {
+        set_node_keys(node, nkeys);
+        ok = fwrite(node, BTREE_PAGE, 1, fp) == 1;
+        page++;
+    }
+
+    // Each internal level summarizes the one below, in place
+    int height = 1;
+    while (nsums > 1 && ok) {
+        int nparents = 0;
+        nkeys = 0;
+        used = NODE_HEADER;
+        for (int c = 0; c <= nsums && ok; c++) {
+            size_t len = c < nsums ? strlen(terms[sums[c].first].term) : 0;
+            if (nkeys > 0 && (c == nsums || used + 17 + len > BTREE_PAGE)) {
+                set_node_keys(node, nkeys);
+                ok = fwrite(node, BTREE_PAGE, 1, fp) == 1;
+                page++;
+                nkeys = 0;
+                used = NODE_HEADER;
+            }
+            if (c == nsums) {
+                break;
+            }
+            struct node_summary child = sums[c];
+            if (nkeys == 0) {
+                start_node(node, NODE_INTERNAL, child.first);
+                sums[nparents].page = page;
+                sums[nparents].first = child.first;
+                sums[nparents].max_weight = child.max_weight;
+                nparents++;
+            }
+            put_int(node + used, child.page);
+            put_int(node + used + 4, child.first);
+            memcpy(node + used + 8, &child.max_weight, sizeof(double));
+            node[used + 16] = (unsigned char)len;
+            memcpy(node + used + 17, terms[child.first].term, len);
+            used += 17 + (int)len;
+            nkeys++;
+            if (child.max_weight > sums[nparents - 1].max_weight) {
+                sums[nparents - 1].max_weight = child.max_weight;
+            }
+        }
+        nsums = nparents;
+        height++;
+    }
+
+    if (ok) {
+        memset(node, 0, BTREE_PAGE);
+        memcpy(node, BTREE_MAGIC, 8);
+        put_int(node + 8, nterms);
+        put_int(node + 12, page);
+        put_int(node + 16, sums[0].page);
+        put_int(node + 20, height);
+        ok = fseek(fp, 0, SEEK_SET) == 0 && fwrite(node, BTREE_PAGE, 1, fp) == 1;
+    }
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    free(node);
+    free(sums);
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write B+tree file %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int read_page(struct btree *bt, int page, unsigned char *buf)
+{
+    if (page == bt->root) {
+        memcpy(buf, bt->root_page, BTREE_PAGE);
+        return 0;
+    }
+    if (page <= 0 || page >= bt->npages
+        || pread(bt->fd, buf, BTREE_PAGE, (off_t)page * BTREE_PAGE) != BTREE_PAGE) {
+        fprintf(stderr, "Error: Could not read B+tree page %d.\n", page);
+        return -1;
+    }
+    bt->page_reads++;
+    return 0;
+}
+
+/*
+ * open_btree():
+ *   - Opens a file written by write_btree() and keeps its root in memory.
+ *
+ * Edge cases addressed:
+ *   - On failure prints an error and sets *bt = NULL.
+ */
+void open_btree(struct btree **bt, const char *path)
+{
+    *bt = NULL;
+    struct btree *b = calloc(1, sizeof(struct btree));
+    if (!b) {
+        fprintf(stderr, "Error: Could not allocate memory for B+tree.\n");
+        return;
+    }
+    b->fd = open(path, O_RDONLY);
+    if (b->fd < 0) {
+        fprintf(stderr, "Error: Could not open B+tree file %s.\n", path);
+        free(b);
+        return;
+    }
+    unsigned char *head = b->root_page;
+    if (pread(b->fd, head, BTREE_PAGE, 0) != BTREE_PAGE || memcmp(head, BTREE_MAGIC, 8) != 0) {
+        fprintf(stderr, "Error: %s is not a B+tree file.\n", path);
+        close_btree(b);
+        return;
+    }
+    b->nterms = get_int(head + 8);
+    b->npages = get_int(head + 12);
+    b->root = -1;
+    int root = get_int(head + 16);
+    b->height = get_int(head + 20);
+    if (read_page(b, root, b->root_page) != 0) {
+        close_btree(b);
+        return;
+    }
+    b->root = root;
+    b->page_reads = 0;
+    *bt = b;
+}
+
+static int key_before(const char *key, const char *prefix, size_t m, int upper)
+{
+    int cmp = strncmp(key, prefix, m);
+    return upper ? cmp <= 0 : cmp < 0;
+}
+
+/*
+ * Position of the first term of a leaf that is not before prefix: for the
+ * lower bound a term is before if it sorts below prefix, for the upper
+ * bound also if it starts with prefix. One past the leaf if all are.
+ */
+static int scan_leaf(const unsigned char *node, const char *prefix, size_t m, int upper)
+{
+    char key[256];
+    int nkeys = node_keys(node);
+    const unsigned char *e = node + NODE_HEADER;
+    int count = 0;
+    for (; count < nkeys; count++) {
+        int shared = e[0], len = e[1];
+        memcpy(key + shared, e + 2, len);
+        key[shared + len] = '\0';
+        if (!key_before(key, prefix, m, upper)) {
+            break;
+        }
+        e += 2 + len + sizeof(double);
+    }
+    return get_int(node + 4) + count;
+}
+
+/*
+ * Same position over the whole tree, reading one node per level; the leaf
+ * reached is left in leaf and, if parent is not NULL, the node above it in
+ * parent with the leaf's slot in *slot (-1 when the root is the leaf).
+ * Returns -1 on a read error.
+ */
+static int descend(struct btree *bt, const char *prefix, int upper, unsigned char *leaf,
+                   unsigned char *parent, int *slot)
+{
+    char key[256];
+    size_t m = strlen(prefix);
+    int page = bt->root;
+    for (;;) {
+        if (read_page(bt, page, leaf) != 0) {
+            return -1;
+        }
+        if (leaf[0] == NODE_LEAF) {
+            return scan_leaf(leaf, prefix, m, upper);
+        }
+        // Last child whose first term is before prefix
+        int nkeys = node_keys(leaf);
+        const unsigned char *e = leaf + NODE_HEADER;
+        int child = get_int(e), c = 0;
+        for (; c < nkeys; c++) {
+            int len = e[16];
+            memcpy(key, e + 17, len);
+            key[len] = '\0';
+            if (c > 0 && !key_before(key, prefix, m, upper)) {
+                break;
+            }
+            child = get_int(e);
+            e += 17 + len;
+        }
+        if (parent) {
+            memcpy(parent, leaf, BTREE_PAGE);
+            *slot = c - 1;
+        }
+        page = child;
+    }
+}
+
+/*
+ * Slot of the leaf holding the upper bound, going by the separators of the
+ * parent from the lower bound's slot on, with its page in *page. If it is
+ * the parent's last child the range may run on into the next leaves.
+ */
+static int upper_slot(const unsigned char *parent, int slot, const char *prefix, size_t m,
+                      int *page)
+{
+    char key[256];
+    int nkeys = node_keys(parent);
+    const unsigned char *e = parent + NODE_HEADER;
+    for (int c = 0; c < slot; c++) {
+        e += 17 + e[16];
+    }
+    int c = slot;
+    for (*page = get_int(e); c + 1 < nkeys; c++) {
+        e += 17 + e[16];
+        int len = e[16];
+        memcpy(key, e + 17, len);
+        key[len] = '\0';
+        if (!key_before(key, prefix, m, 1)) {
+            break;
+        }
+        *page = get_int(e);
+    }
+    return c;
+}
+
+/*
+ * btree_prefix_range():
+ *   - Sets [*lo, *hi) to the positions of the terms starting with prefix
+ *     and returns their number (an empty prefix matches nothing, as in
+ *     prefix_range()).
+ *   - Reads one node per level below the root for the lower bound. The
+ *     upper bound is in a leaf under the same parent, read directly, or
+ *     else a leaf or two further along the next-leaf links; it is searched
+ *     from the root again only when the range runs past those or past the
+ *     parent's other leaves.
+ */
+int btree_prefix_range(struct btree *bt, const char *prefix, int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (!bt || !prefix || prefix[0] == '\0') {
+        return 0;
+    }
+    unsigned char leaf[BTREE_PAGE], parent[BTREE_PAGE];
+    int slot = -1;
+    int l = descend(bt, prefix, 0, leaf, parent, &slot);
+    int h = -1;
+    if (l >= 0) {
+        size_t m = strlen(prefix);
+        h = scan_leaf(leaf, prefix, m, 1);
+        int page, hops = 0;
+        if (slot >= 0 && h == get_int(leaf + 4) + node_keys(leaf)) {
+            int c = upper_slot(parent, slot, prefix, m, &page);
+            int last = node_keys(parent) - 1;
+            if (c == last && c > slot) {
+                hops = NEXT_LEAVES;     // runs on past a whole parent
+            } else if (c < last) {
+                if (c > slot) {
+                    h = read_page(bt, page, leaf) == 0 ? scan_leaf(leaf, prefix, m, 1) : -1;
+                }
+                hops = -1;              // ends under this parent
+            }
+        }
+        for (; h >= 0 && hops >= 0 && h == get_int(leaf + 4) + node_keys(leaf); hops++) {
+            int next = get_int(leaf + 8);
+            if (next < 0) {
+                break;      // the range runs to the last term
+            }
+            if (hops == NEXT_LEAVES) {
+                h = descend(bt, prefix, 1, leaf, NULL, NULL);
+                break;
+            }
+            if (read_page(bt, next, leaf) != 0) {
+                h = -1;
+                break;
+            }
+            h = scan_leaf(leaf, prefix, m, 1);
+        }
+    }
+    if (l < 0 || h < 0) {
+        return 0;
+    }
+    *lo = l;
+    *hi = h;
+    return h - l;
+}
+
+/*
+ * btree_lowest_match() / btree_highest_match():
+ *   - lowest_match() and highest_match() over the file: the first or last
+ *     position starting with prefix, -1 if none.
+ */
+int btree_lowest_match(struct btree *bt, const char *prefix)
+{
+    int lo, hi;
+    return btree_prefix_range(bt, prefix, &lo, &hi) > 0 ? lo : -1;
+}
+
+int btree_highest_match(struct btree *bt, const char *prefix)
+{
+    int lo, hi;
+    return btree_prefix_range(bt, prefix, &lo, &hi) > 0 ? hi - 1 : -1;
+}
+
+/*
+ * btree_term():
+ *   - Reads the term at position i into *out. Returns 0, or -1 if i is out
+ *     of range or a page could not be read.
+ */
+int btree_term(struct btree *bt, int i, struct term *out)
+{
+    if (!bt || i < 0 || i >= bt->nterms) {
+        return -1;
+    }
+    unsigned char node[BTREE_PAGE];
+    int page = bt->root;
+    for (;;) {
+        if (read_page(bt, page, node) != 0) {
+            return -1;
+        }
+        int nkeys = node_keys(node);
+        const unsigned char *e = node + NODE_HEADER;
+        if (node[0] == NODE_LEAF) {
+            int target = i - get_int(node + 4);
+            if (target >= nkeys) {
+                return -1;
+            }
+            for (int c = 0;; c++) {
+                int shared = e[0], len = e[1];
+                memcpy(out->term + shared, e + 2, len);
+                out->term[shared + len] = '\0';
+                if (c == target) {
+                    out->weight = get_double(e + 2 + len);
+                    return 0;
+                }
+                e += 2 + len + sizeof(double);
+            }
+        }
+        int child = get_int(e);
+        for (int c = 0; c < nkeys && get_int(e + 4) <= i; c++) {
+            child = get_int(e);
+            e += 17 + e[16];
+        }
+        page = child;
+    }
+}
+
+/*
+ * Top-k candidate: a term (page == -1) or a subtree still to be read,
+ * with an upper bound on its weights.
+ */
+typedef struct bt_cand{
+    double weight;  // exact for a term, the subtree's max weight otherwise
+    int pos;        // position of the term, or first position still in range
+    int page, end;  // subtree node and the position it ends before
+    int term;       // slot in the term pool
+} bt_cand;
+
+static int cand_above(const struct bt_cand *a, const struct bt_cand *b)
+{
+    if (a->weight != b->weight) return a->weight > b->weight;
+    if (a->pos != b->pos) return a->pos < b->pos;
+    return a->page >= 0 && b->page < 0;
+}
+
+static void cand_push(struct bt_cand *heap, int *n, struct bt_cand c)
+{
+    int i = (*n)++;
+    while (i > 0 && cand_above(&c, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = c;
+}
+
+static struct bt_cand cand_pop(struct bt_cand *heap, int *n)
+{
+    struct bt_cand top = heap[0];
+    struct bt_cand last = heap[--(*n)];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= *n) {
+            break;
+        }
+        if (c + 1 < *n && cand_above(&heap[c + 1], &heap[c])) {
+            c++;
+        }
+        if (!cand_above(&heap[c], &last)) {
+            break;
+        }
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// Grows *p (of *cap elements of size bytes) to hold need; returns 0 or -1.
+static int reserve(void **p, int *cap, int need, size_t size)
+{
+    if (need <= *cap) {
+        return 0;
+    }
+    int new_cap = *cap ? *cap : 64;
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    void *q = realloc(*p, size * new_cap);
+    if (!q) {
+        return -1;
+    }
+    *p = q;
+    *cap = new_cap;
+    return 0;
+}
+
+/*
+ * btree_autocomplete():
+ *   - Returns the k heaviest terms starting with substr, best first; the
+ *     same answer as autocomplete_top_k() on the array the file came from.
+ *
+ * Approach:
+ *   - Best-first search from the root: subtrees are ranked by the max
+ *     weight stored in their parent and only read once that bound is the
+ *     best remaining candidate, so light parts of a large range stay on
+ *     disk.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void btree_autocomplete(struct term **answer, int *n_answer, struct btree *bt,
+                        const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = btree_prefix_range(bt, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    struct term *out = malloc(sizeof(struct term) * k);
+    struct bt_cand *heap = NULL;
+    struct term *pool = NULL;
+    int nheap = 0, heap_cap = 0, npool = 0, pool_cap = 0;
+    unsigned char node[BTREE_PAGE];
+    int n = 0, failed = !out;
+
+    struct bt_cand root = { DBL_MAX, lo, bt->root, bt->nterms, -1 };
+    if (!failed) {
+        failed = reserve((void **)&heap, &heap_cap, 1, sizeof(struct bt_cand));
+    }
+    if (!failed) {
+        cand_push(heap, &nheap, root);
+    }
+    while (!failed && n < k && nheap > 0) {
+        struct bt_cand c = cand_pop(heap, &nheap);
+        if (c.page < 0) {
+            out[n++] = pool[c.term];
+            continue;
+        }
+        if (read_page(bt, c.page, node) != 0) {
+            failed = 1;
+            break;
+        }
+        int nkeys = node_keys(node);
+        int first = get_int(node + 4);
+        const unsigned char *e = node + NODE_HEADER;
+        if (reserve((void **)&heap, &heap_cap, nheap + nkeys, sizeof(struct bt_cand)) != 0) {
+            failed = 1;
+            break;
+        }
+        if (node[0] == NODE_LEAF) {
+            char key[256];
+            for (int j = 0; j < nkeys; j++) {
+                int shared = e[0], len = e[1];
+                memcpy(key + shared, e + 2, len);
+                key[shared + len] = '\0';
+                int pos = first + j;
+                if (pos >= lo && pos < hi) {
+                    if (reserve((void **)&pool, &pool_cap, npool + 1, sizeof(struct term)) != 0) {
+                        failed = 1;
+                        break;
+                    }
+                    memcpy(pool[npool].term, key, shared + len + 1);
+                    pool[npool].weight = get_double(e + 2 + len);
+                    struct bt_cand t = { pool[npool].weight, pos, -1, pos + 1, npool };
+                    cand_push(heap, &nheap, t);
+                    npool++;
+                }
+                e += 2 + len + sizeof(double);
+            }
+        } else {
+            for (int j = 0; j < nkeys; j++) {
+                const unsigned char *next = e + 17 + e[16];
+                int start = get_int(e + 4);
+                int end = j + 1 < nkeys ? get_int(next + 4) : c.end;
+                if (start < hi && end > lo) {
+                    struct bt_cand s = { get_double(e + 8), start > lo ? start : lo,
+                                         get_int(e), end, -1 };
+                    cand_push(heap, &nheap, s);
+                }
+                e = next;
+            }
+        }
+    }
+    free(heap);
+    free(pool);
+
+    if (failed) {
+        fprintf(stderr, "Error: Could not complete B+tree query.\n");
+        free(out);
+        return;
+    }
+    *answer = out;
+    *n_answer = n;
+}
+
+void close_btree(struct btree *bt)
+{
+    if (!bt) {
+        return;
+    }
+    if (bt->fd >= 0) {
+        close(bt->fd);
+    }
+    free(bt);
+}
@@ -0,0 +1,41 @@
+#if !defined(BTREE_H)
+#define BTREE_H
+
+#include "autocomplete.h"
+
+// Node size; every node is one page-aligned read.
+#define BTREE_PAGE 4096
+
+/*
+ * Static B+tree file for dictionaries larger than memory, opened with
+ * open_btree() and read one 4 KB node at a time with pread(); only the
+ * root stays in memory.
+ *
+ * Page 0 is the header. Leaves hold the terms in sorted order, each key
+ * stored as the number of bytes it shares with the previous key of the
+ * leaf plus the rest. Internal nodes hold, per child, its page, the
+ * position of its first term, its first term as separator and the largest
+ * weight below it, so top-k queries skip subtrees that cannot contribute.
+ * Positions are those of the sorted term array the file was written from.
+ */
+typedef struct btree{
+    int fd;
+    int nterms;
+    int npages;
+    int root;
+    int height;                         // 1 if the root is a leaf
+    unsigned char root_page[BTREE_PAGE];
+    long page_reads;                    // pages read since open_btree()
+} btree;
+
+int write_btree(struct term *terms, int nterms, const char *path);
+void open_btree(struct btree **bt, const char *path);
+int btree_prefix_range(struct btree *bt, const char *prefix, int *lo, int *hi);
+int btree_lowest_match(struct btree *bt, const char *prefix);
+int btree_highest_match(struct btree *bt, const char *prefix);
+int btree_term(struct btree *bt, int i, struct term *out);
+void btree_autocomplete(struct term **answer, int *n_answer, struct btree *bt,
+                        const char *substr, int k);
+void close_btree(struct btree *bt);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "decay.h"
+
+static double log_of(double weight)
+{
+    return weight > 0 ? log(weight) : -HUGE_VAL;
+}
+
+/*
+ * decay_key():
+ *   - Time-invariant ranking key of term i (an item_value_fn over a
+ *     struct decay_weights), usable by any range_max over the terms.
+ */
+double decay_key(const void *ctx, int i)
+{
+    const struct decay_weights *dw = (const struct decay_weights *)ctx;
+    return dw->log_weight[i] + dw->lambda * (dw->stamp[i] - dw->epoch);
+}
+
+/*
+ * build_decay_weights():
+ *   - Starts every term at its file weight as of time now; weights halve
+ *     every half_life time units (any unit, as long as it is used throughout).
+ *
+ * Edge cases addressed:
+ *   - half_life <= 0 is rejected; on any failure *dw = NULL.
+ */
+void build_decay_weights(struct decay_weights **dw, struct term *terms, int nterms,
+                         double half_life, double now)
+{
+    *dw = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+    if (!(half_life > 0)) {
+        fprintf(stderr, "Error: Decay half-life must be positive.\n");
+        return;
+    }
+
+    struct decay_weights *d = calloc(1, sizeof(struct decay_weights));
+    if (d) {
+        d->log_weight = malloc(sizeof(double) * nterms);
+        d->stamp = malloc(sizeof(double) * nterms);
+    }
+    if (!d || !d->log_weight || !d->stamp) {
+        fprintf(stderr, "Error: Could not allocate memory for decayed weights.\n");
+        free_decay_weights(d);
+        return;
+    }
+    d->n = nterms;
+    d->lambda = log(2.0) / half_life;
+    d->epoch = now;
+    d->terms = terms;
+    for (int i = 0; i < nterms; i++) {
+        d->log_weight[i] = log_of(terms[i].weight);
+        d->stamp[i] = now;
+    }
+
+    if (build_range_max(&d->rm, nterms, decay_key, d) != 0
+        || build_global_top(&d->top, &d->rm, GLOBAL_TOP_K) != 0) {
+        free_decay_weights(d);
+        return;
+    }
+    *dw = d;
+}
+
+/*
+ * decay_weight():
+ *   - Weight of term i as of time now: its stored weight decayed over the
+ *     time since its last update.
+ */
+double decay_weight(const struct decay_weights *dw, int i, double now)
+{
+    double age = now - dw->stamp[i];
+    if (age < 0) {
+        age = 0;
+    }
+    return exp(dw->log_weight[i] - dw->lambda * age);
+}
+
+/*
+ * decay_bump():
+ *   - Adds amount to the current (decayed) weight of term i at time now
+ *     and refreshes the range_max and global top:
+ *     O(RANGE_MAX_BLOCK + log n + GLOBAL_TOP_K).
+ *   - Only this term's pair is rewritten; no other weight is touched.
+ *
+ * Edge cases:
+ *   - A now earlier than the term's last update is treated as that update,
+ *     so a late event never ages the term.
+ */
+void decay_bump(struct decay_weights *dw, int i, double amount, double now)
+{
+    if (!dw || i < 0 || i >= dw->n) {
+        return;
+    }
+    if (now < dw->stamp[i]) {
+        now = dw->stamp[i];
+    }
+    dw->log_weight[i] = log_of(decay_weight(dw, i, now) + amount);
+    dw->stamp[i] = now;
+    range_max_update_top(&dw->rm, &dw->top, i);
+}
+
+/*
+ * decay_renormalize():
+ *   - Meant to be called periodically. Once the keys have drifted more than
+ *     DECAY_RENORM_LOG from the epoch, rebases every pair to time now and
+ *     moves the epoch there, keeping keys small enough to keep their
+ *     precision; otherwise does nothing.
+ *   - Returns 1 if it rebased, 0 if not. Rebasing shifts every key by the
+ *     same amount, so order is kept, but rounding may break exact ties
+ *     differently: dw->rm and dw->top are rebuilt, and callers should rebuild their own
+ *     range_max over decay_key() when this returns 1.
+ *   - Returns -1 if the new dw->rm could not be allocated; the keys are
+ *     rebased anyway and the old tree is kept, which still ranks them
+ *     except possibly for ties.
+ */
+int decay_renormalize(struct decay_weights *dw, double now)
+{
+    if (!dw || dw->lambda * (now - dw->epoch) <= DECAY_RENORM_LOG) {
+        return 0;
+    }
+    for (int i = 0; i < dw->n; i++) {
+        if (dw->stamp[i] < now) {
+            dw->log_weight[i] -= dw->lambda * (now - dw->stamp[i]);
+            dw->stamp[i] = now;
+        }
+    }
+    dw->epoch = now;
+
+    struct range_max rm;
+    if (build_range_max(&rm, dw->n, decay_key, dw) != 0) {
+        fprintf(stderr, "Error: Could not rebuild decayed weight index.\n");
+        return -1;
+    }
+    free_range_max(&dw->rm);
+    dw->rm = rm;
+    global_top_reset(&dw->top);
+    return 1;
+}
+
+/*
+ * decay_autocomplete():
+ *   - Returns the k terms starting with substr that have the highest
+ *     weight at time now, best first. Each returned term carries that
+ *     decayed weight.
+ *   - Cost is that of top_k_ranges(): the keys already rank the terms as
+ *     of any time, so nothing is decayed except the k results.
+ *   - An empty substr returns the k most popular terms overall, from the
+ *     global top.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void decay_autocomplete(struct term **answer, int *n_answer, const struct decay_weights *dw,
+                        const char *substr, int k, double now)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!dw || !substr) {
+        return;
+    }
+
+    int lo = 0, hi = dw->n;
+    int count = substr[0] == '\0' ? dw->n : prefix_range(dw->terms, dw->n, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = substr[0] == '\0' ? global_top_ids(&dw->top, k, ids)
+                           : top_k_ranges(&dw->rm, &lo, &hi, 1, k, NULL, NULL, ids);
+    terms_from_ids(answer, n_answer, dw->terms, ids, k);
+    for (int i = 0; i < *n_answer; i++) {
+        (*answer)[i].weight = decay_weight(dw, ids[i], now);
+    }
+    free(ids);
+}
+
+void free_decay_weights(struct decay_weights *dw)
+{
+    if (!dw) {
+        return;
+    }
+    free(dw->log_weight);
+    free(dw->stamp);
+    free_range_max(&dw->rm);
+    free_global_top(&dw->top);
+    free(dw);
+}
@@ -0,0 +1,44 @@
+#if !defined(DECAY_H)
+#define DECAY_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * Drift of the keys from the epoch (in natural-log units) beyond which
+ * decay_renormalize() rebases them.
+ */
+#define DECAY_RENORM_LOG 64.0
+
+/*
+ * Popularity that halves every half_life time units and is bumped on use.
+ * Each term stores (log weight, timestamp of its last update) and is only
+ * decayed when read, so time passing rewrites nothing.
+ *
+ * Ranking uses key(i) = log_weight[i] + lambda * (stamp[i] - epoch), which is
+ * the log of the term's weight as of any common instant, shifted by a
+ * constant: the order of keys never changes as time passes, and a
+ * range_max built on decay_key() stays valid between bumps.
+ */
+typedef struct decay_weights{
+    int n;
+    double lambda;       // decay rate, ln 2 / half_life
+    double epoch;        // time the keys are measured from
+    double *log_weight;  // natural log of the weight at stamp (-HUGE_VAL for 0)
+    double *stamp;       // time of the last update
+    struct range_max rm; // best key over ranges of terms
+    struct global_top top; // best GLOBAL_TOP_K keys, for empty prefixes
+    struct term *terms;
+} decay_weights;
+
+void build_decay_weights(struct decay_weights **dw, struct term *terms, int nterms,
+                         double half_life, double now);
+double decay_key(const void *ctx, int i);
+double decay_weight(const struct decay_weights *dw, int i, double now);
+void decay_bump(struct decay_weights *dw, int i, double amount, double now);
+int decay_renormalize(struct decay_weights *dw, double now);
+void decay_autocomplete(struct term **answer, int *n_answer, const struct decay_weights *dw,
+                        const char *substr, int k, double now);
+void free_decay_weights(struct decay_weights *dw);
+
+#endif
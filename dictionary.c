@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "dictionary.h"
+
+static double term_weight(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+/*
+ * Builds the secondary indexes named in indexes (DICT_* flags) over the
+ * loaded terms, in d's arena. Returns 0, or -1 if one could not be built.
+ */
+static int build_indexes(struct dictionary *d, char **attrs, int indexes, char *filename)
+{
+    struct arena *a = &d->arena;
+    if (indexes & DICT_SUBSTRING) {
+        build_substring_index_arena(&d->substring, d->terms, d->nterms, a);
+        if (!d->substring) return -1;
+    }
+    if (indexes & DICT_TOKENS) {
+        build_token_index_arena(&d->tokens, d->terms, d->nterms, a);
+        if (!d->tokens) return -1;
+    }
+    if (indexes & DICT_REVERSE) {
+        build_reverse_index_arena(&d->reverse, d->terms, d->nterms, a);
+        if (!d->reverse) return -1;
+    }
+    if (indexes & DICT_ATTRS) {
+        build_attr_index_arena(&d->attrs, d->terms, d->nterms, attrs, a);
+        if (!d->attrs) return -1;
+    }
+    if (indexes & DICT_PHONETIC) {
+        build_phonetic_index_arena(&d->phonetic, d->terms, d->nterms, a);
+        if (!d->phonetic) return -1;
+    }
+    if (indexes & DICT_ALIASES) {
+        read_in_aliases_arena(&d->aliases, d->terms, d->nterms, a, filename);  // NULL if none
+    }
+    if (indexes & DICT_SPELL) {
+        build_spell_index_arena(&d->spell, d->terms, d->nterms, SPELL_MAX_DISTANCE,
+                                DICT_SPELL_MAX_BYTES, a);
+        if (!d->spell) return -1;
+    }
+    return 0;
+}
+
+/*
+ * load_dictionary():
+ *   - Reads filename as read_in_terms() does and builds the term
+ *     range_max, its global top and the weight sums, plus the secondary
+ *     indexes named in indexes (DICT_* flags, 0 for none), all in the
+ *     dictionary's arena except the global top's small list.
+ *   - huge is the ARENA_HUGE_* page backing of that arena. Binary-search
+ *     probes over a large term array touch a new page almost every step,
+ *     so 2 MB pages save most of their TLB misses; if huge pages are not
+ *     available the dictionary silently uses normal pages.
+ *
+ * Edge cases addressed:
+ *   - If the file cannot be read or memory runs out, prints an error and
+ *     sets *dict = NULL; nothing stays allocated.
+ *   - DICT_ALIASES on a file without an alias section leaves aliases NULL.
+ */
+void load_dictionary(struct dictionary **dict, char *filename, int huge, int indexes)
+{
+    *dict = NULL;
+    struct dictionary *d = calloc(1, sizeof(struct dictionary));
+    if (!d) {
+        fprintf(stderr, "Error: Could not allocate memory for dictionary.\n");
+        return;
+    }
+    arena_init(&d->arena, 0);
+    d->arena.huge = huge;
+
+    // The attribute column is only kept to build its index
+    char **attrs = NULL;
+    if (indexes & DICT_ATTRS) {
+        read_in_terms_with_attrs_arena(&d->terms, &d->nterms, &attrs, &d->arena, filename);
+    } else {
+        read_in_terms_arena(&d->terms, &d->nterms, &d->arena, filename);
+    }
+    if (!d->terms || d->nterms <= 0) {
+        free_dictionary(d);
+        return;
+    }
+    if (build_range_max_arena(&d->rm, d->nterms, term_weight, d->terms, &d->arena) != 0
+        || build_global_top(&d->top, &d->rm, GLOBAL_TOP_K) != 0) {
+        free_dictionary(d);
+        return;
+    }
+    build_weight_sums_arena(&d->sums, d->terms, d->nterms, &d->arena);
+    if (!d->sums || build_indexes(d, attrs, indexes, filename) != 0) {
+        free_dictionary(d);
+        return;
+    }
+    *dict = d;
+}
+
+size_t dictionary_memory(const struct dictionary *dict)
+{
+    return dict ? sizeof(*dict) + arena_reserved(&dict->arena) : 0;
+}
+
+/*
+ * free_dictionary():
+ *   - Releases the dictionary and everything built by load_dictionary(),
+ *     its indexes included, in O(chunks).
+ */
+void free_dictionary(struct dictionary *dict)
+{
+    if (!dict) {
+        return;
+    }
+    free_global_top(&dict->top);
+    arena_release(&dict->arena);
+    free(dict);
+}
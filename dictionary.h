@@ -0,0 +1,53 @@
+#if !defined(DICTIONARY_H)
+#define DICTIONARY_H
+
+#include "autocomplete.h"
+#include "topk.h"
+#include "arena.h"
+#include "substring.h"
+#include "tokens.h"
+#include "reverse.h"
+#include "filter.h"
+#include "phonetic.h"
+#include "alias.h"
+#include "spell.h"
+
+// Secondary indexes load_dictionary() can build, or'ed together.
+#define DICT_SUBSTRING 0x01  // suffix array, for substring_autocomplete()
+#define DICT_TOKENS 0x02     // token index, for token_autocomplete()
+#define DICT_REVERSE 0x04    // reversed keys, for suffix_autocomplete()
+#define DICT_ATTRS 0x08      // attribute bitmaps, for filtered_autocomplete()
+#define DICT_PHONETIC 0x10   // sound-alike keys, for phonetic_autocomplete()
+#define DICT_ALIASES 0x20    // the file's alias section, for alias_autocomplete()
+#define DICT_SPELL 0x40      // deletion index, for spell_suggest()
+
+// Memory cap of a dictionary's spelling index (see build_spell_index()).
+#define DICT_SPELL_MAX_BYTES ((size_t)256 << 20)
+
+/*
+ * A loaded dictionary and the structures built over it at load time, all
+ * allocated from one arena: releasing it after a reload is a single
+ * arena_release() instead of one free() per structure.
+ */
+typedef struct dictionary{
+    struct arena arena;
+    struct term *terms;
+    int nterms;
+    struct range_max rm; // by weight, for the top-k queries
+    struct global_top top; // best GLOBAL_TOP_K terms over rm, for autocomplete_popular()
+    double *sums;        // running weight totals, for prefix_stats()
+    // Secondary indexes, NULL unless requested (aliases also if the file has none)
+    struct substring_index *substring;
+    struct token_index *tokens;
+    struct reverse_index *reverse;
+    struct attr_index *attrs;
+    struct phonetic_index *phonetic;
+    struct alias_index *aliases;
+    struct spell_index *spell;
+} dictionary;
+
+void load_dictionary(struct dictionary **dict, char *filename, int huge, int indexes);
+size_t dictionary_memory(const struct dictionary *dict);
+void free_dictionary(struct dictionary *dict);
+
+#endif
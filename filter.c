@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filter.h"
+#include "arena.h"
+
+#define BITMAP_WORDS (65536 / 64)
+
+/*
+ * Appends id to r; ids must arrive in ascending order.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int roaring_append(struct roaring *r, int id)
+{
+    uint16_t key = (uint16_t)((unsigned)id >> 16);
+    uint16_t low = (uint16_t)((unsigned)id & 0xffff);
+
+    if (r->ncontainers == 0 || r->c[r->ncontainers - 1].key != key) {
+        if (r->ncontainers == r->cap) {
+            int cap = r->cap ? r->cap * 2 : 4;
+            struct roaring_container *c = realloc(r->c, sizeof(struct roaring_container) * cap);
+            if (!c) {
+                return -1;
+            }
+            r->c = c;
+            r->cap = cap;
+        }
+        struct roaring_container *c = &r->c[r->ncontainers++];
+        memset(c, 0, sizeof(*c));
+        c->key = key;
+        c->rank = r->card;
+    }
+
+    struct roaring_container *c = &r->c[r->ncontainers - 1];
+    if (c->bits) {
+        c->bits[low / 64] |= (uint64_t)1 << (low % 64);
+    } else if (c->card < ROARING_ARRAY_MAX) {
+        if (c->card == c->cap) {
+            int cap = c->cap ? c->cap * 2 : 8;
+            uint16_t *array = realloc(c->array, sizeof(uint16_t) * cap);
+            if (!array) {
+                return -1;
+            }
+            c->array = array;
+            c->cap = cap;
+        }
+        c->array[c->card] = low;
+    } else {
+        // Array is full: switch to a bitmap, which is no larger from here on
+        c->bits = calloc(BITMAP_WORDS, sizeof(uint64_t));
+        if (!c->bits) {
+            return -1;
+        }
+        for (int i = 0; i < c->card; i++) {
+            c->bits[c->array[i] / 64] |= (uint64_t)1 << (c->array[i] % 64);
+        }
+        c->bits[low / 64] |= (uint64_t)1 << (low % 64);
+        free(c->array);
+        c->array = NULL;
+        c->cap = 0;
+    }
+    c->card++;
+    r->card++;
+    return 0;
+}
+
+static void free_roaring(struct roaring *r, struct arena *arena)
+{
+    for (int i = 0; i < r->ncontainers; i++) {
+        arena_free(arena, r->c[i].array);
+        arena_free(arena, r->c[i].bits);
+    }
+    arena_free(arena, r->c);
+    memset(r, 0, sizeof(*r));
+}
+
+/*
+ * Moves a finished bitmap from the heap into arena, every block at its
+ * exact size (the doubling growth of roaring_append() would leave the
+ * outgrown blocks unused in the arena). Does nothing for a NULL arena.
+ * Returns 0, or -1 if the arena is out of memory; r is unchanged then.
+ */
+static int roaring_to_arena(struct roaring *r, struct arena *arena)
+{
+    if (!arena || r->ncontainers == 0) {
+        return 0;
+    }
+    struct roaring_container *c = arena_alloc(arena, sizeof(struct roaring_container) * r->ncontainers);
+    if (!c) {
+        return -1;
+    }
+    memcpy(c, r->c, sizeof(struct roaring_container) * r->ncontainers);
+    for (int i = 0; i < r->ncontainers; i++) {
+        size_t bytes = c[i].bits ? sizeof(uint64_t) * BITMAP_WORDS : sizeof(uint16_t) * c[i].card;
+        void *copy = arena_alloc(arena, bytes);
+        if (!copy) {
+            return -1;
+        }
+        memcpy(copy, c[i].bits ? (void *)c[i].bits : (void *)c[i].array, bytes);
+        if (c[i].bits) {
+            c[i].bits = copy;
+        } else {
+            c[i].array = copy;
+            c[i].cap = c[i].card;
+        }
+    }
+    int ncontainers = r->ncontainers;
+    int card = r->card;
+    free_roaring(r, NULL);
+    r->c = c;
+    r->ncontainers = r->cap = ncontainers;
+    r->card = card;
+    return 0;
+}
+
+/*
+ * Index of the first container whose key is >= key.
+ */
+static int find_container(const struct roaring *r, uint16_t key)
+{
+    int left = 0, right = r->ncontainers;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (r->c[mid].key < key) left = mid + 1;
+        else right = mid;
+    }
+    return left;
+}
+
+// Number of low values < low stored in c
+static int container_rank(const struct roaring_container *c, uint16_t low)
+{
+    if (c->bits) {
+        int count = 0;
+        for (int w = 0; w < low / 64; w++) {
+            count += __builtin_popcountll(c->bits[w]);
+        }
+        uint64_t mask = ((uint64_t)1 << (low % 64)) - 1;
+        return count + __builtin_popcountll(c->bits[low / 64] & mask);
+    }
+    int left = 0, right = c->card;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (c->array[mid] < low) left = mid + 1;
+        else right = mid;
+    }
+    return left;
+}
+
+/*
+ * roaring_rank():
+ *   - Returns the number of ids in r that are < id.
+ */
+int roaring_rank(const struct roaring *r, int id)
+{
+    if (id <= 0) {
+        return 0;
+    }
+    uint16_t key = (uint16_t)((unsigned)id >> 16);
+    int i = find_container(r, key);
+    if (i == r->ncontainers) {
+        return r->card;
+    }
+    if (r->c[i].key != key) {
+        return r->c[i].rank;
+    }
+    return r->c[i].rank + container_rank(&r->c[i], (uint16_t)((unsigned)id & 0xffff));
+}
+
+/*
+ * roaring_contains():
+ *   - Returns 1 if id is in r, 0 otherwise.
+ */
+int roaring_contains(const struct roaring *r, int id)
+{
+    if (id < 0) {
+        return 0;
+    }
+    uint16_t key = (uint16_t)((unsigned)id >> 16);
+    uint16_t low = (uint16_t)((unsigned)id & 0xffff);
+    int i = find_container(r, key);
+    if (i == r->ncontainers || r->c[i].key != key) {
+        return 0;
+    }
+    const struct roaring_container *c = &r->c[i];
+    if (c->bits) {
+        return (int)((c->bits[low / 64] >> (low % 64)) & 1);
+    }
+    int pos = container_rank(c, low);
+    return pos < c->card && c->array[pos] == low;
+}
+
+/*
+ * Writes the ids of r that lie in [lo, hi) to out, ascending.
+ * Returns the number written.
+ */
+static int roaring_collect(const struct roaring *r, int lo, int hi, int *out)
+{
+    int n = 0;
+    for (int i = find_container(r, (uint16_t)((unsigned)lo >> 16)); i < r->ncontainers; i++) {
+        const struct roaring_container *c = &r->c[i];
+        int base = (int)c->key << 16;
+        if (base >= hi) {
+            break;
+        }
+        if (c->bits) {
+            for (int w = 0; w < BITMAP_WORDS; w++) {
+                uint64_t word = c->bits[w];
+                while (word) {
+                    int id = base + w * 64 + __builtin_ctzll(word);
+                    word &= word - 1;
+                    if (id >= lo && id < hi) {
+                        out[n++] = id;
+                    }
+                }
+            }
+        } else {
+            for (int j = 0; j < c->card; j++) {
+                int id = base + c->array[j];
+                if (id >= lo && id < hi) {
+                    out[n++] = id;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+static int compare_string(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int find_value(const struct attr_index *idx, const char *value)
+{
+    int left = 0, right = idx->nvalues;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        int cmp = strcmp(idx->values[mid], value);
+        if (cmp == 0) return mid;
+        if (cmp < 0) left = mid + 1;
+        else right = mid;
+    }
+    return -1;
+}
+
+/*
+ * build_attr_index():
+ *   - attrs[i] is the attribute of terms[i] (or NULL), as returned by
+ *     read_in_terms_with_attrs(); the strings are copied.
+ *   - Builds one roaring bitmap per distinct value in a single pass over
+ *     the terms, so every bitmap receives its ids in ascending order.
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *idx = NULL.
+ */
+void build_attr_index(struct attr_index **idx, struct term *terms, int nterms, char **attrs)
+{
+    build_attr_index_arena(idx, terms, nterms, attrs, NULL);
+}
+
+/*
+ * build_attr_index_arena():
+ *   - build_attr_index() allocating the index from arena (malloc if NULL).
+ *     Bitmaps grow on the heap and move into the arena once complete.
+ */
+void build_attr_index_arena(struct attr_index **idx, struct term *terms, int nterms, char **attrs,
+                            struct arena *arena)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0 || !attrs) {
+        return;
+    }
+
+    struct attr_index *a = arena_calloc(arena, 1, sizeof(struct attr_index));
+    char **sorted = malloc(sizeof(char *) * nterms);
+    if (!a || !sorted) {
+        fprintf(stderr, "Error: Could not allocate memory for attribute index.\n");
+        arena_free(arena, a);
+        free(sorted);
+        return;
+    }
+    a->arena = arena;
+    a->terms = terms;
+    a->nterms = nterms;
+
+    int n = 0;
+    for (int i = 0; i < nterms; i++) {
+        if (attrs[i]) {
+            sorted[n++] = attrs[i];
+        }
+    }
+    qsort(sorted, n, sizeof(char *), compare_string);
+
+    int nvalues = 0;
+    for (int i = 0; i < n; i++) {
+        if (nvalues == 0 || strcmp(sorted[i], sorted[nvalues - 1]) != 0) {
+            sorted[nvalues++] = sorted[i];
+        }
+    }
+
+    int failed = 0;
+    a->values = arena_calloc(arena, nvalues > 0 ? nvalues : 1, sizeof(char *));
+    a->bitmaps = arena_calloc(arena, nvalues > 0 ? nvalues : 1, sizeof(struct roaring));
+    failed = !a->values || !a->bitmaps;
+    for (int v = 0; v < nvalues && !failed; v++) {
+        size_t len = strlen(sorted[v]);
+        a->values[v] = arena_alloc(arena, len + 1);
+        failed = !a->values[v];
+        if (!failed) {
+            memcpy(a->values[v], sorted[v], len + 1);
+            a->nvalues++;
+        }
+    }
+    free(sorted);
+
+    for (int i = 0; i < nterms && !failed; i++) {
+        if (attrs[i]) {
+            int v = find_value(a, attrs[i]);
+            failed = roaring_append(&a->bitmaps[v], i) != 0;
+        }
+    }
+    int moved = 0;
+    while (moved < a->nvalues && !failed) {
+        failed = roaring_to_arena(&a->bitmaps[moved], arena) != 0;
+        moved += !failed;
+    }
+
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for attribute index.\n");
+        for (int v = moved; arena && v < a->nvalues; v++) {
+            free_roaring(&a->bitmaps[v], NULL);   // still on the heap
+        }
+        free_attr_index(a);
+        return;
+    }
+    *idx = a;
+}
+
+typedef struct filter_ctx{
+    const struct roaring *bitmap;
+    const struct term *terms;
+    const int *members;
+} filter_ctx;
+
+// Keeps positions whose term carries the value, rejects the others
+static int filter_id(const void *ctx, int i)
+{
+    return roaring_contains(((const filter_ctx *)ctx)->bitmap, i) ? i : -1;
+}
+
+static double member_weight(const void *ctx, int i)
+{
+    const filter_ctx *f = (const filter_ctx *)ctx;
+    return f->terms[f->members[i]].weight;
+}
+
+/*
+ * filtered_autocomplete():
+ *   - Returns the k heaviest terms starting with substr whose attribute
+ *     equals value, best first.
+ *
+ * Approach:
+ *   - The prefix range [lo, hi) comes from prefix_range(); two rank queries
+ *     on the value's bitmap give how many of those terms carry the value.
+ *   - If matches are dense enough that about k * (hi - lo) / count probes
+ *     beat visiting all count matches, and rm is given, the usual range_max
+ *     top-k runs with a bitmap membership test on every candidate.
+ *   - Otherwise the bitmap's ids in [lo, hi) are enumerated container by
+ *     container and fed to a bounded heap.
+ *   - Either way the cost tracks an unfiltered query over the same range.
+ *
+ * Edge cases:
+ *   - Unknown value, no match or k <= 0: sets *answer = NULL, *n_answer = 0.
+ */
+void filtered_autocomplete(struct term **answer, int *n_answer, const struct attr_index *idx,
+                           const struct range_max *rm, const char *substr,
+                           const char *value, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!idx || !value || k <= 0) {
+        return;
+    }
+
+    int v = find_value(idx, value);
+    int lo, hi;
+    if (v < 0 || prefix_range(idx->terms, idx->nterms, substr, &lo, &hi) == 0) {
+        return;
+    }
+    const struct roaring *bitmap = &idx->bitmaps[v];
+    int count = roaring_rank(bitmap, hi) - roaring_rank(bitmap, lo);
+    if (count == 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int use_rm = rm && (double)k * (hi - lo) < (double)count * count;
+    int *ids = malloc(sizeof(int) * k);
+    int *members = use_rm ? NULL : malloc(sizeof(int) * count);
+    if (!ids || (!use_rm && !members)) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(ids);
+        free(members);
+        return;
+    }
+
+    filter_ctx ctx = { bitmap, idx->terms, members };
+    if (use_rm) {
+        k = top_k_ranges(rm, &lo, &hi, 1, k, filter_id, &ctx, ids);
+    } else {
+        roaring_collect(bitmap, lo, hi, members);
+        k = top_k_scan(0, count, k, member_weight, &ctx, ids);
+        for (int i = 0; i < k; i++) {
+            ids[i] = members[ids[i]];
+        }
+    }
+    terms_from_ids(answer, n_answer, idx->terms, ids, k);
+    free(ids);
+    free(members);
+}
+
+void free_attr_index(struct attr_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    for (int v = 0; v < idx->nvalues; v++) {
+        arena_free(idx->arena, idx->values[v]);
+        free_roaring(&idx->bitmaps[v], idx->arena);
+    }
+    arena_free(idx->arena, idx->values);
+    arena_free(idx->arena, idx->bitmaps);
+    arena_free(idx->arena, idx);
+}
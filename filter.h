@@ -0,0 +1,57 @@
+#if !defined(FILTER_H)
+#define FILTER_H
+
+#include <stdint.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+// Containers with more ids than this switch from a sorted array to a bitmap.
+#define ROARING_ARRAY_MAX 4096
+
+/*
+ * One 65536-id chunk of a roaring bitmap: ids sharing the high 16 bits.
+ * Sparse chunks are a sorted array of the low 16 bits (2 bytes per id),
+ * dense chunks a fixed 8 KB bitmap; both are never larger than 8 KB.
+ */
+typedef struct roaring_container{
+    uint16_t key;       // high 16 bits shared by the ids
+    int card;           // number of ids in this container
+    int rank;           // number of ids in all earlier containers
+    int cap;            // allocated slots of array (build time only)
+    uint16_t *array;    // sorted low bits, when card <= ROARING_ARRAY_MAX
+    uint64_t *bits;     // 65536-bit bitmap otherwise
+} roaring_container;
+
+typedef struct roaring{
+    int ncontainers;
+    int cap;
+    int card;
+    struct roaring_container *c;  // ordered by key
+} roaring;
+
+int roaring_contains(const struct roaring *r, int id);
+int roaring_rank(const struct roaring *r, int id);
+
+/*
+ * Bitmap per distinct attribute value over term positions, built in
+ * read_in_terms() order. Filtering a prefix query intersects the value's
+ * bitmap with the prefix's [lo, hi) range during top-k selection.
+ */
+typedef struct attr_index{
+    int nvalues;
+    char **values;            // distinct values, sorted
+    struct roaring *bitmaps;  // terms carrying values[v]
+    struct term *terms;
+    int nterms;
+    struct arena *arena;      // where the index lives, NULL for the heap
+} attr_index;
+
+void build_attr_index(struct attr_index **idx, struct term *terms, int nterms, char **attrs);
+void build_attr_index_arena(struct attr_index **idx, struct term *terms, int nterms, char **attrs,
+                            struct arena *arena);
+void filtered_autocomplete(struct term **answer, int *n_answer, const struct attr_index *idx,
+                           const struct range_max *rm, const char *substr,
+                           const char *value, int k);
+void free_attr_index(struct attr_index *idx);
+
+#endif
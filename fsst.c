@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fsst.h"
+#include "arena.h"
+
+#define NTOKENS 512   // parse tokens: symbols 0..254, literal byte b is 256 + b
+
+/*
+ * Symbols grouped by first byte, longest first, so the greedy parser tries
+ * the longest candidate first: ids order[start[b] .. start[b + 1]).
+ */
+typedef struct symbol_index{
+    unsigned char order[FSST_MAX_SYMBOLS];
+    int start[257];
+} symbol_index;
+
+typedef struct candidate{
+    unsigned char bytes[FSST_SYMBOL_LEN];
+    int len;
+    long gain;
+} candidate;
+
+static const struct fsst_store *sort_store;   // for compare_first_byte (qsort has no context)
+
+static int compare_first_byte(const void *a, const void *b)
+{
+    int x = *(const unsigned char *)a;
+    int y = *(const unsigned char *)b;
+    if (sort_store->symbol[x][0] != sort_store->symbol[y][0]) {
+        return sort_store->symbol[x][0] - sort_store->symbol[y][0];
+    }
+    return sort_store->symbol_len[y] - sort_store->symbol_len[x];
+}
+
+static void index_symbols(const struct fsst_store *fs, struct symbol_index *idx)
+{
+    for (int s = 0; s < fs->nsymbols; s++) {
+        idx->order[s] = (unsigned char)s;
+    }
+    sort_store = fs;
+    qsort(idx->order, fs->nsymbols, 1, compare_first_byte);
+    sort_store = NULL;
+
+    int s = 0;
+    for (int b = 0; b <= 256; b++) {
+        while (b < 256 && s < fs->nsymbols && fs->symbol[idx->order[s]][0] < b) {
+            s++;
+        }
+        idx->start[b] = s;
+    }
+}
+
+/*
+ * Greedy step: the longest symbol matching s (len bytes left), else a
+ * literal. Sets *token and returns the number of bytes consumed.
+ */
+static int next_token(const struct fsst_store *fs, const struct symbol_index *idx,
+                      const unsigned char *s, size_t len, int *token)
+{
+    for (int j = idx->start[s[0]]; j < idx->start[s[0] + 1]; j++) {
+        int id = idx->order[j];
+        size_t slen = fs->symbol_len[id];
+        if (slen <= len && memcmp(fs->symbol[id], s, slen) == 0) {
+            *token = id;
+            return (int)slen;
+        }
+    }
+    *token = 256 + s[0];
+    return 1;
+}
+
+static void token_bytes(const struct fsst_store *fs, int token, unsigned char *bytes, int *len)
+{
+    if (token >= 256) {
+        bytes[0] = (unsigned char)(token - 256);
+        *len = 1;
+    } else {
+        memcpy(bytes, fs->symbol[token], fs->symbol_len[token]);
+        *len = fs->symbol_len[token];
+    }
+}
+
+static int compare_candidate_bytes(const void *a, const void *b)
+{
+    const struct candidate *x = (const struct candidate *)a;
+    const struct candidate *y = (const struct candidate *)b;
+    if (x->len != y->len) return x->len - y->len;
+    int cmp = memcmp(x->bytes, y->bytes, x->len);
+    if (cmp != 0) return cmp;
+    return (x->gain < y->gain) - (x->gain > y->gain);   // larger gain first
+}
+
+static int compare_candidate_gain(const void *a, const void *b)
+{
+    const struct candidate *x = (const struct candidate *)a;
+    const struct candidate *y = (const struct candidate *)b;
+    if (x->gain != y->gain) return x->gain < y->gain ? 1 : -1;
+    if (x->len != y->len) return y->len - x->len;
+    return memcmp(x->bytes, y->bytes, x->len);
+}
+
+/*
+ * FSST training: parse the sample with the current table, count every
+ * token and every pair of adjacent tokens, and keep the 255 candidates
+ * (tokens and concatenated pairs of up to 8 bytes) that cover the most
+ * bytes. A few rounds let useful symbols grow by merging.
+ * Returns 0, or -1 if memory could not be allocated.
+ */
+static int train(struct fsst_store *fs, struct term *terms, int nterms)
+{
+    long *count1 = calloc(NTOKENS, sizeof(long));
+    long *count2 = calloc((size_t)NTOKENS * NTOKENS, sizeof(long));
+    struct candidate *cands = malloc(sizeof(struct candidate) * ((size_t)NTOKENS * NTOKENS + NTOKENS));
+    if (!count1 || !count2 || !cands) {
+        free(count1);
+        free(count2);
+        free(cands);
+        return -1;
+    }
+    int step = nterms > FSST_SAMPLE ? nterms / FSST_SAMPLE : 1;
+
+    fs->nsymbols = 0;
+    for (int round = 0; round < FSST_ROUNDS; round++) {
+        struct symbol_index idx;
+        index_symbols(fs, &idx);
+        memset(count1, 0, sizeof(long) * NTOKENS);
+        memset(count2, 0, sizeof(long) * NTOKENS * NTOKENS);
+
+        for (int i = 0; i < nterms; i += step) {
+            const unsigned char *s = (const unsigned char *)terms[i].term;
+            size_t len = strlen(terms[i].term);
+            int prev = -1;
+            while (len > 0) {
+                int token;
+                int used = next_token(fs, &idx, s, len, &token);
+                count1[token]++;
+                if (prev >= 0) {
+                    count2[(size_t)prev * NTOKENS + token]++;
+                }
+                prev = token;
+                s += used;
+                len -= (size_t)used;
+            }
+        }
+
+        int ncands = 0;
+        for (int a = 0; a < NTOKENS; a++) {
+            if (count1[a] == 0) {
+                continue;
+            }
+            struct candidate *c = &cands[ncands++];
+            token_bytes(fs, a, c->bytes, &c->len);
+            // A one-byte symbol only saves its escape byte
+            c->gain = count1[a] * c->len;
+            for (int b = 0; b < NTOKENS; b++) {
+                long n = count2[(size_t)a * NTOKENS + b];
+                if (n == 0) {
+                    continue;
+                }
+                unsigned char bytes[FSST_SYMBOL_LEN];
+                int blen;
+                token_bytes(fs, b, bytes, &blen);
+                if (c->len + blen > FSST_SYMBOL_LEN) {
+                    continue;
+                }
+                struct candidate *m = &cands[ncands++];
+                memcpy(m->bytes, c->bytes, c->len);
+                memcpy(m->bytes + c->len, bytes, blen);
+                m->len = c->len + blen;
+                m->gain = n * m->len;
+            }
+        }
+
+        // The same string can come from several parses: keep its best gain
+        qsort(cands, ncands, sizeof(struct candidate), compare_candidate_bytes);
+        int unique = 0;
+        for (int c = 0; c < ncands; c++) {
+            if (unique > 0 && cands[c].len == cands[unique - 1].len
+                && memcmp(cands[c].bytes, cands[unique - 1].bytes, cands[c].len) == 0) {
+                continue;
+            }
+            cands[unique++] = cands[c];
+        }
+        qsort(cands, unique, sizeof(struct candidate), compare_candidate_gain);
+
+        fs->nsymbols = unique < FSST_MAX_SYMBOLS ? unique : FSST_MAX_SYMBOLS;
+        for (int s = 0; s < fs->nsymbols; s++) {
+            memcpy(fs->symbol[s], cands[s].bytes, cands[s].len);
+            fs->symbol_len[s] = (unsigned char)cands[s].len;
+        }
+    }
+
+    free(count1);
+    free(count2);
+    free(cands);
+    return 0;
+}
+
+/*
+ * build_fsst_store():
+ *   - Trains a symbol table on the sorted terms (a sample of FSST_SAMPLE
+ *     terms on large inputs) and encodes every term with it; the caller
+ *     may free the term array afterwards.
+ *
+ * Edge cases addressed:
+ *   - On failure prints an error and sets *fs = NULL.
+ */
+void build_fsst_store(struct fsst_store **fs, struct term *terms, int nterms)
+{
+    build_fsst_store_arena(fs, terms, nterms, NULL);
+}
+
+/*
+ * build_fsst_store_arena():
+ *   - build_fsst_store() with the store allocated from arena (malloc if
+ *     NULL). The codes are encoded into a growing heap buffer and copied
+ *     into the arena at their final size.
+ */
+void build_fsst_store_arena(struct fsst_store **fs, struct term *terms, int nterms,
+                            struct arena *arena)
+{
+    *fs = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    struct fsst_store *f = arena_calloc(arena, 1, sizeof(struct fsst_store));
+    if (f) {
+        f->arena = arena;
+        f->code_off = arena_alloc(arena, sizeof(int) * (nterms + 1));
+        f->weight = arena_alloc(arena, sizeof(double) * nterms);
+    }
+    if (!f || !f->code_off || !f->weight || train(f, terms, nterms) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for compressed terms.\n");
+        free_fsst_store(f);
+        return;
+    }
+    f->n = nterms;
+
+    struct symbol_index idx;
+    index_symbols(f, &idx);
+    unsigned char *codes = NULL;
+    size_t used = 0, cap = 0;
+    for (int i = 0; i < nterms; i++) {
+        const unsigned char *s = (const unsigned char *)terms[i].term;
+        size_t len = strlen(terms[i].term);
+        if (used + 2 * len > cap) {
+            size_t new_cap = cap ? cap * 2 : 4096;
+            while (used + 2 * len > new_cap) {
+                new_cap *= 2;
+            }
+            unsigned char *grown = realloc(codes, new_cap);
+            if (!grown) {
+                fprintf(stderr, "Error: Could not allocate memory for compressed terms.\n");
+                free(codes);
+                free_fsst_store(f);
+                return;
+            }
+            codes = grown;
+            cap = new_cap;
+        }
+
+        f->code_off[i] = (int)used;
+        while (len > 0) {
+            int token;
+            int n = next_token(f, &idx, s, len, &token);
+            if (token >= 256) {
+                codes[used++] = FSST_ESCAPE;
+                codes[used++] = (unsigned char)(token - 256);
+            } else {
+                codes[used++] = (unsigned char)token;
+            }
+            s += n;
+            len -= (size_t)n;
+        }
+        f->weight[i] = terms[i].weight;
+    }
+    f->code_off[nterms] = (int)used;
+
+    if (arena) {
+        f->codes = arena_alloc(arena, used > 0 ? used : 1);
+        if (f->codes) {
+            memcpy(f->codes, codes, used);
+        }
+        free(codes);
+    } else {
+        unsigned char *shrunk = realloc(codes, used > 0 ? used : 1);
+        f->codes = shrunk ? shrunk : codes;     // else keep the larger buffer
+    }
+    if (!f->codes) {
+        fprintf(stderr, "Error: Could not allocate memory for compressed terms.\n");
+        free_fsst_store(f);
+        return;
+    }
+    *fs = f;
+}
+
+/*
+ * fsst_decode():
+ *   - Writes term i to out (cap bytes, NUL-terminated, truncated if needed)
+ *     and returns its length.
+ */
+size_t fsst_decode(const struct fsst_store *fs, int i, char *out, size_t cap)
+{
+    size_t len = 0;
+    if (cap == 0) {
+        return 0;
+    }
+    const unsigned char *c = fs->codes + fs->code_off[i];
+    const unsigned char *end = fs->codes + fs->code_off[i + 1];
+    while (c < end) {
+        const unsigned char *bytes;
+        size_t n;
+        if (*c == FSST_ESCAPE) {
+            bytes = c + 1;
+            n = 1;
+            c += 2;
+        } else {
+            bytes = fs->symbol[*c];
+            n = fs->symbol_len[*c];
+            c++;
+        }
+        if (len + n > cap - 1) {
+            n = cap - 1 - len;
+        }
+        memcpy(out + len, bytes, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+double fsst_weight(const void *ctx, int i)
+{
+    return ((const struct fsst_store *)ctx)->weight[i];
+}
+
+/*
+ * strncmp() of the first m bytes of term i against prefix, decoding one
+ * symbol at a time and stopping at the first difference; nothing is
+ * decompressed into a buffer.
+ */
+static int compare_prefix(const struct fsst_store *fs, int i, const char *prefix, size_t m)
+{
+    const unsigned char *c = fs->codes + fs->code_off[i];
+    const unsigned char *end = fs->codes + fs->code_off[i + 1];
+    const unsigned char *p = (const unsigned char *)prefix;
+    size_t j = 0;
+    while (j < m) {
+        if (c == end) {
+            return -1;   // the term is a proper prefix of prefix
+        }
+        const unsigned char *bytes;
+        size_t n;
+        if (*c == FSST_ESCAPE) {
+            bytes = c + 1;
+            n = 1;
+            c += 2;
+        } else {
+            bytes = fs->symbol[*c];
+            n = fs->symbol_len[*c];
+            c++;
+        }
+        if (n > m - j) {
+            n = m - j;
+        }
+        int cmp = memcmp(bytes, p + j, n);
+        if (cmp != 0) {
+            return cmp;
+        }
+        j += n;
+    }
+    return 0;
+}
+
+/*
+ * fsst_prefix_range():
+ *   - Sets [*lo, *hi) to the terms starting with prefix and returns their
+ *     number, comparing directly against the compressed terms (an empty
+ *     prefix matches nothing, as in prefix_range()).
+ */
+int fsst_prefix_range(const struct fsst_store *fs, const char *prefix, int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (!fs || !prefix || prefix[0] == '\0') {
+        return 0;
+    }
+    size_t m = strlen(prefix);
+
+    int left = 0, right = fs->n;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (compare_prefix(fs, mid, prefix, m) < 0) left = mid + 1;
+        else right = mid;
+    }
+    *lo = left;
+    right = fs->n;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (compare_prefix(fs, mid, prefix, m) <= 0) left = mid + 1;
+        else right = mid;
+    }
+    *hi = left;
+    return *hi - *lo;
+}
+
+/*
+ * fsst_autocomplete():
+ *   - Returns the k heaviest terms starting with substr, best first;
+ *     only those k terms are decompressed.
+ *   - rm is an optional range_max built with fsst_weight().
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void fsst_autocomplete(struct term **answer, int *n_answer, const struct fsst_store *fs,
+                       const struct range_max *rm, const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = fsst_prefix_range(fs, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = rm ? top_k_ranges(rm, &lo, &hi, 1, k, NULL, NULL, ids)
+           : top_k_scan(lo, hi, k, fsst_weight, fs, ids);
+    if (k > 0) {
+        *answer = malloc(sizeof(struct term) * k);
+        if (!(*answer)) {
+            fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        } else {
+            for (int i = 0; i < k; i++) {
+                fsst_decode(fs, ids[i], (*answer)[i].term, sizeof((*answer)[i].term));
+                (*answer)[i].weight = fs->weight[ids[i]];
+            }
+            *n_answer = k;
+        }
+    }
+    free(ids);
+}
+
+size_t fsst_memory(const struct fsst_store *fs)
+{
+    if (!fs) {
+        return 0;
+    }
+    return sizeof(*fs) + (size_t)fs->code_off[fs->n]
+         + (size_t)fs->n * (sizeof(int) + sizeof(double)) + sizeof(int);
+}
+
+void free_fsst_store(struct fsst_store *fs)
+{
+    if (!fs) {
+        return;
+    }
+    arena_free(fs->arena, fs->codes);
+    arena_free(fs->arena, fs->code_off);
+    arena_free(fs->arena, fs->weight);
+    arena_free(fs->arena, fs);
+}
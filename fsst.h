@@ -0,0 +1,45 @@
+#if !defined(FSST_H)
+#define FSST_H
+
+#include <stddef.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+// Symbol table limits: codes 0..254 are symbols, FSST_ESCAPE marks a literal byte.
+#define FSST_MAX_SYMBOLS 255
+#define FSST_SYMBOL_LEN 8
+#define FSST_ESCAPE 255
+// Training rounds and the number of terms sampled for training.
+#define FSST_ROUNDS 5
+#define FSST_SAMPLE 16384
+
+/*
+ * Term text compressed with a static table of up to 255 frequent 1-8 byte
+ * substrings ("Fast Static Symbol Table"): every term is a run of one-byte
+ * codes, a code standing for its symbol's bytes, or FSST_ESCAPE followed by
+ * a literal byte. The table is trained on the loaded terms, which keep the
+ * order and positions of the sorted array they were built from.
+ */
+typedef struct fsst_store{
+    int n;
+    int nsymbols;
+    unsigned char symbol[FSST_MAX_SYMBOLS][FSST_SYMBOL_LEN];
+    unsigned char symbol_len[FSST_MAX_SYMBOLS];
+    unsigned char *codes;   // all encoded terms back to back
+    int *code_off;          // term i is codes[code_off[i] .. code_off[i + 1])
+    double *weight;
+    struct arena *arena;    // where the store lives, NULL for the heap
+} fsst_store;
+
+void build_fsst_store(struct fsst_store **fs, struct term *terms, int nterms);
+void build_fsst_store_arena(struct fsst_store **fs, struct term *terms, int nterms,
+                            struct arena *arena);
+size_t fsst_decode(const struct fsst_store *fs, int i, char *out, size_t cap);
+double fsst_weight(const void *ctx, int i);
+int fsst_prefix_range(const struct fsst_store *fs, const char *prefix, int *lo, int *hi);
+void fsst_autocomplete(struct term **answer, int *n_answer, const struct fsst_store *fs,
+                       const struct range_max *rm, const char *substr, int k);
+size_t fsst_memory(const struct fsst_store *fs);
+void free_fsst_store(struct fsst_store *fs);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * Generator for compiled-in dictionaries (see static_dict.h):
+ *
+ *   ./gen_static terms_file output.c [name]
+ *
+ * reads and sorts terms_file once, builds its range_max and weight sums,
+ * and writes them to output.c as const data defining
+ * `const struct static_dictionary name` (default "static_dict"): the terms
+ * as one string pool with offsets, a weight column, the range_max tree and
+ * the sums.
+ */
+
+#define VALUES_PER_LINE 8
+
+static int valid_identifier(const char *s)
+{
+    if (!isalpha((unsigned char)s[0]) && s[0] != '_') {
+        return 0;
+    }
+    for (; *s; s++) {
+        if (!isalnum((unsigned char)*s) && *s != '_') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Writes s as a C string literal; other than printable ASCII becomes a 3-digit octal escape.
+static void write_literal(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(fp, "\\%c", *p);
+        } else if (*p < 0x20 || *p >= 0x7f || *p == '?') {
+            fprintf(fp, "\\%03o", *p);   // '?' too, so no trigraph can form
+        } else {
+            fputc(*p, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static int write_source(FILE *fp, const char *source, const char *name,
+                        struct term *terms, int nterms, const struct range_max *rm,
+                        const double *sums)
+{
+    fprintf(fp, "/* Generated by gen_static from %s (%d terms). Do not edit. */\n", source, nterms);
+    fprintf(fp, "#include \"static_dict.h\"\n\n");
+
+    // One NUL-ended literal per term, concatenated into the pool
+    long pool_size = 0;
+    for (int i = 0; i < nterms; i++) {
+        pool_size += (long)strlen(terms[i].term) + 1;
+    }
+    fprintf(fp, "static const char pool[%ld] =\n", pool_size);
+    for (int i = 0; i < nterms; i++) {
+        fprintf(fp, "    ");
+        write_literal(fp, terms[i].term);
+        fprintf(fp, " \"\\0\"%s\n", i + 1 < nterms ? "" : ";");
+    }
+    fprintf(fp, "\n");
+
+    fprintf(fp, "static const int offsets[%d] = {", nterms);
+    long off = 0;
+    for (int i = 0; i < nterms; i++) {
+        fprintf(fp, "%s%ld,", i % VALUES_PER_LINE ? " " : "\n    ", off);
+        off += (long)strlen(terms[i].term) + 1;
+    }
+    fprintf(fp, "\n};\n\n");
+
+    fprintf(fp, "static const double weights[%d] = {", nterms);
+    for (int i = 0; i < nterms; i++) {
+        fprintf(fp, "%s%.17g,", i % VALUES_PER_LINE ? " " : "\n    ", terms[i].weight);
+    }
+    fprintf(fp, "\n};\n\n");
+
+    fprintf(fp, "static const int tree[%d] = {", 2 * rm->size);
+    for (int i = 0; i < 2 * rm->size; i++) {
+        fprintf(fp, "%s%d,", i % VALUES_PER_LINE ? " " : "\n    ", rm->tree[i]);
+    }
+    fprintf(fp, "\n};\n\n");
+
+    fprintf(fp, "static const double sums[%d] = {", nterms + 1);
+    for (int i = 0; i <= nterms; i++) {
+        fprintf(fp, "%s%.17g,", i % VALUES_PER_LINE ? " " : "\n    ", sums[i]);
+    }
+    fprintf(fp, "\n};\n\n");
+
+    fprintf(fp, "static double weight(const void *ctx, int i)\n{\n"
+                "    return ((const double *)ctx)[i];\n}\n\n");
+    fprintf(fp, "const struct static_dictionary %s = {\n", name);
+    fprintf(fp, "    .pool = pool,\n"
+                "    .offsets = offsets,\n"
+                "    .weights = weights,\n"
+                "    .nterms = %d,\n", nterms);
+    fprintf(fp, "    .rm = {\n"
+                "        .n = %d,\n"
+                "        .nblocks = %d,\n"
+                "        .size = %d,\n"
+                "        .tree = (int *)tree,\n"
+                "        .value = weight,\n"
+                "        .ctx = weights,\n"
+                "        .arena = NULL,\n"
+                "    },\n", rm->n, rm->nblocks, rm->size);
+    fprintf(fp, "    .sums = sums,\n};\n");
+    return ferror(fp) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s terms_file output.c [name]\n", argv[0]);
+        return 1;
+    }
+    const char *name = argc == 4 ? argv[3] : "static_dict";
+    if (!valid_identifier(name)) {
+        fprintf(stderr, "Error: %s is not a valid C identifier.\n", name);
+        return 1;
+    }
+
+    struct term *terms;
+    int nterms;
+    read_in_terms(&terms, &nterms, argv[1]);
+    if (!terms) {
+        return 1;
+    }
+    struct range_max rm;
+    double *sums;
+    if (build_term_range_max(&rm, terms, nterms) != 0) {
+        free(terms);
+        return 1;
+    }
+    build_weight_sums(&sums, terms, nterms);
+    if (!sums) {
+        free_range_max(&rm);
+        free(terms);
+        return 1;
+    }
+
+    FILE *fp = fopen(argv[2], "w");
+    int result = 1;
+    if (!fp) {
+        fprintf(stderr, "Error: Could not create %s.\n", argv[2]);
+    } else {
+        int ok = write_source(fp, argv[1], name, terms, nterms, &rm, sums) == 0;
+        if (fclose(fp) != 0 || !ok) {
+            fprintf(stderr, "Error: Could not write %s.\n", argv[2]);
+        } else {
+            result = 0;
+        }
+    }
+    free(sums);
+    free_range_max(&rm);
+    free(terms);
+    return result;
+}
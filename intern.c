@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "arena.h"
+
+/*
+ * Candidate tail: the suffix of terms[term].term starting at off.
+ */
+typedef struct tail_slot{
+    int term, off;      // term == -1 for an empty slot
+    int count;          // terms ending with this suffix
+    int id;             // tail id once chosen, -1 before
+} tail_slot;
+
+static unsigned hash_string(const char *s)
+{
+    unsigned h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static struct tail_slot *find_slot(struct tail_slot *slots, unsigned mask,
+                                   const struct term *terms, const char *s)
+{
+    unsigned h = hash_string(s) & mask;
+    while (slots[h].term != -1 && strcmp(terms[slots[h].term].term + slots[h].off, s) != 0) {
+        h = (h + 1) & mask;
+    }
+    return &slots[h];
+}
+
+/*
+ * build_interned_terms():
+ *   - Builds the head + tail store from the sorted terms array, which the
+ *     caller may free afterwards.
+ *
+ * Approach:
+ *   - Every suffix starting at ", " is counted in a hash table, then each
+ *     term takes its longest suffix shared by INTERN_MIN_SHARED terms as
+ *     its tail and keeps the rest as its head.
+ *
+ * Edge cases addressed:
+ *   - Terms without a shared suffix are stored whole as their head.
+ *   - On failure prints an error and sets *it = NULL.
+ */
+void build_interned_terms(struct interned_terms **it, struct term *terms, int nterms)
+{
+    build_interned_terms_arena(it, terms, nterms, NULL);
+}
+
+/*
+ * Copies a store built on the heap into arena, every array at its exact
+ * size. Returns NULL if the arena is out of memory.
+ */
+static struct interned_terms *interned_to_arena(const struct interned_terms *t, struct arena *arena)
+{
+    struct interned_terms *m = arena_alloc(arena, sizeof(struct interned_terms));
+    if (!m) {
+        return NULL;
+    }
+    *m = *t;
+    m->arena = arena;
+    m->heads = arena_alloc(arena, t->heads_len);
+    m->head_off = arena_alloc(arena, sizeof(int) * t->n);
+    m->tail = arena_alloc(arena, sizeof(int) * t->n);
+    m->weight = arena_alloc(arena, sizeof(double) * t->n);
+    m->tails = t->ntails > 0 ? arena_alloc(arena, t->tails_len) : NULL;
+    m->tail_off = t->ntails > 0 ? arena_alloc(arena, sizeof(int) * t->ntails) : NULL;
+    if (!m->heads || !m->head_off || !m->tail || !m->weight
+        || (t->ntails > 0 && (!m->tails || !m->tail_off))) {
+        return NULL;
+    }
+    memcpy(m->heads, t->heads, t->heads_len);
+    memcpy(m->head_off, t->head_off, sizeof(int) * t->n);
+    memcpy(m->tail, t->tail, sizeof(int) * t->n);
+    memcpy(m->weight, t->weight, sizeof(double) * t->n);
+    if (t->ntails > 0) {
+        memcpy(m->tails, t->tails, t->tails_len);
+        memcpy(m->tail_off, t->tail_off, sizeof(int) * t->ntails);
+    }
+    return m;
+}
+
+/*
+ * build_interned_terms_arena():
+ *   - build_interned_terms() with the store allocated from arena (malloc
+ *     if NULL). It is built on the heap, where its tails can grow, and
+ *     copied into the arena at its final size.
+ */
+void build_interned_terms_arena(struct interned_terms **it, struct term *terms, int nterms,
+                                struct arena *arena)
+{
+    *it = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    int ncand = 0;
+    size_t text = 0;
+    for (int i = 0; i < nterms; i++) {
+        const char *s = terms[i].term;
+        text += strlen(s) + 1;
+        for (const char *p = strstr(s, ", "); p; p = strstr(p + 1, ", ")) {
+            ncand++;
+        }
+    }
+    unsigned nslots = 16;
+    while (nslots < 2u * (unsigned)ncand) {
+        nslots *= 2;
+    }
+
+    struct interned_terms *t = calloc(1, sizeof(struct interned_terms));
+    struct tail_slot *slots = malloc(sizeof(struct tail_slot) * nslots);
+    if (t) {
+        t->heads = malloc(text);
+        t->head_off = malloc(sizeof(int) * nterms);
+        t->tail = malloc(sizeof(int) * nterms);
+        t->weight = malloc(sizeof(double) * nterms);
+    }
+    if (!t || !slots || !t->heads || !t->head_off || !t->tail || !t->weight) {
+        fprintf(stderr, "Error: Could not allocate memory for interned terms.\n");
+        free(slots);
+        free_interned_terms(t);
+        return;
+    }
+    t->n = nterms;
+    for (unsigned h = 0; h < nslots; h++) {
+        slots[h].term = -1;
+    }
+
+    for (int i = 0; i < nterms; i++) {
+        const char *s = terms[i].term;
+        for (const char *p = strstr(s, ", "); p; p = strstr(p + 1, ", ")) {
+            struct tail_slot *slot = find_slot(slots, nslots - 1, terms, p);
+            if (slot->term == -1) {
+                slot->term = i;
+                slot->off = (int)(p - s);
+                slot->count = 0;
+                slot->id = -1;
+            }
+            slot->count++;
+        }
+    }
+
+    size_t tails_cap = 0;
+    int ids_cap = 0;
+    int failed = 0;
+    for (int i = 0; i < nterms && !failed; i++) {
+        const char *s = terms[i].term;
+        size_t head_len = strlen(s);
+        t->tail[i] = -1;
+        // The first separator gives the longest suffix
+        for (const char *p = strstr(s, ", "); p; p = strstr(p + 1, ", ")) {
+            struct tail_slot *slot = find_slot(slots, nslots - 1, terms, p);
+            if (slot->count < INTERN_MIN_SHARED) {
+                continue;
+            }
+            if (slot->id == -1) {
+                size_t len = strlen(p) + 1;
+                if (t->ntails == ids_cap) {
+                    ids_cap = ids_cap ? ids_cap * 2 : 64;
+                    int *offs = realloc(t->tail_off, sizeof(int) * ids_cap);
+                    if (!offs) {
+                        failed = 1;
+                        break;
+                    }
+                    t->tail_off = offs;
+                }
+                while (t->tails_len + len > tails_cap) {
+                    tails_cap = tails_cap ? tails_cap * 2 : 4096;
+                    char *pool = realloc(t->tails, tails_cap);
+                    if (!pool) {
+                        failed = 1;
+                        break;
+                    }
+                    t->tails = pool;
+                }
+                if (failed) {
+                    break;
+                }
+                memcpy(t->tails + t->tails_len, p, len);
+                t->tail_off[t->ntails] = (int)t->tails_len;
+                t->tails_len += len;
+                slot->id = t->ntails++;
+            }
+            t->tail[i] = slot->id;
+            head_len = (size_t)(p - s);
+            break;
+        }
+        memcpy(t->heads + t->heads_len, s, head_len);
+        t->heads[t->heads_len + head_len] = '\0';
+        t->head_off[i] = (int)t->heads_len;
+        t->heads_len += head_len + 1;
+        t->weight[i] = terms[i].weight;
+    }
+    free(slots);
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for interned terms.\n");
+        free_interned_terms(t);
+        return;
+    }
+
+    // Give back what the upper-bound allocations did not use
+    char *heads = realloc(t->heads, t->heads_len);
+    if (heads) {
+        t->heads = heads;
+    }
+    if (t->tails_len > 0) {
+        char *tails = realloc(t->tails, t->tails_len);
+        if (tails) {
+            t->tails = tails;
+        }
+    }
+    if (arena) {
+        struct interned_terms *moved = interned_to_arena(t, arena);
+        free_interned_terms(t);
+        if (!moved) {
+            fprintf(stderr, "Error: Could not allocate memory for interned terms.\n");
+            return;
+        }
+        t = moved;
+    }
+    *it = t;
+}
+
+/*
+ * read_in_interned():
+ *   - Reads filename with read_in_terms() and keeps only the interned
+ *     form; the full term array is freed before returning.
+ */
+void read_in_interned(struct interned_terms **it, char *filename)
+{
+    read_in_interned_arena(it, NULL, filename);
+}
+
+/*
+ * read_in_interned_arena():
+ *   - read_in_interned() with the store allocated from arena (malloc if
+ *     NULL); the full term array is temporary heap memory.
+ */
+void read_in_interned_arena(struct interned_terms **it, struct arena *arena, char *filename)
+{
+    struct term *terms;
+    int nterms;
+    *it = NULL;
+    read_in_terms(&terms, &nterms, filename);
+    if (!terms) {
+        return;
+    }
+    build_interned_terms_arena(it, terms, nterms, arena);
+    free(terms);
+}
+
+/*
+ * interned_term():
+ *   - Rebuilds term i (head followed by tail) and its weight into *out.
+ */
+void interned_term(const struct interned_terms *it, int i, struct term *out)
+{
+    const char *head = it->heads + it->head_off[i];
+    size_t len = strlen(head);
+    size_t cap = sizeof(out->term) - 1;
+    if (len > cap) {
+        len = cap;
+    }
+    memcpy(out->term, head, len);
+    if (it->tail[i] >= 0) {
+        const char *tail = it->tails + it->tail_off[it->tail[i]];
+        size_t tail_len = strlen(tail);
+        if (len + tail_len > cap) {
+            tail_len = cap - len;
+        }
+        memcpy(out->term + len, tail, tail_len);
+        len += tail_len;
+    }
+    out->term[len] = '\0';
+    out->weight = it->weight[i];
+}
+
+double interned_weight(const void *ctx, int i)
+{
+    return ((const struct interned_terms *)ctx)->weight[i];
+}
+
+/*
+ * strncmp() of the first m bytes of term i (head then tail) against prefix.
+ * Usually settled inside the head; the tail is read only when the prefix
+ * runs past it.
+ */
+static int compare_prefix(const struct interned_terms *it, int i, const char *prefix, size_t m)
+{
+    const unsigned char *s = (const unsigned char *)(it->heads + it->head_off[i]);
+    const unsigned char *p = (const unsigned char *)prefix;
+    int in_tail = 0;
+    for (size_t j = 0; j < m; j++) {
+        if (*s == '\0' && !in_tail && it->tail[i] >= 0) {
+            s = (const unsigned char *)(it->tails + it->tail_off[it->tail[i]]);
+            in_tail = 1;
+        }
+        if (*s != p[j]) {
+            return *s < p[j] ? -1 : 1;
+        }
+        s++;
+    }
+    return 0;
+}
+
+/*
+ * interned_prefix_range():
+ *   - Sets [*lo, *hi) to the terms starting with prefix and returns their
+ *     number; the same range prefix_range() gives on the full terms
+ *     (an empty prefix matches nothing).
+ */
+int interned_prefix_range(const struct interned_terms *it, const char *prefix, int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (!it || !prefix || prefix[0] == '\0') {
+        return 0;
+    }
+    size_t m = strlen(prefix);
+
+    int left = 0, right = it->n;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (compare_prefix(it, mid, prefix, m) < 0) left = mid + 1;
+        else right = mid;
+    }
+    *lo = left;
+    right = it->n;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (compare_prefix(it, mid, prefix, m) <= 0) left = mid + 1;
+        else right = mid;
+    }
+    *hi = left;
+    return *hi - *lo;
+}
+
+/*
+ * interned_autocomplete():
+ *   - Returns the k heaviest terms starting with substr, best first,
+ *     rebuilding the full strings of those k terms only.
+ *   - rm is an optional range_max built with interned_weight().
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void interned_autocomplete(struct term **answer, int *n_answer, const struct interned_terms *it,
+                           const struct range_max *rm, const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = interned_prefix_range(it, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = rm ? top_k_ranges(rm, &lo, &hi, 1, k, NULL, NULL, ids)
+           : top_k_scan(lo, hi, k, interned_weight, it, ids);
+    if (k > 0) {
+        *answer = malloc(sizeof(struct term) * k);
+        if (!(*answer)) {
+            fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        } else {
+            for (int i = 0; i < k; i++) {
+                interned_term(it, ids[i], &(*answer)[i]);
+            }
+            *n_answer = k;
+        }
+    }
+    free(ids);
+}
+
+size_t interned_memory(const struct interned_terms *it)
+{
+    if (!it) {
+        return 0;
+    }
+    return sizeof(*it) + it->heads_len + it->tails_len
+         + (size_t)it->n * (2 * sizeof(int) + sizeof(double))
+         + (size_t)it->ntails * sizeof(int);
+}
+
+void free_interned_terms(struct interned_terms *it)
+{
+    if (!it) {
+        return;
+    }
+    arena_free(it->arena, it->heads);
+    arena_free(it->arena, it->head_off);
+    arena_free(it->arena, it->tail);
+    arena_free(it->arena, it->weight);
+    arena_free(it->arena, it->tails);
+    arena_free(it->arena, it->tail_off);
+    arena_free(it->arena, it);
+}
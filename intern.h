@@ -0,0 +1,45 @@
+#if !defined(INTERN_H)
+#define INTERN_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+// A trailing segment is shared once at least this many terms end with it.
+#define INTERN_MIN_SHARED 2
+
+/*
+ * Terms stored as a unique head plus an optional shared tail, e.g.
+ * "Springfield" + ", Illinois, United States". Tails start at a ", "
+ * separator; each term uses the longest of its tails that at least
+ * INTERN_MIN_SHARED terms have, so every repeated region or country
+ * suffix is stored once. Terms keep the order and positions of the sorted
+ * term array they were built from, and full strings are rebuilt only for
+ * returned results.
+ */
+typedef struct interned_terms{
+    int n;
+    char *heads;        // head strings, NUL-terminated
+    int *head_off;      // head of term i in heads
+    int *tail;          // tail id of term i, -1 if none
+    double *weight;
+    int ntails;
+    char *tails;        // tail strings, NUL-terminated
+    int *tail_off;      // tail t in tails
+    size_t heads_len, tails_len;
+    struct arena *arena; // where the store lives, NULL for the heap
+} interned_terms;
+
+void build_interned_terms(struct interned_terms **it, struct term *terms, int nterms);
+void build_interned_terms_arena(struct interned_terms **it, struct term *terms, int nterms,
+                                struct arena *arena);
+void read_in_interned(struct interned_terms **it, char *filename);
+void read_in_interned_arena(struct interned_terms **it, struct arena *arena, char *filename);
+void interned_term(const struct interned_terms *it, int i, struct term *out);
+double interned_weight(const void *ctx, int i);
+int interned_prefix_range(const struct interned_terms *it, const char *prefix, int *lo, int *hi);
+void interned_autocomplete(struct term **answer, int *n_answer, const struct interned_terms *it,
+                           const struct range_max *rm, const char *substr, int k);
+size_t interned_memory(const struct interned_terms *it);
+void free_interned_terms(struct interned_terms *it);
+
+#endif
@@ -0,0 +1,636 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "live.h"
+
+#define CHECKPOINT_MAGIC "ACCKPT1"
+
+static int write_bytes(FILE *fp, uint32_t *crc, const void *data, size_t len)
+{
+    *crc = wal_crc32(*crc, data, len);
+    return fwrite(data, 1, len, fp) == len;
+}
+
+// fsync() of the directory holding path, so a rename in it is durable.
+static int sync_parent_dir(const char *path)
+{
+    char dir[1024];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else if ((size_t)(slash - path) < sizeof(dir)) {
+        memcpy(dir, path, slash - path);
+        dir[slash - path] = '\0';
+    } else {
+        return -1;
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+/*
+ * write_checkpoint():
+ *   - Writes the sorted terms and the lsn of the last update they include
+ *     to path. The file is written as path.tmp, synced, then renamed over
+ *     path, so a crash leaves either the old or the new checkpoint.
+ *   - Returns 0, or -1 after printing an error.
+ */
+int write_checkpoint(const char *path, const struct term *terms, int nterms, uint64_t lsn)
+{
+    size_t plen = strlen(path);
+    char *tmp = malloc(plen + 5);
+    if (!tmp) {
+        fprintf(stderr, "Error: Could not allocate memory for checkpoint.\n");
+        return -1;
+    }
+    memcpy(tmp, path, plen);
+    strcpy(tmp + plen, ".tmp");
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not create checkpoint %s.\n", tmp);
+        free(tmp);
+        return -1;
+    }
+    uint32_t crc = 0;
+    char magic[8] = CHECKPOINT_MAGIC;
+    int header[2] = { nterms, 0 };
+    int ok = write_bytes(fp, &crc, magic, sizeof(magic))
+          && write_bytes(fp, &crc, &lsn, sizeof(lsn))
+          && write_bytes(fp, &crc, header, sizeof(header));
+    for (int i = 0; i < nterms && ok; i++) {
+        unsigned char len = (unsigned char)strlen(terms[i].term);
+        ok = write_bytes(fp, &crc, &terms[i].weight, sizeof(double))
+          && write_bytes(fp, &crc, &len, 1)
+          && write_bytes(fp, &crc, terms[i].term, len);
+    }
+    ok = ok && fwrite(&crc, sizeof(crc), 1, fp) == 1
+            && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    ok = ok && rename(tmp, path) == 0 && sync_parent_dir(path) == 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write checkpoint %s.\n", path);
+        unlink(tmp);
+    }
+    free(tmp);
+    return ok ? 0 : -1;
+}
+
+/*
+ * read_checkpoint():
+ *   - Loads a checkpoint written by write_checkpoint() into a new sorted
+ *     terms array and the lsn it was taken at.
+ *   - Returns 0, or -1 (after printing an error) if the file cannot be
+ *     read or fails its checksum; then *terms = NULL.
+ */
+int read_checkpoint(struct term **terms, int *nterms, uint64_t *lsn, const char *path)
+{
+    *terms = NULL;
+    *nterms = 0;
+    *lsn = 0;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open checkpoint %s.\n", path);
+        return -1;
+    }
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        size = ftell(fp);
+        rewind(fp);
+    }
+    const size_t head = 8 + sizeof(uint64_t) + 2 * sizeof(int);
+    unsigned char *data = size >= (long)(head + sizeof(uint32_t)) ? malloc(size) : NULL;
+    int ok = data && fread(data, 1, size, fp) == (size_t)size;
+    fclose(fp);
+
+    uint32_t crc = 0;
+    if (ok) {
+        memcpy(&crc, data + size - sizeof(uint32_t), sizeof(uint32_t));
+        ok = memcmp(data, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0
+          && wal_crc32(0, data, size - sizeof(uint32_t)) == crc;
+    }
+    int n = 0;
+    if (ok) {
+        memcpy(lsn, data + 8, sizeof(uint64_t));
+        memcpy(&n, data + 8 + sizeof(uint64_t), sizeof(int));
+        ok = n >= 0;
+    }
+    struct term *t = NULL;
+    if (ok) {
+        t = malloc(sizeof(struct term) * (n > 0 ? n : 1));
+        ok = t != NULL;
+    }
+    const unsigned char *p = data + head;
+    const unsigned char *end = data + size - sizeof(uint32_t);
+    for (int i = 0; i < n && ok; i++) {
+        ok = end - p >= (long)(sizeof(double) + 1)
+          && (size_t)(end - p) >= sizeof(double) + 1 + p[sizeof(double)]
+          && p[sizeof(double)] < sizeof(t[i].term);
+        if (ok) {
+            size_t len = p[sizeof(double)];
+            memcpy(&t[i].weight, p, sizeof(double));
+            memcpy(t[i].term, p + sizeof(double) + 1, len);
+            t[i].term[len] = '\0';
+            p += sizeof(double) + 1 + len;
+        }
+    }
+    free(data);
+    if (!ok) {
+        fprintf(stderr, "Error: %s is not a valid checkpoint.\n", path);
+        free(t);
+        *lsn = 0;
+        return -1;
+    }
+    *terms = t;
+    *nterms = n;
+    return 0;
+}
+
+// item_value_fn over a terms array, for scanning the delta.
+static double live_delta_weight(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+// Index of the first term not below s.
+static int lower_bound(const struct term *terms, int nterms, const char *s)
+{
+    int left = 0, right = nterms;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (strcmp(terms[mid].term, s) < 0) left = mid + 1;
+        else right = mid;
+    }
+    return left;
+}
+
+/*
+ * Merges the sorted terms a and b (no term in both) into a new array.
+ * Returns it, or NULL if out of memory.
+ */
+static struct term *merge_terms(const struct term *a, int na, const struct term *b, int nb)
+{
+    struct term *merged = malloc(sizeof(struct term) * (na + nb > 0 ? na + nb : 1));
+    if (!merged) {
+        return NULL;
+    }
+    int n = 0, i = 0, j = 0;
+    while (i < na || j < nb) {
+        if (j == nb || (i < na && strcmp(a[i].term, b[j].term) < 0)) {
+            merged[n++] = a[i++];
+        } else {
+            merged[n++] = b[j++];
+        }
+    }
+    return merged;
+}
+
+// Moves the delta into the terms array and rebuilds the range_max over it.
+static int merge_delta(struct live_dictionary *ld)
+{
+    int n = ld->nterms + ld->ndelta;
+    struct term *merged = merge_terms(ld->terms, ld->nterms, ld->delta, ld->ndelta);
+    struct range_max rm;
+    if (!merged || build_term_range_max(&rm, merged, n) != 0) {
+        free(merged);
+        return -1;
+    }
+    free_range_max(&ld->rm);
+    free(ld->terms);
+    ld->terms = merged;
+    ld->nterms = ld->cap = n;
+    ld->rm = rm;
+    global_top_reset(&ld->top);
+    ld->ndelta = 0;
+    return 0;
+}
+
+/*
+ * Sets the weight of term. A term in the array is an O(log n) range_max
+ * and global top update; a new term is inserted in the delta, which is merged into the
+ * array first if it is full. Returns 0, or -1 if out of memory.
+ */
+static int apply_set_weight(struct live_dictionary *ld, const char *term, double weight)
+{
+    int i = lower_bound(ld->terms, ld->nterms, term);
+    if (i < ld->nterms && strcmp(ld->terms[i].term, term) == 0) {
+        ld->terms[i].weight = weight;
+        range_max_update_top(&ld->rm, &ld->top, i);
+        return 0;
+    }
+    int d = lower_bound(ld->delta, ld->ndelta, term);
+    if (d < ld->ndelta && strcmp(ld->delta[d].term, term) == 0) {
+        ld->delta[d].weight = weight;
+        return 0;
+    }
+    if (!ld->delta) {
+        ld->delta = malloc(sizeof(struct term) * LIVE_DELTA_MAX);
+        if (!ld->delta) {
+            return -1;
+        }
+    }
+    if (ld->ndelta == LIVE_DELTA_MAX) {
+        if (merge_delta(ld) != 0) {
+            return -1;
+        }
+        d = 0;
+    }
+    memmove(&ld->delta[d + 1], &ld->delta[d], sizeof(struct term) * (ld->ndelta - d));
+    strcpy(ld->delta[d].term, term);
+    ld->delta[d].weight = weight;
+    ld->ndelta++;
+    return 0;
+}
+
+// Log records collected during recovery, applied in one merge at the end.
+typedef struct replay_batch{
+    struct wal_record *recs;
+    int n, cap;
+} replay_batch;
+
+static int collect_record(void *ctx, const struct wal_record *rec)
+{
+    struct replay_batch *b = (struct replay_batch *)ctx;
+    if (rec->op != WAL_SET_WEIGHT) {
+        return 0;
+    }
+    if (b->n == b->cap) {
+        int cap = b->cap ? b->cap * 2 : 1024;
+        struct wal_record *recs = realloc(b->recs, sizeof(struct wal_record) * cap);
+        if (!recs) {
+            return -1;
+        }
+        b->recs = recs;
+        b->cap = cap;
+    }
+    b->recs[b->n++] = *rec;
+    return 0;
+}
+
+static int compare_record(const void *a, const void *b)
+{
+    const struct wal_record *x = (const struct wal_record *)a;
+    const struct wal_record *y = (const struct wal_record *)b;
+    int cmp = strcmp(x->term, y->term);
+    if (cmp != 0) return cmp;
+    return (x->lsn > y->lsn) - (x->lsn < y->lsn);
+}
+
+/*
+ * Applies a replayed batch with one sort and one merge instead of an
+ * insert per record: the last record of each term wins.
+ */
+static int apply_batch(struct live_dictionary *ld, struct replay_batch *b)
+{
+    if (b->n == 0) {
+        return 0;
+    }
+    qsort(b->recs, b->n, sizeof(struct wal_record), compare_record);
+    int unique = 0;
+    for (int r = 0; r < b->n; r++) {
+        if (unique > 0 && strcmp(b->recs[unique - 1].term, b->recs[r].term) == 0) {
+            b->recs[unique - 1] = b->recs[r];
+        } else {
+            b->recs[unique++] = b->recs[r];
+        }
+    }
+
+    int cap = ld->nterms + unique;
+    struct term *merged = malloc(sizeof(struct term) * cap);
+    if (!merged) {
+        return -1;
+    }
+    int n = 0, i = 0, r = 0;
+    while (i < ld->nterms || r < unique) {
+        int cmp = i == ld->nterms ? 1 : r == unique ? -1
+                : strcmp(ld->terms[i].term, b->recs[r].term);
+        if (cmp < 0) {
+            merged[n++] = ld->terms[i++];
+        } else {
+            strcpy(merged[n].term, b->recs[r].term);
+            merged[n++].weight = b->recs[r++].weight;
+            i += cmp == 0;
+        }
+    }
+    free(ld->terms);
+    ld->terms = merged;
+    ld->nterms = n;
+    ld->cap = cap;
+    return 0;
+}
+
+/*
+ * open_live_dictionary():
+ *   - Recovers the dictionary: loads the checkpoint at checkpoint_path and
+ *     replays the newer records of the log at wal_path, then opens the log
+ *     for new updates.
+ *   - Without a checkpoint yet, starts from terms_file (or empty if NULL)
+ *     and writes the first checkpoint, so the text file is parsed once.
+ *   - Either path may be NULL: no checkpoints, or updates not logged.
+ *
+ * Edge cases addressed:
+ *   - A torn record at the end of the log (crash mid-append) is dropped.
+ *   - On failure prints an error and sets *ld = NULL.
+ */
+void open_live_dictionary(struct live_dictionary **ld, const char *checkpoint_path,
+                          const char *wal_path, char *terms_file)
+{
+    *ld = NULL;
+    struct live_dictionary *d = calloc(1, sizeof(struct live_dictionary));
+    if (!d) {
+        fprintf(stderr, "Error: Could not allocate memory for dictionary.\n");
+        return;
+    }
+    pthread_rwlock_init(&d->lock, NULL);
+    pthread_mutex_init(&d->checkpoint_lock, NULL);
+
+    int have_checkpoint = checkpoint_path && access(checkpoint_path, F_OK) == 0;
+    int failed = 0;
+    if (have_checkpoint) {
+        failed = read_checkpoint(&d->terms, &d->nterms, &d->lsn, checkpoint_path) != 0;
+    } else if (terms_file) {
+        read_in_terms(&d->terms, &d->nterms, terms_file);
+        failed = !d->terms;
+    }
+    d->cap = d->nterms;
+    if (checkpoint_path && !failed) {
+        d->checkpoint_path = strdup(checkpoint_path);
+        failed = !d->checkpoint_path;
+    }
+
+    uint64_t last = d->lsn;
+    if (wal_path && !failed) {
+        struct replay_batch batch = { NULL, 0, 0 };
+        failed = wal_replay(wal_path, d->lsn, collect_record, &batch, &last) < 0
+              || apply_batch(d, &batch) != 0;
+        d->lsn = last;
+        free(batch.recs);
+    }
+    if (!failed) {
+        failed = build_term_range_max(&d->rm, d->terms, d->nterms) != 0
+              || build_global_top(&d->top, &d->rm, GLOBAL_TOP_K) != 0;
+    }
+    if (wal_path && !failed) {
+        open_wal(&d->wal, wal_path, last + 1);
+        failed = !d->wal;
+    }
+    if (!failed && checkpoint_path && !have_checkpoint) {
+        failed = live_checkpoint(d) != 0;
+    }
+    if (failed) {
+        fprintf(stderr, "Error: Could not recover dictionary.\n");
+        close_live_dictionary(d);
+        return;
+    }
+    *ld = d;
+}
+
+/*
+ * live_set_weight():
+ *   - Sets the weight of term, adding it if new, and returns once the
+ *     update is durable: 0, or -1 on failure.
+ *   - If a logged update cannot be applied (out of memory), the log is
+ *     failed and every later update returns -1 until the dictionary is
+ *     reopened.
+ *
+ * Approach:
+ *   - The record is logged and applied under the dictionary lock, so log
+ *     order is apply order; the wait for the disk happens after the lock
+ *     is released, letting concurrent updaters share one flush.
+ */
+int live_set_weight(struct live_dictionary *ld, const char *term, double weight)
+{
+    if (!term || term[0] == '\0' || strlen(term) >= sizeof(ld->terms[0].term)) {
+        fprintf(stderr, "Error: Term must be 1 to 199 characters.\n");
+        return -1;
+    }
+    pthread_rwlock_wrlock(&ld->lock);
+    uint64_t lsn = 0;
+    if (ld->wal) {
+        lsn = wal_append(ld->wal, WAL_SET_WEIGHT, term, weight);
+        if (lsn == 0) {
+            pthread_rwlock_unlock(&ld->lock);
+            return -1;
+        }
+    }
+    int result = apply_set_weight(ld, term, weight);
+    if (result == 0) {
+        ld->lsn = ld->wal ? lsn : ld->lsn + 1;
+        if (ld->on_update) {
+            struct wal_record rec;
+            rec.lsn = ld->lsn;
+            rec.op = WAL_SET_WEIGHT;
+            rec.weight = weight;
+            strcpy(rec.term, term);
+            ld->on_update(ld->on_update_ctx, &rec);
+        }
+    } else {
+        // Logged but not applied: ld->lsn must never pass this record, or a
+        // checkpoint would drop it, so no further record may be logged
+        fprintf(stderr, "Error: Could not allocate memory for dictionary update.\n");
+        if (ld->wal) {
+            wal_fail(ld->wal);
+        }
+    }
+    pthread_rwlock_unlock(&ld->lock);
+    if (ld->wal && wal_sync(ld->wal, lsn) != 0) {
+        return -1;
+    }
+    return result;
+}
+
+/*
+ * live_apply():
+ *   - Applies a record produced elsewhere (e.g. a leader's log) without
+ *     logging it, keeping its lsn. Records at or below the current lsn are
+ *     already applied and are skipped.
+ *   - Returns 0, or -1 on failure.
+ */
+int live_apply(struct live_dictionary *ld, const struct wal_record *rec)
+{
+    pthread_rwlock_wrlock(&ld->lock);
+    if (rec->lsn <= ld->lsn || rec->op != WAL_SET_WEIGHT) {
+        pthread_rwlock_unlock(&ld->lock);
+        return 0;
+    }
+    int result = apply_set_weight(ld, rec->term, rec->weight);
+    if (result == 0) {
+        ld->lsn = rec->lsn;
+        if (ld->on_update) {
+            ld->on_update(ld->on_update_ctx, rec);
+        }
+    }
+    pthread_rwlock_unlock(&ld->lock);
+    return result;
+}
+
+/*
+ * live_replace():
+ *   - Replaces the whole dictionary with the sorted terms array (which it
+ *     takes over) as of lsn, e.g. a snapshot received from a leader.
+ *   - Returns 0, or -1 if out of memory (the dictionary is then unchanged
+ *     and terms is freed).
+ */
+int live_replace(struct live_dictionary *ld, struct term *terms, int nterms, uint64_t lsn)
+{
+    struct range_max rm;
+    if (build_term_range_max(&rm, terms, nterms) != 0) {
+        free(terms);
+        return -1;
+    }
+    pthread_rwlock_wrlock(&ld->lock);
+    free_range_max(&ld->rm);
+    free(ld->terms);
+    ld->terms = terms;
+    ld->nterms = ld->cap = nterms;
+    ld->rm = rm;
+    global_top_reset(&ld->top);
+    ld->ndelta = 0;
+    ld->lsn = lsn;
+    pthread_rwlock_unlock(&ld->lock);
+    return 0;
+}
+
+/*
+ * live_snapshot():
+ *   - Sets *terms to a new sorted copy of the whole dictionary (delta
+ *     included) and *lsn to the last update it holds. Only the copy is
+ *     made under the lock, and queries go on during it.
+ *   - Returns 0, or -1 if out of memory (then *terms = NULL).
+ */
+int live_snapshot(struct live_dictionary *ld, struct term **terms, int *nterms, uint64_t *lsn)
+{
+    pthread_rwlock_rdlock(&ld->lock);
+    int n = ld->nterms + ld->ndelta;
+    *terms = merge_terms(ld->terms, ld->nterms, ld->delta, ld->ndelta);
+    *nterms = *terms ? n : 0;
+    *lsn = ld->lsn;
+    pthread_rwlock_unlock(&ld->lock);
+    if (!*terms) {
+        fprintf(stderr, "Error: Could not allocate memory for dictionary copy.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * live_checkpoint():
+ *   - Writes a checkpoint of the current dictionary and drops the log
+ *     records it holds. Returns 0, or -1 on failure (the old checkpoint
+ *     and the log are then left as they were).
+ *   - Updates only wait while the dictionary is copied; the file is
+ *     written and synced from the copy, and records logged meanwhile stay
+ *     in the log.
+ */
+int live_checkpoint(struct live_dictionary *ld)
+{
+    if (!ld->checkpoint_path) {
+        return -1;
+    }
+    pthread_mutex_lock(&ld->checkpoint_lock);
+    struct term *terms;
+    int nterms;
+    uint64_t lsn;
+    int result = live_snapshot(ld, &terms, &nterms, &lsn);
+    if (result == 0) {
+        result = write_checkpoint(ld->checkpoint_path, terms, nterms, lsn);
+        free(terms);
+    }
+    if (result == 0 && ld->wal) {
+        result = wal_reset(ld->wal, lsn);
+    }
+    pthread_mutex_unlock(&ld->checkpoint_lock);
+    return result;
+}
+
+/*
+ * live_autocomplete():
+ *   - autocomplete_top_k() on the current dictionary, safe to call while
+ *     other threads update it; queries only wait for updates, not for
+ *     each other.
+ *
+ * Approach:
+ *   - The k best of the terms array (through the range_max, or the global
+ *     top for an empty substr) and of the delta (scanned, it is small) are
+ *     merged by weight, ties going to the term that sorts first as in a
+ *     single array.
+ *   - An empty substr returns the k most popular terms overall.
+ */
+void live_autocomplete(struct term **answer, int *n_answer, struct live_dictionary *ld,
+                       const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!substr || k <= 0) {
+        return;
+    }
+    int *ids = malloc(sizeof(int) * 2 * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for answer.\n");
+        return;
+    }
+    pthread_rwlock_rdlock(&ld->lock);
+    int na, nb;
+    if (substr[0] == '\0') {
+        na = global_top_ids(&ld->top, k, ids);
+        nb = top_k_scan(0, ld->ndelta, k, live_delta_weight, ld->delta, ids + k);
+    } else {
+        na = top_k_prefix(ld->terms, ld->nterms, &ld->rm, substr, k, ids);
+        nb = top_k_prefix(ld->delta, ld->ndelta, NULL, substr, k, ids + k);
+    }
+    int n = na + nb < k ? na + nb : k;
+    struct term *out = n > 0 ? malloc(sizeof(struct term) * n) : NULL;
+    if (out) {
+        int a = 0, b = 0;
+        for (int i = 0; i < n; i++) {
+            const struct term *x = a < na ? &ld->terms[ids[a]] : NULL;
+            const struct term *y = b < nb ? &ld->delta[ids[k + b]] : NULL;
+            int take_x = !y || (x && (x->weight > y->weight
+                                      || (x->weight == y->weight && strcmp(x->term, y->term) < 0)));
+            out[i] = take_x ? *x : *y;
+            a += take_x;
+            b += !take_x;
+        }
+    }
+    pthread_rwlock_unlock(&ld->lock);
+    free(ids);
+    if (n > 0 && !out) {
+        fprintf(stderr, "Error: Could not allocate memory for answer.\n");
+        return;
+    }
+    *answer = out;
+    *n_answer = out ? n : 0;
+}
+
+/*
+ * close_live_dictionary():
+ *   - Flushes the log and frees the dictionary; no checkpoint is taken.
+ */
+void close_live_dictionary(struct live_dictionary *ld)
+{
+    if (!ld) {
+        return;
+    }
+    close_wal(ld->wal);
+    free_range_max(&ld->rm);
+    free_global_top(&ld->top);
+    free(ld->terms);
+    free(ld->delta);
+    free(ld->checkpoint_path);
+    pthread_rwlock_destroy(&ld->lock);
+    pthread_mutex_destroy(&ld->checkpoint_lock);
+    free(ld);
+}
@@ -0,0 +1,69 @@
+#if !defined(LIVE_H)
+#define LIVE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "autocomplete.h"
+#include "topk.h"
+#include "wal.h"
+
+// New terms collected in the sorted delta before one merge into the terms array.
+#define LIVE_DELTA_MAX 1024
+
+/*
+ * Called with every update a live_dictionary applies, in lsn order and
+ * under its write lock (see repl.c); must not call back into the dictionary.
+ */
+typedef void (*live_update_fn)(void *ctx, const struct wal_record *rec);
+
+/*
+ * A dictionary that takes weight updates and new terms at runtime, kept
+ * crash-safe by a write-ahead log and periodic checkpoints.
+ *
+ * Every update is appended to the log before it is applied, and
+ * live_set_weight() returns once it is durable. A new term goes into a
+ * small sorted delta that queries search alongside the terms array, and
+ * that is merged into it once it holds LIVE_DELTA_MAX terms, so inserts
+ * do not shift the array and rebuild the range_max every time.
+ *
+ * live_checkpoint() copies the dictionary, writes the copy to a binary
+ * checkpoint (to a temporary file that is synced and then renamed over
+ * the old one) while updates go on, then drops the log records it holds.
+ * Recovery loads the checkpoint and replays the log records newer than
+ * it, so read_in_terms() only ever runs on the first start.
+ *
+ * Checkpoint file, native byte order:
+ *   "ACCKPT1\0", uint64 lsn, int n, int 0
+ *   n x (double weight, byte length, term bytes)
+ *   crc32 of everything before it
+ */
+typedef struct live_dictionary{
+    pthread_rwlock_t lock;  // read-held by queries and copies, write-held by updates
+    struct term *terms;     // sorted
+    int nterms, cap;
+    struct range_max rm;
+    struct global_top top;  // best GLOBAL_TOP_K of terms, for empty prefixes
+    struct term *delta;     // sorted new terms not in terms yet, LIVE_DELTA_MAX slots
+    int ndelta;
+    pthread_mutex_t checkpoint_lock;    // one checkpoint at a time
+    uint64_t lsn;           // last update applied
+    struct wal *wal;        // NULL if updates are not logged
+    char *checkpoint_path;  // NULL if there are no checkpoints
+    live_update_fn on_update;   // optional, e.g. to ship updates to followers
+    void *on_update_ctx;
+} live_dictionary;
+
+int write_checkpoint(const char *path, const struct term *terms, int nterms, uint64_t lsn);
+int read_checkpoint(struct term **terms, int *nterms, uint64_t *lsn, const char *path);
+void open_live_dictionary(struct live_dictionary **ld, const char *checkpoint_path,
+                          const char *wal_path, char *terms_file);
+int live_set_weight(struct live_dictionary *ld, const char *term, double weight);
+int live_apply(struct live_dictionary *ld, const struct wal_record *rec);
+int live_replace(struct live_dictionary *ld, struct term *terms, int nterms, uint64_t lsn);
+int live_snapshot(struct live_dictionary *ld, struct term **terms, int *nterms, uint64_t *lsn);
+int live_checkpoint(struct live_dictionary *ld);
+void live_autocomplete(struct term **answer, int *n_answer, struct live_dictionary *ld,
+                       const char *substr, int k);
+void close_live_dictionary(struct live_dictionary *ld);
+
+#endif
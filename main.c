@@ -1,17 +1,21 @@
+#include <stdlib.h>
 #include "autocomplete.h"
+#include "dictionary.h"
 
 int main(void)
 {
-    struct term *terms;
-    int nterms;
-    read_in_terms(&terms, &nterms, "cities.txt");
-    lowest_match(terms, nterms, "Tor");
-    highest_match(terms, nterms, "Tor");
+    struct dictionary *dict;
+    load_dictionary(&dict, "cities.txt", ARENA_HUGE_ADVISE, 0);
+    if (!dict) {
+        return 1;
+    }
+    lowest_match(dict->terms, dict->nterms, "Tor");
+    highest_match(dict->terms, dict->nterms, "Tor");
     
     struct term *answer;
     int n_answer;
-    autocomplete(&answer, &n_answer, terms, nterms, "Tor");
-    //free allocated blocks here -- not required for the project, but good practice
+    autocomplete(&answer, &n_answer, dict->terms, dict->nterms, "Tor");
+    free(answer);
+    free_dictionary(dict);
     return 0;
 }
-
@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "parallel.h"
+
+typedef struct scan_job{
+    int lo, hi, k;
+    item_value_fn value;
+    const void *ctx;
+    int *out;      // this worker's k slots
+    int count;
+} scan_job;
+
+static void *scan_worker(void *arg)
+{
+    struct scan_job *job = (struct scan_job *)arg;
+    job->count = top_k_scan(job->lo, job->hi, job->k, job->value, job->ctx, job->out);
+    return NULL;
+}
+
+static int online_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/*
+ * top_k_scan_parallel():
+ *   - Same result as top_k_scan(lo, hi, k, value, ctx, out), including the
+ *     order of ties.
+ *   - Ranges of PARALLEL_MIN_RANGE items or more are cut into contiguous
+ *     splits of at least PARALLEL_MIN_SPLIT items, one per worker (up to
+ *     PARALLEL_MAX_THREADS and the number of online CPUs). Each worker
+ *     keeps its own best k; the calling thread then merges the sorted
+ *     lists. value must be safe to call from several threads at once.
+ *
+ * Edge cases:
+ *   - If threads or memory are unavailable, the work is done on the
+ *     calling thread instead.
+ */
+int top_k_scan_parallel(int lo, int hi, int k, item_value_fn value, const void *ctx, int *out)
+{
+    int len = hi - lo;
+    int nthreads = len / PARALLEL_MIN_SPLIT;
+    if (nthreads > PARALLEL_MAX_THREADS) nthreads = PARALLEL_MAX_THREADS;
+    if (nthreads > online_cpus()) nthreads = online_cpus();
+    if (len < PARALLEL_MIN_RANGE || nthreads < 2 || k <= 0) {
+        return top_k_scan(lo, hi, k, value, ctx, out);
+    }
+    if (k > len) {
+        k = len;
+    }
+
+    struct scan_job *jobs = malloc(sizeof(struct scan_job) * nthreads);
+    pthread_t *threads = malloc(sizeof(pthread_t) * nthreads);
+    int *slots = malloc(sizeof(int) * (size_t)k * nthreads);
+    int *heads = calloc(nthreads, sizeof(int));
+    if (!jobs || !threads || !slots || !heads) {
+        free(jobs);
+        free(threads);
+        free(slots);
+        free(heads);
+        return top_k_scan(lo, hi, k, value, ctx, out);
+    }
+
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t].lo = lo + (int)((long long)len * t / nthreads);
+        jobs[t].hi = lo + (int)((long long)len * (t + 1) / nthreads);
+        jobs[t].k = k;
+        jobs[t].value = value;
+        jobs[t].ctx = ctx;
+        jobs[t].out = slots + (size_t)k * t;
+        jobs[t].count = 0;
+    }
+    // The calling thread takes split 0 itself; a split whose thread cannot
+    // be started is run inline as well
+    int *started = calloc(nthreads, sizeof(int));
+    for (int t = 1; t < nthreads; t++) {
+        if (started && pthread_create(&threads[t], NULL, scan_worker, &jobs[t]) == 0) {
+            started[t] = 1;
+        } else {
+            scan_worker(&jobs[t]);
+        }
+    }
+    scan_worker(&jobs[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (started && started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+
+    // Merge: splits are in position order, so on equal values the earlier
+    // split's head has the lower position and must win, as in top_k_scan()
+    int n = 0;
+    while (n < k) {
+        int pick = -1;
+        double best = 0;
+        for (int t = 0; t < nthreads; t++) {
+            if (heads[t] < jobs[t].count) {
+                double v = value(ctx, jobs[t].out[heads[t]]);
+                if (pick < 0 || v > best) {
+                    pick = t;
+                    best = v;
+                }
+            }
+        }
+        if (pick < 0) {
+            break;
+        }
+        out[n++] = jobs[pick].out[heads[pick]++];
+    }
+
+    free(started);
+    free(jobs);
+    free(threads);
+    free(slots);
+    free(heads);
+    return n;
+}
@@ -0,0 +1,16 @@
+#if !defined(PARALLEL_H)
+#define PARALLEL_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+// Ranges shorter than this are scanned on the calling thread.
+#define PARALLEL_MIN_RANGE 131072
+// Smallest split handed to one worker.
+#define PARALLEL_MIN_SPLIT 32768
+// Most workers used for one query.
+#define PARALLEL_MAX_THREADS 8
+
+int top_k_scan_parallel(int lo, int hi, int k, item_value_fn value, const void *ctx, int *out);
+
+#endif
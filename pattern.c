@@ -0,0 +1,642 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pattern.h"
+
+#define NFA_SET 0
+#define NFA_SPLIT 1
+#define NFA_MATCH 2
+
+#define DFA_UNBUILT -2
+#define DFA_DEAD -1
+#define DFA_FULL -3    // PATTERN_MAX_DFA reached
+
+/*
+ * NFA fragment under construction: entered at start, left through end,
+ * an epsilon state whose out is patched by whatever follows.
+ */
+typedef struct fragment{
+    int start, end;
+} fragment;
+
+typedef struct parser{
+    const char *s;
+    struct pattern *p;
+    int failed;
+} parser;
+
+static int new_state(parser *ps, int type)
+{
+    struct pattern *p = ps->p;
+    if (ps->failed) {
+        return 0;
+    }
+    if ((p->nnfa & (p->nnfa - 1)) == 0) {   // grow at powers of two
+        int cap = p->nnfa ? p->nnfa * 2 : 16;
+        struct nfa_state *nfa = realloc(p->nfa, sizeof(struct nfa_state) * cap);
+        if (!nfa) {
+            ps->failed = 1;
+            return 0;
+        }
+        p->nfa = nfa;
+    }
+    struct nfa_state *st = &p->nfa[p->nnfa];
+    memset(st, 0, sizeof(*st));
+    st->type = type;
+    st->out = st->out1 = -1;
+    return p->nnfa++;
+}
+
+static void set_add(uint64_t *set, unsigned char c)
+{
+    set[c / 64] |= (uint64_t)1 << (c % 64);
+}
+
+static fragment frag_empty(parser *ps)
+{
+    int e = new_state(ps, NFA_SPLIT);
+    fragment f = { e, e };
+    return f;
+}
+
+static fragment frag_set(parser *ps, const uint64_t *set)
+{
+    int s = new_state(ps, NFA_SET);
+    int e = new_state(ps, NFA_SPLIT);
+    fragment f = { s, e };
+    if (!ps->failed) {
+        memcpy(ps->p->nfa[s].set, set, sizeof(ps->p->nfa[s].set));
+        ps->p->nfa[s].out = e;
+    }
+    return f;
+}
+
+static fragment frag_any(parser *ps)
+{
+    uint64_t set[4] = { ~(uint64_t)1, ~(uint64_t)0, ~(uint64_t)0, ~(uint64_t)0 };  // every byte but NUL
+    return frag_set(ps, set);
+}
+
+static fragment frag_byte(parser *ps, unsigned char c)
+{
+    uint64_t set[4] = { 0, 0, 0, 0 };
+    set_add(set, c);
+    return frag_set(ps, set);
+}
+
+static fragment frag_concat(parser *ps, fragment a, fragment b)
+{
+    if (!ps->failed) {
+        ps->p->nfa[a.end].out = b.start;
+    }
+    fragment f = { a.start, b.end };
+    return f;
+}
+
+static fragment frag_alt(parser *ps, fragment a, fragment b)
+{
+    int s = new_state(ps, NFA_SPLIT);
+    int e = new_state(ps, NFA_SPLIT);
+    if (!ps->failed) {
+        ps->p->nfa[s].out = a.start;
+        ps->p->nfa[s].out1 = b.start;
+        ps->p->nfa[a.end].out = e;
+        ps->p->nfa[b.end].out = e;
+    }
+    fragment f = { s, e };
+    return f;
+}
+
+// op is '*' (zero or more), '+' (one or more) or '?' (zero or one)
+static fragment frag_repeat(parser *ps, fragment a, char op)
+{
+    int s = new_state(ps, NFA_SPLIT);
+    int e = new_state(ps, NFA_SPLIT);
+    if (!ps->failed) {
+        ps->p->nfa[s].out = a.start;
+        ps->p->nfa[s].out1 = e;
+        ps->p->nfa[a.end].out = op == '?' ? e : s;
+    }
+    fragment f = { op == '+' ? a.start : s, e };
+    return f;
+}
+
+/*
+ * Parses a bracket expression after its '[': [abc], [a-z], [^0-9] ('!' also
+ * negates, as in shell globs). A ']' right after the opening is literal.
+ */
+static fragment parse_class(parser *ps)
+{
+    uint64_t set[4] = { 0, 0, 0, 0 };
+    int negate = 0;
+    if (*ps->s == '^' || *ps->s == '!') {
+        negate = 1;
+        ps->s++;
+    }
+    int first = 1;
+    while (*ps->s && (*ps->s != ']' || first)) {
+        unsigned char lo = (unsigned char)*ps->s++;
+        if (lo == '\\' && *ps->s) {
+            lo = (unsigned char)*ps->s++;
+        }
+        unsigned char hi = lo;
+        if (ps->s[0] == '-' && ps->s[1] && ps->s[1] != ']') {
+            hi = (unsigned char)ps->s[1];
+            ps->s += 2;
+        }
+        for (int c = lo; c <= hi; c++) {
+            set_add(set, (unsigned char)c);
+        }
+        first = 0;
+    }
+    if (*ps->s != ']') {
+        ps->failed = 1;
+        return frag_empty(ps);
+    }
+    ps->s++;
+    if (negate) {
+        for (int w = 0; w < 4; w++) {
+            set[w] = ~set[w];
+        }
+    }
+    set[0] &= ~(uint64_t)1;   // NUL never matches
+    return frag_set(ps, set);
+}
+
+static fragment parse_alt(parser *ps);
+
+static fragment parse_atom(parser *ps)
+{
+    char c = *ps->s++;
+    if (c == '(') {
+        fragment f = parse_alt(ps);
+        if (*ps->s != ')') {
+            ps->failed = 1;
+        } else {
+            ps->s++;
+        }
+        return f;
+    }
+    if (c == '[') return parse_class(ps);
+    if (c == '.') return frag_any(ps);
+    if (c == '\\' && *ps->s) c = *ps->s++;
+    return frag_byte(ps, (unsigned char)c);
+}
+
+static fragment parse_concat(parser *ps)
+{
+    fragment f = frag_empty(ps);
+    while (*ps->s && *ps->s != '|' && *ps->s != ')' && !ps->failed) {
+        if (*ps->s == '*' || *ps->s == '+' || *ps->s == '?') {
+            ps->failed = 1;   // nothing to repeat
+            break;
+        }
+        fragment a = parse_atom(ps);
+        while (*ps->s == '*' || *ps->s == '+' || *ps->s == '?') {
+            a = frag_repeat(ps, a, *ps->s++);
+        }
+        f = frag_concat(ps, f, a);
+    }
+    return f;
+}
+
+static fragment parse_alt(parser *ps)
+{
+    fragment f = parse_concat(ps);
+    while (*ps->s == '|' && !ps->failed) {
+        ps->s++;
+        f = frag_alt(ps, f, parse_concat(ps));
+    }
+    return f;
+}
+
+static fragment parse_glob(parser *ps)
+{
+    fragment f = frag_empty(ps);
+    while (*ps->s && !ps->failed) {
+        char c = *ps->s++;
+        fragment a;
+        if (c == '*') {
+            a = frag_repeat(ps, frag_any(ps), '*');
+        } else if (c == '?') {
+            a = frag_any(ps);
+        } else if (c == '[') {
+            a = parse_class(ps);
+        } else {
+            if (c == '\\' && *ps->s) c = *ps->s++;
+            a = frag_byte(ps, (unsigned char)c);
+        }
+        f = frag_concat(ps, f, a);
+    }
+    return f;
+}
+
+static int rehash_dfa(struct pattern *p, int nslots)
+{
+    int *slots = malloc(sizeof(int) * nslots);
+    if (!slots) {
+        return -1;
+    }
+    for (int i = 0; i < nslots; i++) {
+        slots[i] = -1;
+    }
+    free(p->slots);
+    p->slots = slots;
+    p->nslots = nslots;
+    return 0;
+}
+
+/*
+ * compile_pattern():
+ *   - Parses pat in the given syntax (PATTERN_GLOB or PATTERN_REGEX) into
+ *     an NFA. A regex without ^ may match anywhere in the term and without
+ *     $ may be followed by anything; a glob must match the whole term.
+ *
+ * Edge cases addressed:
+ *   - Syntax errors (unbalanced brackets, dangling '*') print an error and
+ *     set *p = NULL.
+ */
+void compile_pattern(struct pattern **p, const char *pat, int syntax)
+{
+    *p = NULL;
+    if (!pat) {
+        return;
+    }
+
+    struct pattern *c = calloc(1, sizeof(struct pattern));
+    if (!c) {
+        fprintf(stderr, "Error: Could not allocate memory for pattern.\n");
+        return;
+    }
+
+    size_t len = strlen(pat);
+    char *body = malloc(len + 1);
+    if (!body || rehash_dfa(c, 256) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for pattern.\n");
+        free(body);
+        free_pattern(c);
+        return;
+    }
+    memcpy(body, pat, len + 1);
+
+    parser ps = { body, c, 0 };
+    fragment f;
+    if (syntax == PATTERN_REGEX) {
+        int anchor_start = body[0] == '^';
+        // A trailing '$' anchors unless it is escaped by an odd number of backslashes
+        int anchor_end = 0;
+        if (len > (size_t)anchor_start && body[len - 1] == '$') {
+            size_t slashes = 0;
+            while (slashes + 1 < len && body[len - 2 - slashes] == '\\') {
+                slashes++;
+            }
+            if (slashes % 2 == 0) {
+                anchor_end = 1;
+                body[len - 1] = '\0';
+            }
+        }
+        ps.s = body + anchor_start;
+        f = anchor_start ? frag_empty(&ps) : frag_repeat(&ps, frag_any(&ps), '*');
+        f = frag_concat(&ps, f, parse_alt(&ps));
+        if (*ps.s != '\0') {
+            ps.failed = 1;    // unbalanced ')'
+        }
+        if (!anchor_end) {
+            f = frag_concat(&ps, f, frag_repeat(&ps, frag_any(&ps), '*'));
+        }
+    } else {
+        f = parse_glob(&ps);
+    }
+
+    int match = new_state(&ps, NFA_MATCH);
+    if (!ps.failed) {
+        c->nfa[f.end].out = match;
+        c->start = f.start;
+        c->words = (c->nnfa + 63) / 64;
+    }
+    free(body);
+
+    if (ps.failed) {
+        fprintf(stderr, "Error: Invalid pattern \"%s\"\n", pat);
+        free_pattern(c);
+        return;
+    }
+    *p = c;
+}
+
+/*
+ * Adds the states reachable from the set through epsilon splits.
+ */
+static void closure(const struct pattern *p, uint64_t *set, int *stack)
+{
+    int top = 0;
+    for (int s = 0; s < p->nnfa; s++) {
+        if ((set[s / 64] >> (s % 64)) & 1) {
+            stack[top++] = s;
+        }
+    }
+    while (top > 0) {
+        const struct nfa_state *st = &p->nfa[stack[--top]];
+        if (st->type != NFA_SPLIT) {
+            continue;
+        }
+        int outs[2] = { st->out, st->out1 };
+        for (int i = 0; i < 2; i++) {
+            int o = outs[i];
+            if (o >= 0 && !((set[o / 64] >> (o % 64)) & 1)) {
+                set[o / 64] |= (uint64_t)1 << (o % 64);
+                stack[top++] = o;
+            }
+        }
+    }
+}
+
+static uint32_t hash_set(const uint64_t *set, int words)
+{
+    uint64_t h = 1469598103934665603ull;
+    for (int w = 0; w < words; w++) {
+        h = (h ^ set[w]) * 1099511628211ull;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/*
+ * Returns the DFA state for an NFA set, creating it if needed,
+ * DFA_DEAD for the empty set and DFA_FULL if the cap is reached.
+ */
+static int dfa_state(struct pattern *p, const uint64_t *set)
+{
+    int empty = 1;
+    for (int w = 0; w < p->words && empty; w++) {
+        empty = set[w] == 0;
+    }
+    if (empty) {
+        return DFA_DEAD;
+    }
+
+    size_t bytes = sizeof(uint64_t) * p->words;
+    int slot = (int)(hash_set(set, p->words) & (uint32_t)(p->nslots - 1));
+    while (p->slots[slot] != -1) {
+        int d = p->slots[slot];
+        if (memcmp(p->dfa_sets + (size_t)d * p->words, set, bytes) == 0) {
+            return d;
+        }
+        slot = (slot + 1) & (p->nslots - 1);
+    }
+
+    if (p->ndfa >= PATTERN_MAX_DFA) {
+        return DFA_FULL;
+    }
+    if (p->ndfa == p->dfa_cap) {
+        int cap = p->dfa_cap ? p->dfa_cap * 2 : 16;
+        uint64_t *sets = realloc(p->dfa_sets, bytes * cap);
+        if (sets) p->dfa_sets = sets;
+        int *next = realloc(p->dfa_next, sizeof(int) * 256 * cap);
+        if (next) p->dfa_next = next;
+        signed char *accept = realloc(p->dfa_accept, cap);
+        if (accept) p->dfa_accept = accept;
+        signed char *all = realloc(p->dfa_all, cap);
+        if (all) p->dfa_all = all;
+        if (!sets || !next || !accept || !all) {
+            return DFA_FULL;
+        }
+        p->dfa_cap = cap;
+    }
+
+    int d = p->ndfa++;
+    memcpy(p->dfa_sets + (size_t)d * p->words, set, bytes);
+    for (int c = 0; c < 256; c++) {
+        p->dfa_next[(size_t)d * 256 + c] = DFA_UNBUILT;
+    }
+    p->dfa_accept[d] = 0;
+    for (int s = 0; s < p->nnfa; s++) {
+        if (((set[s / 64] >> (s % 64)) & 1) && p->nfa[s].type == NFA_MATCH) {
+            p->dfa_accept[d] = 1;
+        }
+    }
+    p->dfa_all[d] = -1;
+    p->slots[slot] = d;
+
+    if (p->ndfa * 2 > p->nslots) {
+        int *old = p->slots;
+        p->slots = NULL;
+        if (rehash_dfa(p, p->nslots * 2) != 0) {
+            p->slots = old;   // keep the fuller table, still correct
+            return d;
+        }
+        free(old);
+        for (int e = 0; e < p->ndfa; e++) {
+            int sl = (int)(hash_set(p->dfa_sets + (size_t)e * p->words, p->words) & (uint32_t)(p->nslots - 1));
+            while (p->slots[sl] != -1) {
+                sl = (sl + 1) & (p->nslots - 1);
+            }
+            p->slots[sl] = e;
+        }
+    }
+    return d;
+}
+
+typedef struct walker{
+    struct pattern *p;
+    struct term *terms;
+    uint64_t *scratch;   // one NFA set
+    int *stack;          // closure work list
+    int *lo, *hi;        // matching ranges
+    int nranges, cap;
+    int failed;
+} walker;
+
+static int dfa_step(walker *w, int d, unsigned char c)
+{
+    struct pattern *p = w->p;
+    int *next = &p->dfa_next[(size_t)d * 256 + c];
+    if (*next != DFA_UNBUILT) {
+        return *next;
+    }
+
+    const uint64_t *set = p->dfa_sets + (size_t)d * p->words;
+    memset(w->scratch, 0, sizeof(uint64_t) * p->words);
+    for (int s = 0; s < p->nnfa; s++) {
+        const struct nfa_state *st = &p->nfa[s];
+        if (((set[s / 64] >> (s % 64)) & 1) && st->type == NFA_SET
+            && ((st->set[c / 64] >> (c % 64)) & 1)) {
+            w->scratch[st->out / 64] |= (uint64_t)1 << (st->out % 64);
+        }
+    }
+    closure(p, w->scratch, w->stack);
+    int to = dfa_state(p, w->scratch);
+    if (to == DFA_FULL) {
+        return to;   // not cached: the walk is abandoned anyway
+    }
+    // dfa_state() may have moved the transition tables
+    p->dfa_next[(size_t)d * 256 + c] = to;
+    return to;
+}
+
+// 1 if every continuation of d is accepted (e.g. after a trailing ".*")
+static int dfa_accepts_all(walker *w, int d)
+{
+    struct pattern *p = w->p;
+    if (p->dfa_all[d] == -1) {
+        int all = p->dfa_accept[d];
+        for (int c = 1; c < 256 && all; c++) {
+            all = dfa_step(w, d, (unsigned char)c) == d;
+        }
+        p->dfa_all[d] = (signed char)all;
+    }
+    return p->dfa_all[d];
+}
+
+static void add_range(walker *w, int lo, int hi)
+{
+    if (w->nranges > 0 && w->hi[w->nranges - 1] == lo) {
+        w->hi[w->nranges - 1] = hi;   // adjacent: extend
+        return;
+    }
+    if (w->nranges == w->cap) {
+        int cap = w->cap ? w->cap * 2 : 64;
+        int *lo2 = realloc(w->lo, sizeof(int) * cap);
+        if (lo2) w->lo = lo2;
+        int *hi2 = realloc(w->hi, sizeof(int) * cap);
+        if (hi2) w->hi = hi2;
+        if (!lo2 || !hi2) {
+            w->failed = 1;
+            return;
+        }
+        w->cap = cap;
+    }
+    w->lo[w->nranges] = lo;
+    w->hi[w->nranges] = hi;
+    w->nranges++;
+}
+
+/*
+ * Terms [lo, hi) share their first depth bytes, which drove the DFA to d.
+ * Splits the range by the next byte and follows each live transition.
+ */
+static void walk(walker *w, int lo, int hi, int depth, int d)
+{
+    if (w->failed) {
+        return;
+    }
+    if (dfa_accepts_all(w, d)) {
+        add_range(w, lo, hi);
+        return;
+    }
+
+    // Terms ending here sort first
+    int i = lo;
+    while (i < hi && w->terms[i].term[depth] == '\0') {
+        i++;
+    }
+    if (i > lo && w->p->dfa_accept[d]) {
+        add_range(w, lo, i);
+    }
+
+    while (i < hi && !w->failed) {
+        unsigned char c = (unsigned char)w->terms[i].term[depth];
+        // First term in [i, hi) whose byte at depth is greater than c
+        int left = i + 1, right = hi;
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if ((unsigned char)w->terms[mid].term[depth] <= c) left = mid + 1;
+            else right = mid;
+        }
+        int to = dfa_step(w, d, c);
+        if (to == DFA_FULL) {
+            w->failed = 1;
+        } else if (to != DFA_DEAD) {
+            walk(w, i, left, depth + 1, to);
+        }
+        i = left;
+    }
+}
+
+static double term_weight(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+/*
+ * pattern_autocomplete():
+ *   - Returns the k heaviest terms matched by p, best first.
+ *   - rm is the optional range_max of the main array.
+ *
+ * Approach:
+ *   - The sorted array is walked like a trie: a range of terms sharing a
+ *     prefix is split by its next byte with binary searches, and a branch
+ *     is dropped as soon as the DFA dies. Once the DFA accepts every
+ *     continuation the whole range matches without being read.
+ *   - Matching ranges go to top_k_ranges(), so results come out in weight
+ *     order without sorting every match.
+ *
+ * Edge cases:
+ *   - If the pattern needs more than PATTERN_MAX_DFA states, prints an
+ *     error and returns no results.
+ *   - p caches DFA states between calls, so it must not be shared by
+ *     concurrent queries.
+ */
+void pattern_autocomplete(struct term **answer, int *n_answer, struct pattern *p,
+                          struct term *terms, int nterms, const struct range_max *rm, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!p || !terms || nterms <= 0 || k <= 0) {
+        return;
+    }
+    if (k > nterms) {
+        k = nterms;
+    }
+
+    walker w;
+    memset(&w, 0, sizeof(w));
+    w.p = p;
+    w.terms = terms;
+    w.scratch = malloc(sizeof(uint64_t) * p->words);
+    w.stack = malloc(sizeof(int) * p->nnfa);
+    int *ids = malloc(sizeof(int) * k);
+    if (!w.scratch || !w.stack || !ids) {
+        fprintf(stderr, "Error: Could not allocate memory for pattern query.\n");
+        free(w.scratch);
+        free(w.stack);
+        free(ids);
+        return;
+    }
+
+    if (p->ndfa == 0) {
+        memset(w.scratch, 0, sizeof(uint64_t) * p->words);
+        w.scratch[p->start / 64] |= (uint64_t)1 << (p->start % 64);
+        closure(p, w.scratch, w.stack);
+        w.failed = dfa_state(p, w.scratch) != 0;
+    }
+    if (!w.failed) {
+        walk(&w, 0, nterms, 0, 0);
+    }
+
+    if (w.failed) {
+        fprintf(stderr, "Error: Pattern too complex or out of memory.\n");
+    } else {
+        int count = rm ? top_k_ranges(rm, w.lo, w.hi, w.nranges, k, NULL, NULL, ids)
+                       : top_k_scan_ranges(w.lo, w.hi, w.nranges, k, term_weight, terms, ids);
+        terms_from_ids(answer, n_answer, terms, ids, count);
+    }
+    free(w.scratch);
+    free(w.stack);
+    free(w.lo);
+    free(w.hi);
+    free(ids);
+}
+
+void free_pattern(struct pattern *p)
+{
+    if (!p) {
+        return;
+    }
+    free(p->nfa);
+    free(p->dfa_sets);
+    free(p->dfa_next);
+    free(p->dfa_accept);
+    free(p->dfa_all);
+    free(p->slots);
+    free(p);
+}
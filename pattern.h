@@ -0,0 +1,49 @@
+#if !defined(PATTERN_H)
+#define PATTERN_H
+
+#include <stdint.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+// Pattern syntaxes accepted by compile_pattern().
+#define PATTERN_GLOB 0   // ?, *, [set]; must match the whole term ("S?n *")
+#define PATTERN_REGEX 1  // . [set] * + ? | ( ) with optional ^ and $ anchors ("^Port.*al")
+
+// Most DFA states a pattern may expand to before the query is refused.
+#define PATTERN_MAX_DFA 4096
+
+/*
+ * Thompson NFA state: a byte set with one successor, an epsilon split with
+ * up to two successors, or the final match state.
+ */
+typedef struct nfa_state{
+    int type;
+    int out, out1;
+    uint64_t set[4];
+} nfa_state;
+
+/*
+ * Compiled pattern. The NFA is fixed at compile time; DFA states are made
+ * on demand (subset construction) while the pattern walks the term array,
+ * so only the states a dictionary actually reaches are ever built.
+ */
+typedef struct pattern{
+    int nnfa;
+    struct nfa_state *nfa;
+    int start;                // NFA start state
+    int words;                // uint64 words per NFA state set
+    int ndfa, dfa_cap;
+    uint64_t *dfa_sets;       // NFA set of every DFA state
+    int *dfa_next;            // 256 transitions per DFA state, -2 = not built yet
+    signed char *dfa_accept;  // 1 if the state contains the match state
+    signed char *dfa_all;     // 1 if every continuation matches, -1 = unknown
+    int *slots;               // hash table of DFA states by NFA set
+    int nslots;
+} pattern;
+
+void compile_pattern(struct pattern **p, const char *pat, int syntax);
+void pattern_autocomplete(struct term **answer, int *n_answer, struct pattern *p,
+                          struct term *terms, int nterms, const struct range_max *rm, int k);
+void free_pattern(struct pattern *p);
+
+#endif
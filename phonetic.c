@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "phonetic.h"
+#include "arena.h"
+
+#define TRANSPARENT 'h'
+
+/*
+ * Soundex consonant class of a lowercase letter.
+ * Vowels (and y) return 0 and separate repeated classes; h and w are
+ * TRANSPARENT and do not.
+ */
+static char letter_class(char c)
+{
+    switch (c) {
+    case 'b': case 'f': case 'p': case 'v':
+        return '1';
+    case 'c': case 'g': case 'j': case 'k': case 'q': case 's': case 'x': case 'z':
+        return '2';
+    case 'd': case 't':
+        return '3';
+    case 'l':
+        return '4';
+    case 'm': case 'n':
+        return '5';
+    case 'r':
+        return '6';
+    case 'h': case 'w':
+        return TRANSPARENT;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * phonetic_key():
+ *   - Writes the sound-alike key of s into key (at most cap-1 bytes).
+ *   - Each word becomes its consonant classes with repeats collapsed, and
+ *     words are joined by single spaces; words without consonants vanish.
+ *   - A few spellings are folded first: "ph" sounds like f, a non-initial
+ *     "gh" is silent, and initial "kn", "gn", "pn", "wr" drop their first letter.
+ *
+ * Example: "Philadelphia" and "Filadelfia" both give "14341".
+ */
+void phonetic_key(const char *s, char *key, int cap)
+{
+    int len = 0;
+    while (*s && len < cap - 1) {
+        // Skip to the next word
+        while (*s && !isalpha((unsigned char)*s)) {
+            s++;
+        }
+        const char *word = s;
+        while (*s && isalpha((unsigned char)*s)) {
+            s++;
+        }
+        int wlen = (int)(s - word);
+        if (wlen == 0) {
+            break;
+        }
+
+        int start = len;
+        if (len > 0 && len < cap - 1) {
+            key[len++] = ' ';
+        }
+        int coded = 0;
+        char last = 0;
+        for (int i = 0; i < wlen && len < cap - 1; i++) {
+            char c = (char)tolower((unsigned char)word[i]);
+            char next = i + 1 < wlen ? (char)tolower((unsigned char)word[i + 1]) : 0;
+            char code;
+
+            if (i == 0 && next == 'n' && (c == 'k' || c == 'g' || c == 'p')) {
+                continue;
+            }
+            if (i == 0 && c == 'w' && next == 'r') {
+                continue;
+            }
+            if (c == 'p' && next == 'h') {
+                code = '1';
+                i++;
+            } else if (c == 'g' && next == 'h' && i > 0) {
+                i++;
+                continue;
+            } else {
+                code = letter_class(c);
+            }
+
+            if (code == TRANSPARENT) {
+                continue;
+            }
+            if (code == 0) {
+                last = 0;
+                continue;
+            }
+            if (code != last) {
+                key[len++] = code;
+                coded++;
+            }
+            last = code;
+        }
+        if (coded == 0) {
+            len = start;    // drop the separator of an all-vowel word
+        }
+    }
+    key[len] = '\0';
+}
+
+// Index being sorted by build_phonetic_index() (qsort has no context argument)
+static const struct phonetic_index *sort_index;
+
+static int compare_key(const void *a, const void *b)
+{
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    int cmp = strcmp(sort_index->pool + sort_index->key_off[i],
+                     sort_index->pool + sort_index->key_off[j]);
+    if (cmp != 0) return cmp;
+    return i - j;
+}
+
+static const char *entry_key(const void *ctx, int i)
+{
+    const struct phonetic_index *idx = (const struct phonetic_index *)ctx;
+    return idx->pool + idx->key_off[i];
+}
+
+static double entry_weight(const void *ctx, int i)
+{
+    const struct phonetic_index *idx = (const struct phonetic_index *)ctx;
+    return idx->terms[idx->term_id[i]].weight;
+}
+
+/*
+ * build_phonetic_index():
+ *   - Computes the key of every term, sorts the entries by key and builds a
+ *     range_max over them: one pass plus one sort, like read_in_terms().
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *idx = NULL.
+ */
+void build_phonetic_index(struct phonetic_index **idx, struct term *terms, int nterms)
+{
+    build_phonetic_index_arena(idx, terms, nterms, NULL);
+}
+
+/*
+ * build_phonetic_index_arena():
+ *   - build_phonetic_index() allocating the index from arena (malloc if
+ *     NULL); the sort permutation is temporary heap memory.
+ */
+void build_phonetic_index_arena(struct phonetic_index **idx, struct term *terms, int nterms,
+                                struct arena *arena)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    // A key is never longer than its term
+    size_t pool_size = 0;
+    for (int i = 0; i < nterms; i++) {
+        pool_size += strlen(terms[i].term) + 1;
+    }
+
+    struct phonetic_index *p = arena_calloc(arena, 1, sizeof(struct phonetic_index));
+    int *order = malloc(sizeof(int) * nterms);
+    int *offsets = malloc(sizeof(int) * nterms);
+    if (p) {
+        p->arena = arena;
+        p->pool = arena_alloc(arena, pool_size);
+        p->key_off = arena_alloc(arena, sizeof(int) * nterms);
+        p->term_id = arena_alloc(arena, sizeof(int) * nterms);
+    }
+    if (!p || !order || !offsets || !p->pool || !p->key_off || !p->term_id) {
+        fprintf(stderr, "Error: Could not allocate memory for phonetic index.\n");
+        free(order);
+        free(offsets);
+        free_phonetic_index(p);
+        return;
+    }
+    p->n = nterms;
+    p->terms = terms;
+
+    size_t used = 0;
+    for (int i = 0; i < nterms; i++) {
+        phonetic_key(terms[i].term, p->pool + used, (int)(strlen(terms[i].term) + 1));
+        p->key_off[i] = (int)used;
+        order[i] = i;
+        used += strlen(p->pool + used) + 1;
+    }
+
+    sort_index = p;
+    qsort(order, nterms, sizeof(int), compare_key);
+    sort_index = NULL;
+
+    for (int e = 0; e < nterms; e++) {
+        offsets[e] = p->key_off[order[e]];
+        p->term_id[e] = order[e];
+    }
+    memcpy(p->key_off, offsets, sizeof(int) * nterms);
+    free(order);
+    free(offsets);
+
+    if (build_range_max_arena(&p->rm, nterms, entry_weight, p, arena) != 0) {
+        free_phonetic_index(p);
+        return;
+    }
+    *idx = p;
+}
+
+/*
+ * Sets [lo[r], hi[r]) to the entries whose key starts with the key of the
+ * partial query substr, or of one of its completions, and returns the
+ * number of ranges (0 to 2).
+ *
+ * Two rules look at the next letter, which the user may not have typed
+ * yet: a trailing "g" may become a silent "gh", and a final one-letter
+ * word "k", "g", "p" or "w" may become "kn", "gn", "pn" or "wr" and lose
+ * its sound. Either way the completion's key may lack the last letter's
+ * code, so the key of substr without that letter is searched as well.
+ */
+static int phonetic_ranges(const struct phonetic_index *idx, const char *substr, int *lo, int *hi)
+{
+    char key[sizeof(((struct term *)0)->term)];
+    int nranges = 0;
+    phonetic_key(substr, key, sizeof(key));
+    if (key[0] != '\0' && sorted_prefix_range(idx->n, entry_key, idx, key, &lo[0], &hi[0]) > 0) {
+        nranges = 1;
+    }
+
+    size_t len = strlen(substr);
+    if (len == 0 || len >= sizeof(key) || !isalpha((unsigned char)substr[len - 1])) {
+        return nranges;
+    }
+    char last = (char)tolower((unsigned char)substr[len - 1]);
+    int word_start = len == 1 || !isalpha((unsigned char)substr[len - 2]);
+    if (last != 'g' && !(word_start && (last == 'k' || last == 'p' || last == 'w'))) {
+        return nranges;
+    }
+
+    char shorter[sizeof(key)];
+    memcpy(shorter, substr, len - 1);
+    shorter[len - 1] = '\0';
+    phonetic_key(shorter, key, sizeof(key));
+    int alo, ahi;
+    if (key[0] == '\0' || sorted_prefix_range(idx->n, entry_key, idx, key, &alo, &ahi) == 0) {
+        return nranges;
+    }
+    // Prefix ranges either nest or are disjoint
+    if (nranges == 1 && (alo > lo[0] || ahi < hi[0])) {
+        if (hi[0] <= alo) {
+            lo[1] = alo;
+            hi[1] = ahi;
+        } else {
+            lo[1] = lo[0];
+            hi[1] = hi[0];
+            lo[0] = alo;
+            hi[0] = ahi;
+        }
+        return 2;
+    }
+    lo[0] = alo;
+    hi[0] = ahi;
+    return 1;
+}
+
+/*
+ * Sorts term ids by descending weight, ties by ascending id (the order
+ * merge_top_k() expects). Insertion sort: there are at most k ids.
+ */
+static void sort_by_rank(const struct term *terms, int *ids, int n)
+{
+    for (int i = 1; i < n; i++) {
+        int id = ids[i];
+        int j = i;
+        while (j > 0 && (terms[ids[j - 1]].weight < terms[id].weight
+                         || (terms[ids[j - 1]].weight == terms[id].weight && ids[j - 1] > id))) {
+            ids[j] = ids[j - 1];
+            j--;
+        }
+        ids[j] = id;
+    }
+}
+
+/*
+ * phonetic_autocomplete():
+ *   - Returns the k heaviest terms that either start with substr or sound
+ *     like it (their key starts with substr's key), best first and each
+ *     term once.
+ *   - rm is the optional range_max of the main array (see autocomplete_top_k()).
+ *
+ * Approach:
+ *   - Exact and phonetic top-k are selected independently, each in
+ *     O(k log k) range_max queries, and merged by weight; a query costs
+ *     about two ordinary top-k queries.
+ *
+ * Edge cases:
+ *   - A query without consonants has no key and returns exact matches only.
+ *   - A query that may still turn into a silent spelling (see
+ *     phonetic_ranges()) also matches the key without its last letter.
+ */
+void phonetic_autocomplete(struct term **answer, int *n_answer, const struct phonetic_index *idx,
+                           const struct range_max *rm, const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!idx || !substr || k <= 0) {
+        return;
+    }
+    if (k > idx->n) {
+        k = idx->n;
+    }
+
+    int *exact = malloc(sizeof(int) * k);
+    int *sound = malloc(sizeof(int) * k);
+    int *ids = malloc(sizeof(int) * k);
+    if (!exact || !sound || !ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(exact);
+        free(sound);
+        free(ids);
+        return;
+    }
+
+    int nexact = top_k_prefix(idx->terms, idx->n, rm, substr, k, exact);
+
+    int nsound = 0;
+    int lo[2], hi[2];
+    int nranges = phonetic_ranges(idx, substr, lo, hi);
+    if (nranges > 0) {
+        nsound = top_k_ranges(&idx->rm, lo, hi, nranges, k, NULL, NULL, sound);
+        for (int i = 0; i < nsound; i++) {
+            sound[i] = idx->term_id[sound[i]];
+        }
+        sort_by_rank(idx->terms, sound, nsound);
+    }
+
+    int count = merge_top_k(idx->terms, exact, nexact, sound, nsound, k, ids);
+    terms_from_ids(answer, n_answer, idx->terms, ids, count);
+    free(exact);
+    free(sound);
+    free(ids);
+}
+
+void free_phonetic_index(struct phonetic_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    arena_free(idx->arena, idx->pool);
+    arena_free(idx->arena, idx->key_off);
+    arena_free(idx->arena, idx->term_id);
+    free_range_max(&idx->rm);
+    arena_free(idx->arena, idx);
+}
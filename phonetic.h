@@ -0,0 +1,33 @@
+#if !defined(PHONETIC_H)
+#define PHONETIC_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * Optional secondary index of sound-alike keys.
+ * Every term gets a Soundex-style key (consonant classes, vowels dropped,
+ * repeats collapsed) that is not truncated, so a partially typed query's
+ * key is a prefix of the term's key and the index is range-searched exactly
+ * like the main array. Spellings whose sound depends on a letter not typed
+ * yet are searched under both readings. Entries refer to terms by position.
+ */
+typedef struct phonetic_index{
+    int n;
+    char *pool;          // keys, NUL-terminated
+    int *key_off;        // key of entry i in pool, entries in sorted order
+    int *term_id;        // term each entry encodes
+    struct range_max rm; // best term weight over ranges of entries
+    struct term *terms;
+    struct arena *arena; // where the index lives, NULL for the heap
+} phonetic_index;
+
+void phonetic_key(const char *s, char *key, int cap);
+void build_phonetic_index(struct phonetic_index **idx, struct term *terms, int nterms);
+void build_phonetic_index_arena(struct phonetic_index **idx, struct term *terms, int nterms,
+                                struct arena *arena);
+void phonetic_autocomplete(struct term **answer, int *n_answer, const struct phonetic_index *idx,
+                           const struct range_max *rm, const char *substr, int k);
+void free_phonetic_index(struct phonetic_index *idx);
+
+#endif
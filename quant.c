@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "quant.h"
+
+#define QUANT_16_CODES 65535  // codes 1..65535 for positive weights, 0 for the rest
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Maps a float to a uint32 that sorts like it: the sign bit is flipped for
+ * positives and every bit for negatives.
+ */
+static uint32_t float_code(double w)
+{
+    float f = (float)w;
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+static double code_float(uint32_t u)
+{
+    u = (u & 0x80000000u) ? (u & 0x7fffffffu) : ~u;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static uint32_t log_code(const struct quant_weights *qw, double w)
+{
+    if (!(w > 0)) {
+        return 0;
+    }
+    double c = floor((log(w) - qw->log_min) / qw->step + 0.5) + 1;
+    if (c < 1) c = 1;
+    if (c > QUANT_16_CODES) c = QUANT_16_CODES;
+    return (uint32_t)c;
+}
+
+static uint32_t rank_code(const struct quant_weights *qw, double w)
+{
+    int left = 0, right = qw->ntable - 1;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (qw->table[mid] < w) left = mid + 1;
+        else right = mid;
+    }
+    return (uint32_t)left;
+}
+
+/*
+ * build_quant_weights():
+ *   - Encodes the weights of terms in the given format (QUANT_16, QUANT_32
+ *     or QUANT_RANK). The term array itself is not modified.
+ *
+ * Tolerance (how far the order may differ from the double path):
+ *   - QUANT_16: weights within a factor (max/min)^(1/65534) of each other
+ *     may tie, e.g. 0.03% for weights spanning 1 to 10^9. Non-positive
+ *     weights all share the lowest code.
+ *   - QUANT_32: weights that round to the same float (relative gap below
+ *     2^-24) may tie.
+ *   - QUANT_RANK: none, the order and ties are those of the doubles.
+ */
+void build_quant_weights(struct quant_weights **qw, struct term *terms, int nterms, int mode)
+{
+    *qw = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+    if (mode != QUANT_16 && mode != QUANT_32 && mode != QUANT_RANK) {
+        fprintf(stderr, "Error: Unknown weight format %d\n", mode);
+        return;
+    }
+
+    struct quant_weights *q = calloc(1, sizeof(struct quant_weights));
+    if (!q) {
+        fprintf(stderr, "Error: Could not allocate memory for quantized weights.\n");
+        return;
+    }
+    q->n = nterms;
+    q->mode = mode;
+    q->terms = terms;
+
+    if (mode == QUANT_RANK) {
+        q->table = malloc(sizeof(double) * nterms);
+        if (!q->table) {
+            fprintf(stderr, "Error: Could not allocate memory for quantized weights.\n");
+            free_quant_weights(q);
+            return;
+        }
+        for (int i = 0; i < nterms; i++) {
+            q->table[i] = terms[i].weight;
+        }
+        qsort(q->table, nterms, sizeof(double), compare_double);
+        int distinct = 0;
+        for (int i = 0; i < nterms; i++) {
+            if (distinct == 0 || q->table[i] != q->table[distinct - 1]) {
+                q->table[distinct++] = q->table[i];
+            }
+        }
+        q->ntable = distinct;
+        double *table = realloc(q->table, sizeof(double) * distinct);
+        if (table) {
+            q->table = table;
+        }
+    } else if (mode == QUANT_16) {
+        double log_min = 0, log_max = 0;
+        int any = 0;
+        for (int i = 0; i < nterms; i++) {
+            if (terms[i].weight > 0) {
+                double l = log(terms[i].weight);
+                if (!any || l < log_min) log_min = l;
+                if (!any || l > log_max) log_max = l;
+                any = 1;
+            }
+        }
+        q->log_min = log_min;
+        q->step = log_max > log_min ? (log_max - log_min) / (QUANT_16_CODES - 1) : 1.0;
+    }
+
+    q->bits = (mode == QUANT_32 || (mode == QUANT_RANK && q->ntable > 65536)) ? 32 : 16;
+    if (q->bits == 16) {
+        q->code16 = malloc(sizeof(uint16_t) * nterms);
+    } else {
+        q->code32 = malloc(sizeof(uint32_t) * nterms);
+    }
+    if (!q->code16 && !q->code32) {
+        fprintf(stderr, "Error: Could not allocate memory for quantized weights.\n");
+        free_quant_weights(q);
+        return;
+    }
+
+    for (int i = 0; i < nterms; i++) {
+        double w = terms[i].weight;
+        uint32_t c = mode == QUANT_32 ? float_code(w)
+                   : mode == QUANT_16 ? log_code(q, w)
+                   : rank_code(q, w);
+        if (q->bits == 16) {
+            q->code16[i] = (uint16_t)c;
+        } else {
+            q->code32[i] = c;
+        }
+    }
+    *qw = q;
+}
+
+uint32_t quant_code(const struct quant_weights *qw, int i)
+{
+    return qw->bits == 16 ? qw->code16[i] : qw->code32[i];
+}
+
+/*
+ * quant_weight():
+ *   - Weight of term i as decoded from its code (exact for QUANT_RANK,
+ *     within the tolerance of build_quant_weights() otherwise).
+ */
+double quant_weight(const struct quant_weights *qw, int i)
+{
+    uint32_t c = quant_code(qw, i);
+    if (qw->mode == QUANT_RANK) {
+        return qw->table[c];
+    }
+    if (qw->mode == QUANT_32) {
+        return code_float(c);
+    }
+    return c == 0 ? 0.0 : exp(qw->log_min + (double)(c - 1) * qw->step);
+}
+
+/*
+ * quant_value():
+ *   - item_value_fn over a struct quant_weights, ranking by code; pass it
+ *     to build_range_max() to get the range_max used by quant_autocomplete().
+ */
+double quant_value(const void *ctx, int i)
+{
+    return (double)quant_code((const struct quant_weights *)ctx, i);
+}
+
+size_t quant_memory(const struct quant_weights *qw)
+{
+    if (!qw) {
+        return 0;
+    }
+    return sizeof(*qw) + (size_t)qw->n * (qw->bits / 8) + sizeof(double) * (size_t)qw->ntable;
+}
+
+typedef struct coded{
+    uint32_t code;
+    int pos;
+} coded;
+
+static int compare_coded_desc(const void *a, const void *b)
+{
+    const struct coded *x = (const struct coded *)a;
+    const struct coded *y = (const struct coded *)b;
+    if (x->code != y->code) return x->code < y->code ? 1 : -1;
+    return x->pos - y->pos;
+}
+
+/*
+ * quant_top_k():
+ *   - Writes to out[] the positions of the k highest-coded terms in
+ *     [lo, hi), best first (equal codes by position), and returns how
+ *     many were written.
+ *
+ * Approach (radix select):
+ *   - One counting pass per byte of the code, most significant first,
+ *     narrows down the code of the k-th result; a last pass collects the
+ *     terms above it plus the first terms equal to it. Only those k are
+ *     sorted, so the cost is O((bits / 8 + 1) * (hi - lo) + k log k)
+ *     with no comparisons of the range itself.
+ */
+int quant_top_k(const struct quant_weights *qw, int lo, int hi, int k, int *out)
+{
+    if (!qw || k <= 0 || lo >= hi) {
+        return 0;
+    }
+    if (k > hi - lo) {
+        k = hi - lo;
+    }
+
+    uint32_t known = 0, prefix = 0;
+    int need = k;   // results still to take among codes matching prefix
+    for (int shift = qw->bits - 8; shift >= 0; shift -= 8) {
+        int count[256] = { 0 };
+        for (int i = lo; i < hi; i++) {
+            uint32_t c = quant_code(qw, i);
+            if ((c & known) == prefix) {
+                count[(c >> shift) & 255]++;
+            }
+        }
+        int d = 255;
+        while (count[d] < need) {
+            need -= count[d--];
+        }
+        prefix |= (uint32_t)d << shift;
+        known |= (uint32_t)255 << shift;
+    }
+
+    struct coded *picked = malloc(sizeof(struct coded) * k);
+    if (!picked) {
+        fprintf(stderr, "Error: Could not allocate memory for top-k selection.\n");
+        return 0;
+    }
+    int n = 0;
+    for (int i = lo; i < hi; i++) {
+        uint32_t c = quant_code(qw, i);
+        if (c > prefix || (c == prefix && need > 0)) {
+            need -= c == prefix;
+            picked[n].code = c;
+            picked[n].pos = i;
+            n++;
+        }
+    }
+    qsort(picked, n, sizeof(struct coded), compare_coded_desc);
+    for (int i = 0; i < n; i++) {
+        out[i] = picked[i].pos;
+    }
+    free(picked);
+    return n;
+}
+
+/*
+ * quant_autocomplete():
+ *   - Returns the k terms starting with substr with the highest quantized
+ *     weight, best first, each carrying its decoded weight.
+ *   - rm is an optional range_max built with quant_value(); without it the
+ *     prefix range is radix-selected with quant_top_k().
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void quant_autocomplete(struct term **answer, int *n_answer, const struct quant_weights *qw,
+                        const struct range_max *rm, const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!qw) {
+        return;
+    }
+
+    int lo, hi;
+    int count = prefix_range(qw->terms, qw->n, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = rm ? top_k_ranges(rm, &lo, &hi, 1, k, NULL, NULL, ids)
+           : quant_top_k(qw, lo, hi, k, ids);
+    terms_from_ids(answer, n_answer, qw->terms, ids, k);
+    for (int i = 0; i < *n_answer; i++) {
+        (*answer)[i].weight = quant_weight(qw, ids[i]);
+    }
+    free(ids);
+}
+
+void free_quant_weights(struct quant_weights *qw)
+{
+    if (!qw) {
+        return;
+    }
+    free(qw->code16);
+    free(qw->code32);
+    free(qw->table);
+    free(qw);
+}
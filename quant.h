@@ -0,0 +1,45 @@
+#if !defined(QUANT_H)
+#define QUANT_H
+
+#include <stdint.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+// Storage formats accepted by build_quant_weights().
+#define QUANT_16 0    // 16-bit log-scale codes spanning the actual weight range
+#define QUANT_32 1    // 32-bit float bit patterns, relative error below 2^-24
+#define QUANT_RANK 2  // dense ranks into a table of the distinct weights (exact;
+                      // pays off when few weights are distinct)
+
+/*
+ * Compact, order-preserving weight column. Every format maps a larger
+ * weight to a code at least as large, so codes rank terms exactly like
+ * their weights except that weights closer than one quantization step may
+ * tie; ties then rank by position, as they do for equal doubles.
+ * Codes are 2 bytes (QUANT_16, and QUANT_RANK with at most 65536 distinct
+ * weights) or 4 bytes instead of the 8 of a double.
+ */
+typedef struct quant_weights{
+    int n;
+    int mode;
+    int bits;            // 16 or 32: which column holds the codes
+    uint16_t *code16;
+    uint32_t *code32;
+    double log_min;      // QUANT_16: log of the smallest positive weight
+    double step;         // QUANT_16: log-scale width of one code
+    double *table;       // QUANT_RANK: distinct weights, ascending
+    int ntable;
+    struct term *terms;
+} quant_weights;
+
+void build_quant_weights(struct quant_weights **qw, struct term *terms, int nterms, int mode);
+uint32_t quant_code(const struct quant_weights *qw, int i);
+double quant_weight(const struct quant_weights *qw, int i);
+double quant_value(const void *ctx, int i);
+size_t quant_memory(const struct quant_weights *qw);
+int quant_top_k(const struct quant_weights *qw, int lo, int hi, int k, int *out);
+void quant_autocomplete(struct term **answer, int *n_answer, const struct quant_weights *qw,
+                        const struct range_max *rm, const char *substr, int k);
+void free_quant_weights(struct quant_weights *qw);
+
+#endif
@@ -0,0 +1,700 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "repl.h"
+
+// Bytes a sender gathers before one send().
+#define REPL_BATCH 65536
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void timed_wait(pthread_cond_t *cond, pthread_mutex_t *lock, int ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += (long)ms * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+static int send_all(int fd, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int recv_all(int fd, void *data, size_t len)
+{
+    unsigned char *p = (unsigned char *)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int socket_address(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Error: Socket path %s is too long.\n", path);
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+/*
+ * live_update_fn of the leader's dictionary: keeps the encoded record for
+ * the senders, dropping the older half once REPL_RETAIN are held.
+ */
+static void publish(void *ctx, const struct wal_record *rec)
+{
+    struct repl_leader *l = (struct repl_leader *)ctx;
+    pthread_mutex_lock(&l->lock);
+    if (rec->lsn != l->first_lsn + (uint64_t)l->count) {
+        l->count = 0;   // not contiguous: start over, followers behind get a snapshot
+        l->log_len = 0;
+        l->first_lsn = rec->lsn;
+    }
+    if (l->count == REPL_RETAIN) {
+        int drop = l->count / 2;
+        size_t bytes = l->off[drop];
+        memmove(l->log, l->log + bytes, l->log_len - bytes);
+        l->log_len -= bytes;
+        for (int i = drop; i < l->count; i++) {
+            l->off[i - drop] = l->off[i] - bytes;
+            l->stamp[i - drop] = l->stamp[i];
+        }
+        l->count -= drop;
+        l->first_lsn += (uint64_t)drop;
+    }
+
+    if (l->log_len + WAL_MAX_RECORD > l->log_cap) {
+        size_t cap = l->log_cap ? l->log_cap * 2 : 65536;
+        unsigned char *log = realloc(l->log, cap);
+        if (log) {
+            l->log = log;
+            l->log_cap = cap;
+        }
+    }
+    if (l->count == l->off_cap) {
+        int cap = l->off_cap ? l->off_cap * 2 : 1024;
+        size_t *off = realloc(l->off, sizeof(size_t) * cap);
+        double *stamp = off ? realloc(l->stamp, sizeof(double) * cap) : NULL;
+        if (off) {
+            l->off = off;
+        }
+        if (stamp) {
+            l->stamp = stamp;
+            l->off_cap = cap;
+        }
+    }
+    if (l->log_len + WAL_MAX_RECORD <= l->log_cap && l->count < l->off_cap) {
+        l->stamp[l->count] = now_seconds();
+        l->off[l->count++] = l->log_len;
+        l->log_len += wal_encode(rec, l->log + l->log_len);
+    } else {
+        // Out of memory: forget the retained records, followers catch up by snapshot
+        l->count = 0;
+        l->log_len = 0;
+        l->first_lsn = rec->lsn + 1;
+    }
+    pthread_cond_broadcast(&l->changed);
+    pthread_mutex_unlock(&l->lock);
+}
+
+// Last lsn a follower may receive: durable on the leader. Called under l->lock.
+static uint64_t shippable_lsn(struct repl_leader *l)
+{
+    uint64_t last = l->first_lsn + (uint64_t)l->count - 1;
+    struct wal *w = l->ld->wal;
+    if (!w) {
+        return last;
+    }
+    pthread_mutex_lock(&w->lock);
+    uint64_t durable = w->durable_lsn;
+    pthread_mutex_unlock(&w->lock);
+    return durable < last ? durable : last;
+}
+
+/*
+ * Sends the whole dictionary as one 'S' message and sets *next to the
+ * first lsn after it. The terms are copied with live_snapshot(), encoded
+ * and sent once everything they include is durable. Returns 0 or -1.
+ */
+static int send_snapshot(struct repl_leader *l, int fd, uint64_t *next)
+{
+    struct term *terms;
+    int nterms;
+    uint64_t lsn;
+    if (live_snapshot(l->ld, &terms, &nterms, &lsn) != 0) {
+        return -1;
+    }
+    size_t size = 1 + sizeof(uint64_t) + sizeof(int);
+    for (int i = 0; i < nterms; i++) {
+        size += sizeof(double) + 1 + strlen(terms[i].term);
+    }
+    unsigned char *msg = malloc(size);
+    if (msg) {
+        unsigned char *p = msg;
+        *p++ = 'S';
+        memcpy(p, &lsn, sizeof(lsn));
+        p += sizeof(lsn);
+        memcpy(p, &nterms, sizeof(int));
+        p += sizeof(int);
+        for (int i = 0; i < nterms; i++) {
+            size_t len = strlen(terms[i].term);
+            memcpy(p, &terms[i].weight, sizeof(double));
+            p[sizeof(double)] = (unsigned char)len;
+            memcpy(p + sizeof(double) + 1, terms[i].term, len);
+            p += sizeof(double) + 1 + len;
+        }
+    }
+    free(terms);
+    if (!msg) {
+        fprintf(stderr, "Error: Could not allocate memory for snapshot.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&l->lock);
+    while (!l->stopping && l->ld->wal && shippable_lsn(l) < lsn) {
+        timed_wait(&l->changed, &l->lock, REPL_POLL_MS);
+    }
+    int stopping = l->stopping;
+    l->snapshots++;
+    pthread_mutex_unlock(&l->lock);
+
+    int result = stopping ? -1 : send_all(fd, msg, size);
+    free(msg);
+    *next = lsn + 1;
+    return result;
+}
+
+typedef struct sender_arg{
+    struct repl_leader *l;
+    int slot;
+} sender_arg;
+
+/*
+ * Reads the acknowledgements that have arrived from the follower in slot,
+ * without waiting, into l->acked[slot]; *fill bytes of a partial one are
+ * kept in ack. Returns 0, or -1 if the follower is gone.
+ */
+static int read_acks(struct repl_leader *l, int slot, int fd, unsigned char *ack, size_t *fill)
+{
+    for (;;) {
+        ssize_t n = recv(fd, ack + *fill, sizeof(uint64_t) - *fill, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        *fill += (size_t)n;
+        if (*fill == sizeof(uint64_t)) {
+            uint64_t lsn;
+            memcpy(&lsn, ack, sizeof(lsn));
+            pthread_mutex_lock(&l->lock);
+            if (lsn > l->acked[slot]) {
+                l->acked[slot] = lsn;
+            }
+            pthread_mutex_unlock(&l->lock);
+            *fill = 0;
+        }
+    }
+}
+
+/*
+ * One follower: reads the lsn it has applied, sends a snapshot if the
+ * retained records do not reach back to it, then streams records as they
+ * become durable, each batch (or a heartbeat when idle) led by the
+ * durable lsn. Acknowledgements are read between batches.
+ */
+static void *sender(void *arg)
+{
+    struct repl_leader *l = ((struct sender_arg *)arg)->l;
+    int slot = ((struct sender_arg *)arg)->slot;
+    free(arg);
+    pthread_mutex_lock(&l->lock);
+    int fd = l->fds[slot];
+    pthread_mutex_unlock(&l->lock);
+
+    uint64_t applied = 0;
+    unsigned char *buf = malloc(REPL_BATCH);
+    int ok = buf && recv_all(fd, &applied, sizeof(applied)) == 0;
+    pthread_mutex_lock(&l->lock);
+    l->acked[slot] = applied;
+    pthread_mutex_unlock(&l->lock);
+    // Applied lsn 0 means no state yet: always start it with a snapshot
+    uint64_t next = applied > 0 ? applied + 1 : 0;
+    double last_sent = 0;
+    unsigned char ack[sizeof(uint64_t)];
+    size_t ack_fill = 0;
+    while (ok) {
+        if (read_acks(l, slot, fd, ack, &ack_fill) != 0) {
+            break;
+        }
+        pthread_mutex_lock(&l->lock);
+        uint64_t last = l->first_lsn + (uint64_t)l->count - 1;
+        int snapshot = next < l->first_lsn || next > last + 1;
+        uint64_t ship = shippable_lsn(l);
+        if (!l->stopping && !snapshot && next > ship) {
+            timed_wait(&l->changed, &l->lock, REPL_POLL_MS);
+            last = l->first_lsn + (uint64_t)l->count - 1;
+            snapshot = next < l->first_lsn || next > last + 1;
+            ship = shippable_lsn(l);
+        }
+        if (l->stopping) {
+            pthread_mutex_unlock(&l->lock);
+            break;
+        }
+        size_t len = 0;
+        if (!snapshot && next <= ship) {
+            buf[len++] = 'H';
+            memcpy(buf + len, &ship, sizeof(ship));
+            len += sizeof(ship);
+        }
+        while (!snapshot && next <= ship && len + 1 + WAL_MAX_RECORD <= REPL_BATCH) {
+            int i = (int)(next - l->first_lsn);
+            size_t end = i + 1 < l->count ? l->off[i + 1] : l->log_len;
+            buf[len++] = 'R';
+            memcpy(buf + len, l->log + l->off[i], end - l->off[i]);
+            len += end - l->off[i];
+            next++;
+        }
+        pthread_mutex_unlock(&l->lock);
+
+        if (snapshot) {
+            ok = send_snapshot(l, fd, &next) == 0;
+            last_sent = now_seconds();
+            continue;
+        }
+        if (len == 0 && now_seconds() - last_sent >= REPL_HEARTBEAT_MS / 1000.0) {
+            buf[len++] = 'H';
+            memcpy(buf + len, &ship, sizeof(ship));
+            len += sizeof(ship);
+        }
+        if (len > 0) {
+            ok = send_all(fd, buf, len) == 0;
+            last_sent = now_seconds();
+        }
+    }
+    free(buf);
+
+    pthread_mutex_lock(&l->lock);
+    close(fd);
+    l->fds[slot] = -1;
+    l->nsenders--;
+    pthread_cond_broadcast(&l->changed);
+    pthread_mutex_unlock(&l->lock);
+    return NULL;
+}
+
+static void *accept_followers(void *arg)
+{
+    struct repl_leader *l = (struct repl_leader *)arg;
+    for (;;) {
+        int fd = accept(l->listen_fd, NULL, NULL);
+        if (fd < 0 && errno == EINTR) {
+            continue;
+        }
+        pthread_mutex_lock(&l->lock);
+        if (fd < 0 || l->stopping) {
+            pthread_mutex_unlock(&l->lock);
+            if (fd >= 0) {
+                close(fd);
+            }
+            break;
+        }
+        int slot = 0;
+        while (slot < REPL_MAX_FOLLOWERS && l->fds[slot] >= 0) {
+            slot++;
+        }
+        struct sender_arg *sa = slot < REPL_MAX_FOLLOWERS ? malloc(sizeof(struct sender_arg)) : NULL;
+        pthread_t thread;
+        if (sa) {
+            sa->l = l;
+            sa->slot = slot;
+            l->fds[slot] = fd;
+            l->acked[slot] = 0;
+            if (pthread_create(&thread, NULL, sender, sa) == 0) {
+                pthread_detach(thread);
+                l->nsenders++;
+            } else {
+                l->fds[slot] = -1;
+                free(sa);
+                sa = NULL;
+            }
+        }
+        pthread_mutex_unlock(&l->lock);
+        if (!sa) {
+            fprintf(stderr, "Error: Could not serve another follower.\n");
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * start_leader():
+ *   - Serves ld's updates to followers connecting on the Unix socket at
+ *     socket_path (replacing any stale socket file). ld must outlive the
+ *     leader; updates made through live_set_weight() are shipped.
+ *
+ * Edge cases addressed:
+ *   - On failure prints an error and sets *l = NULL.
+ */
+void start_leader(struct repl_leader **l, struct live_dictionary *ld, const char *socket_path)
+{
+    *l = NULL;
+    struct sockaddr_un addr;
+    if (!ld || socket_address(&addr, socket_path) != 0) {
+        return;
+    }
+    struct repl_leader *r = calloc(1, sizeof(struct repl_leader));
+    if (!r || !(r->path = strdup(socket_path))) {
+        fprintf(stderr, "Error: Could not allocate memory for replication.\n");
+        free(r);
+        return;
+    }
+    r->ld = ld;
+    for (int s = 0; s < REPL_MAX_FOLLOWERS; s++) {
+        r->fds[s] = -1;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->changed, NULL);
+
+    unlink(socket_path);
+    r->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (r->listen_fd < 0 || bind(r->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+        || listen(r->listen_fd, REPL_MAX_FOLLOWERS) != 0) {
+        fprintf(stderr, "Error: Could not listen on %s.\n", socket_path);
+        if (r->listen_fd >= 0) {
+            close(r->listen_fd);
+        }
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->changed);
+        free(r->path);
+        free(r);
+        return;
+    }
+
+    // From here on every update is published, in lsn order
+    pthread_rwlock_wrlock(&ld->lock);
+    r->first_lsn = ld->lsn + 1;
+    ld->on_update_ctx = r;
+    ld->on_update = publish;
+    pthread_rwlock_unlock(&ld->lock);
+
+    if (pthread_create(&r->accept_thread, NULL, accept_followers, r) != 0) {
+        fprintf(stderr, "Error: Could not start replication.\n");
+        r->accept_thread = pthread_self();
+        stop_leader(r);
+        return;
+    }
+    *l = r;
+}
+
+/*
+ * leader_lag():
+ *   - For each connected follower, in slot order, writes to lsn_lag[] the
+ *     durable updates it has not acknowledged and to seconds[] the age of
+ *     the oldest of them (0 when caught up; at least the age of the oldest
+ *     retained record if it is further behind). Both arrays hold
+ *     REPL_MAX_FOLLOWERS entries. Returns the number of followers.
+ */
+int leader_lag(struct repl_leader *l, uint64_t *lsn_lag, double *seconds)
+{
+    pthread_mutex_lock(&l->lock);
+    uint64_t ship = shippable_lsn(l);
+    double now = now_seconds();
+    int n = 0;
+    for (int s = 0; s < REPL_MAX_FOLLOWERS; s++) {
+        if (l->fds[s] < 0) {
+            continue;
+        }
+        lsn_lag[n] = ship > l->acked[s] ? ship - l->acked[s] : 0;
+        seconds[n] = 0;
+        if (lsn_lag[n] > 0 && l->count > 0) {
+            uint64_t oldest = l->acked[s] + 1 > l->first_lsn ? l->acked[s] + 1 : l->first_lsn;
+            int i = (int)(oldest - l->first_lsn);
+            seconds[n] = i < l->count ? now - l->stamp[i] : 0;
+        }
+        n++;
+    }
+    pthread_mutex_unlock(&l->lock);
+    return n;
+}
+
+/*
+ * stop_leader():
+ *   - Disconnects every follower, stops shipping ld's updates and removes
+ *     the socket file. ld itself is left open.
+ */
+void stop_leader(struct repl_leader *l)
+{
+    if (!l) {
+        return;
+    }
+    pthread_rwlock_wrlock(&l->ld->lock);
+    l->ld->on_update = NULL;
+    l->ld->on_update_ctx = NULL;
+    pthread_rwlock_unlock(&l->ld->lock);
+
+    pthread_mutex_lock(&l->lock);
+    l->stopping = 1;
+    pthread_cond_broadcast(&l->changed);
+    pthread_mutex_unlock(&l->lock);
+    shutdown(l->listen_fd, SHUT_RDWR);
+    if (!pthread_equal(l->accept_thread, pthread_self())) {
+        pthread_join(l->accept_thread, NULL);
+    }
+    close(l->listen_fd);
+
+    pthread_mutex_lock(&l->lock);
+    for (int s = 0; s < REPL_MAX_FOLLOWERS; s++) {
+        if (l->fds[s] >= 0) {
+            shutdown(l->fds[s], SHUT_RDWR);
+        }
+    }
+    while (l->nsenders > 0) {
+        pthread_cond_wait(&l->changed, &l->lock);
+    }
+    pthread_mutex_unlock(&l->lock);
+
+    unlink(l->path);
+    pthread_mutex_destroy(&l->lock);
+    pthread_cond_destroy(&l->changed);
+    free(l->log);
+    free(l->off);
+    free(l->stamp);
+    free(l->path);
+    free(l);
+}
+
+/*
+ * Records what the follower has applied and heard (0 if nothing new).
+ * behind_since is when the leader reported behind_lsn, the oldest lsn
+ * heard and not applied yet as far as is known; once it is applied the
+ * latest report takes its place. Acknowledges the applied lsn to the
+ * leader if ack is set or it has just caught up. Returns 0, or -1 if the
+ * ack failed.
+ */
+static int note_progress(struct repl_follower *f, uint64_t applied, uint64_t heard, int ack)
+{
+    pthread_mutex_lock(&f->lock);
+    f->applied_lsn = applied;
+    if (heard > f->leader_lsn) {
+        f->leader_lsn = heard;
+        f->heard_at = now_seconds();
+    }
+    if (f->applied_lsn >= f->leader_lsn) {
+        ack = ack || f->behind_since != 0;   // just caught up
+        f->behind_since = 0;
+    } else if (f->behind_since == 0 || f->applied_lsn >= f->behind_lsn) {
+        f->behind_lsn = f->leader_lsn;
+        f->behind_since = f->heard_at;
+    }
+    pthread_mutex_unlock(&f->lock);
+    return ack ? send_all(f->fd, &applied, sizeof(applied)) : 0;
+}
+
+// Reads one 'S' message body into a new dictionary state. Returns 0 or -1.
+static int receive_snapshot(struct repl_follower *f)
+{
+    uint64_t lsn;
+    int n;
+    if (fread(&lsn, sizeof(lsn), 1, f->in) != 1 || fread(&n, sizeof(int), 1, f->in) != 1 || n < 0) {
+        return -1;
+    }
+    struct term *terms = malloc(sizeof(struct term) * (n > 0 ? n : 1));
+    if (!terms) {
+        fprintf(stderr, "Error: Could not allocate memory for snapshot.\n");
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        int len;
+        if (fread(&terms[i].weight, sizeof(double), 1, f->in) != 1
+            || (len = fgetc(f->in)) == EOF || len >= (int)sizeof(terms[i].term)
+            || fread(terms[i].term, 1, len, f->in) != (size_t)len) {
+            free(terms);
+            return -1;
+        }
+        terms[i].term[len] = '\0';
+    }
+    if (live_replace(f->ld, terms, n, lsn) != 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&f->lock);
+    f->snapshots++;
+    pthread_mutex_unlock(&f->lock);
+    return note_progress(f, lsn, lsn, 1);
+}
+
+static void *follow(void *arg)
+{
+    struct repl_follower *f = (struct repl_follower *)arg;
+    unsigned char rec_buf[WAL_MAX_RECORD];
+    for (;;) {
+        int type = fgetc(f->in);
+        if (type == 'R') {
+            struct wal_record rec;
+            uint32_t plen;
+            if (fread(rec_buf, WAL_HEADER, 1, f->in) != 1) {
+                break;
+            }
+            memcpy(&plen, rec_buf + 4, sizeof(plen));
+            if (plen > WAL_MAX_RECORD - WAL_HEADER
+                || fread(rec_buf + WAL_HEADER, 1, plen, f->in) != plen
+                || wal_decode(rec_buf, WAL_HEADER + plen, &rec) <= 0
+                || live_apply(f->ld, &rec) != 0) {
+                break;
+            }
+            pthread_mutex_lock(&f->lock);
+            f->records++;
+            pthread_mutex_unlock(&f->lock);
+            if (note_progress(f, rec.lsn, 0, 0) != 0) {
+                break;
+            }
+        } else if (type == 'H') {
+            uint64_t lsn;
+            if (fread(&lsn, sizeof(lsn), 1, f->in) != 1) {
+                break;
+            }
+            pthread_mutex_lock(&f->lock);
+            uint64_t applied = f->applied_lsn;
+            pthread_mutex_unlock(&f->lock);
+            if (note_progress(f, applied, lsn, 1) != 0) {
+                break;
+            }
+        } else if (type != 'S' || receive_snapshot(f) != 0) {
+            break;   // leader gone, or a malformed message
+        }
+    }
+    pthread_mutex_lock(&f->lock);
+    f->connected = 0;
+    pthread_mutex_unlock(&f->lock);
+    return NULL;
+}
+
+/*
+ * start_follower():
+ *   - Connects to the leader at socket_path and keeps an in-memory copy
+ *     of its dictionary up to date from a background thread. A new
+ *     follower always starts with a snapshot.
+ *
+ * Edge cases addressed:
+ *   - On failure prints an error and sets *f = NULL.
+ */
+void start_follower(struct repl_follower **f, const char *socket_path)
+{
+    *f = NULL;
+    struct sockaddr_un addr;
+    if (socket_address(&addr, socket_path) != 0) {
+        return;
+    }
+    struct repl_follower *r = calloc(1, sizeof(struct repl_follower));
+    if (!r) {
+        fprintf(stderr, "Error: Could not allocate memory for replication.\n");
+        return;
+    }
+    open_live_dictionary(&r->ld, NULL, NULL, NULL);
+    if (!r->ld) {
+        free(r);
+        return;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+
+    uint64_t applied = r->ld->lsn;
+    r->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int ok = r->fd >= 0 && connect(r->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0
+          && send_all(r->fd, &applied, sizeof(applied)) == 0
+          && (r->in = fdopen(r->fd, "rb")) != NULL;
+    if (ok) {
+        r->connected = 1;
+        ok = pthread_create(&r->thread, NULL, follow, r) == 0;
+        if (!ok) {
+            r->connected = 0;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Could not follow the leader at %s.\n", socket_path);
+        if (r->in) {
+            fclose(r->in);
+        } else if (r->fd >= 0) {
+            close(r->fd);
+        }
+        close_live_dictionary(r->ld);
+        pthread_mutex_destroy(&r->lock);
+        free(r);
+        return;
+    }
+    *f = r;
+}
+
+/*
+ * follower_lag():
+ *   - Replication lag as of the last lsn the leader sent, which leads
+ *     every batch: the number of updates not applied yet, and how many
+ *     seconds ago the oldest of them was reported (0 when caught up).
+ *     leader_lag() gives the leader's view from the acknowledgements.
+ */
+void follower_lag(struct repl_follower *f, uint64_t *lsn_lag, double *seconds)
+{
+    pthread_mutex_lock(&f->lock);
+    *lsn_lag = f->leader_lsn > f->applied_lsn ? f->leader_lsn - f->applied_lsn : 0;
+    *seconds = f->behind_since > 0 ? now_seconds() - f->behind_since : 0;
+    pthread_mutex_unlock(&f->lock);
+}
+
+/*
+ * stop_follower():
+ *   - Disconnects from the leader and frees the follower and its copy.
+ */
+void stop_follower(struct repl_follower *f)
+{
+    if (!f) {
+        return;
+    }
+    shutdown(f->fd, SHUT_RDWR);
+    pthread_join(f->thread, NULL);
+    fclose(f->in);
+    close_live_dictionary(f->ld);
+    pthread_mutex_destroy(&f->lock);
+    free(f);
+}
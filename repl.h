@@ -0,0 +1,83 @@
+#if !defined(REPL_H)
+#define REPL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "live.h"
+
+// Updates the leader keeps in memory for followers that fall behind;
+// a follower further behind is sent a snapshot instead.
+#define REPL_RETAIN 65536
+// Most followers one leader serves.
+#define REPL_MAX_FOLLOWERS 16
+// Idle interval after which the leader sends its lsn, so lag stays current.
+#define REPL_HEARTBEAT_MS 100
+// How often an idle sender checks for newly durable records.
+#define REPL_POLL_MS 5
+
+/*
+ * Log-shipping replication over a local (Unix domain) socket.
+ *
+ * The leader wraps a live_dictionary, keeps its latest updates in memory
+ * as encoded log records, and serves each follower from its own thread.
+ * A follower connects with the last lsn it applied; if the leader still
+ * holds every record after it, the follower just tails the log, otherwise
+ * it first receives a snapshot of the whole dictionary. Only records that
+ * are durable on the leader are shipped.
+ *
+ * Every batch of records starts with the leader's durable lsn, which is
+ * also sent alone when idle, so a follower knows how far behind it is
+ * even while records stream in. The follower acknowledges the lsn it has
+ * applied, which gives the leader each follower's lag too.
+ *
+ * Messages from the leader, native byte order:
+ *   'R' log record (wal_encode() format)
+ *   'S' uint64 lsn, int n, n x (double weight, byte length, term bytes)
+ *   'H' uint64 lsn of the leader's last durable update
+ * From the follower: uint64 lsn it has applied, first on connecting, then
+ * after each 'H' or snapshot and whenever it catches up.
+ */
+typedef struct repl_leader{
+    struct live_dictionary *ld;
+    char *path;
+    int listen_fd;
+    pthread_t accept_thread;
+    pthread_mutex_t lock;       // guards everything below
+    pthread_cond_t changed;     // new record published, or stopping
+    unsigned char *log;         // retained records, back to back
+    size_t log_len, log_cap;
+    size_t *off;                // record of lsn first_lsn + i at log + off[i]
+    double *stamp;              // and when it was published
+    int count, off_cap;
+    uint64_t first_lsn;
+    int stopping;
+    int fds[REPL_MAX_FOLLOWERS];    // follower sockets, -1 for a free slot
+    uint64_t acked[REPL_MAX_FOLLOWERS];     // last lsn each follower applied
+    int nsenders;               // running sender threads
+    long snapshots;             // snapshots sent
+} repl_leader;
+
+typedef struct repl_follower{
+    struct live_dictionary *ld; // in-memory copy, query it with live_autocomplete()
+    int fd;
+    FILE *in;
+    pthread_t thread;
+    pthread_mutex_t lock;       // guards the fields below
+    uint64_t applied_lsn;       // last update applied to ld
+    uint64_t leader_lsn;        // latest lsn heard from the leader
+    double heard_at;            // when it was heard
+    uint64_t behind_lsn;        // oldest lsn heard that is not applied yet
+    double behind_since;        // when it was heard, 0 if caught up
+    int connected;
+    long records, snapshots;    // received
+} repl_follower;
+
+void start_leader(struct repl_leader **l, struct live_dictionary *ld, const char *socket_path);
+int leader_lag(struct repl_leader *l, uint64_t *lsn_lag, double *seconds);
+void stop_leader(struct repl_leader *l);
+void start_follower(struct repl_follower **f, const char *socket_path);
+void follower_lag(struct repl_follower *f, uint64_t *lsn_lag, double *seconds);
+void stop_follower(struct repl_follower *f);
+
+#endif
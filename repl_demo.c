@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "repl.h"
+
+/*
+ * Replication demo, every process on one host:
+ *
+ *   ./repl_demo leader cities.txt /tmp/ac.sock ac.ckpt ac.wal
+ *       applies "weight<TAB>term" lines read from stdin and serves them,
+ *       printing each follower's lag at every checkpoint
+ *   ./repl_demo follower /tmp/ac.sock Tor
+ *       prints its lag and the top matches for a prefix every second
+ *
+ * Start followers at any time: each catches up from a snapshot and then
+ * tails the leader's updates.
+ */
+
+#define CHECKPOINT_EVERY 10000   // updates between leader checkpoints
+
+// Prints each follower's lag as the leader sees it from their acknowledgements.
+static void print_leader_lag(struct repl_leader *l)
+{
+    uint64_t lag[REPL_MAX_FOLLOWERS];
+    double seconds[REPL_MAX_FOLLOWERS];
+    int n = leader_lag(l, lag, seconds);
+    printf("leader: %d followers", n);
+    for (int i = 0; i < n; i++) {
+        printf("%s %llu updates / %.3f s", i ? "," : ":", (unsigned long long)lag[i], seconds[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static int run_leader(char *terms_file, const char *socket_path,
+                      const char *checkpoint_path, const char *wal_path)
+{
+    struct live_dictionary *ld;
+    open_live_dictionary(&ld, checkpoint_path, wal_path, terms_file);
+    if (!ld) {
+        return 1;
+    }
+    struct repl_leader *l;
+    start_leader(&l, ld, socket_path);
+    if (!l) {
+        close_live_dictionary(ld);
+        return 1;
+    }
+    printf("leader: %d terms at lsn %llu, serving %s\n",
+           ld->nterms, (unsigned long long)ld->lsn, socket_path);
+
+    char line[256];
+    long updates = 0;
+    while (fgets(line, sizeof(line), stdin)) {
+        char *tab = strchr(line, '\t');
+        if (!tab) {
+            fprintf(stderr, "Error: Expected \"weight<TAB>term\".\n");
+            continue;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (live_set_weight(ld, tab + 1, atof(line)) == 0 && ++updates % CHECKPOINT_EVERY == 0) {
+            live_checkpoint(ld);
+            print_leader_lag(l);
+        }
+    }
+    printf("leader: %ld updates, lsn %llu, %ld snapshots sent\n",
+           updates, (unsigned long long)ld->lsn, l->snapshots);
+    stop_leader(l);
+    close_live_dictionary(ld);
+    return 0;
+}
+
+static int run_follower(const char *socket_path, const char *prefix)
+{
+    struct repl_follower *f;
+    start_follower(&f, socket_path);
+    if (!f) {
+        return 1;
+    }
+    for (;;) {
+        sleep(1);
+        uint64_t lag;
+        double seconds;
+        follower_lag(f, &lag, &seconds);
+        pthread_mutex_lock(&f->lock);
+        int connected = f->connected;
+        uint64_t applied = f->applied_lsn;
+        pthread_mutex_unlock(&f->lock);
+
+        struct term *answer;
+        int n_answer;
+        live_autocomplete(&answer, &n_answer, f->ld, prefix, 3);
+        printf("follower: lsn %llu, lag %llu updates / %.3f s:",
+               (unsigned long long)applied, (unsigned long long)lag, seconds);
+        for (int i = 0; i < n_answer; i++) {
+            printf(" %s (%.0f)%s", answer[i].term, answer[i].weight, i + 1 < n_answer ? "," : "");
+        }
+        printf("\n");
+        fflush(stdout);
+        free(answer);
+        if (!connected) {
+            printf("follower: leader disconnected\n");
+            break;
+        }
+    }
+    stop_follower(f);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 6 && strcmp(argv[1], "leader") == 0) {
+        return run_leader(argv[2], argv[3], argv[4], argv[5]);
+    }
+    if (argc == 4 && strcmp(argv[1], "follower") == 0) {
+        return run_follower(argv[2], argv[3]);
+    }
+    fprintf(stderr, "Usage: %s leader terms_file socket checkpoint wal\n"
+                    "       %s follower socket prefix\n", argv[0], argv[0]);
+    return 1;
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reverse.h"
+#include "arena.h"
+
+// Index being sorted by build_reverse_index() (qsort has no context argument)
+static const struct reverse_index *sort_index;
+
+static int compare_reversed(const void *a, const void *b)
+{
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    return strcmp(sort_index->pool + sort_index->key_off[i],
+                  sort_index->pool + sort_index->key_off[j]);
+}
+
+static const char *reversed_key(const void *ctx, int i)
+{
+    const struct reverse_index *idx = (const struct reverse_index *)ctx;
+    return idx->pool + idx->key_off[i];
+}
+
+static double reversed_weight(const void *ctx, int i)
+{
+    const struct reverse_index *idx = (const struct reverse_index *)ctx;
+    return idx->terms[idx->term_id[i]].weight;
+}
+
+static void reverse_copy(char *dst, const char *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = src[len - 1 - i];
+    }
+    dst[len] = '\0';
+}
+
+/*
+ * build_reverse_index():
+ *   - Stores every term reversed in one pool and sorts the entries.
+ *   - Builds a range_max over the sorted entries for top-k selection.
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *idx = NULL.
+ */
+void build_reverse_index(struct reverse_index **idx, struct term *terms, int nterms)
+{
+    build_reverse_index_arena(idx, terms, nterms, NULL);
+}
+
+/*
+ * build_reverse_index_arena():
+ *   - build_reverse_index() allocating the index from arena (malloc if
+ *     NULL); the sort permutation is temporary heap memory.
+ */
+void build_reverse_index_arena(struct reverse_index **idx, struct term *terms, int nterms,
+                               struct arena *arena)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    size_t pool_size = 0;
+    for (int i = 0; i < nterms; i++) {
+        pool_size += strlen(terms[i].term) + 1;
+    }
+
+    struct reverse_index *r = arena_calloc(arena, 1, sizeof(struct reverse_index));
+    int *order = malloc(sizeof(int) * nterms);
+    int *offsets = malloc(sizeof(int) * nterms);
+    if (r) {
+        r->arena = arena;
+        r->pool = arena_alloc(arena, pool_size);
+        r->key_off = arena_alloc(arena, sizeof(int) * nterms);
+        r->term_id = arena_alloc(arena, sizeof(int) * nterms);
+    }
+    if (!r || !order || !offsets || !r->pool || !r->key_off || !r->term_id) {
+        fprintf(stderr, "Error: Could not allocate memory for reverse index.\n");
+        free(order);
+        free(offsets);
+        free_reverse_index(r);
+        return;
+    }
+    r->n = nterms;
+    r->terms = terms;
+
+    size_t used = 0;
+    for (int i = 0; i < nterms; i++) {
+        size_t len = strlen(terms[i].term);
+        reverse_copy(r->pool + used, terms[i].term, len);
+        r->key_off[i] = (int)used;
+        order[i] = i;
+        used += len + 1;
+    }
+
+    sort_index = r;
+    qsort(order, nterms, sizeof(int), compare_reversed);
+    sort_index = NULL;
+
+    // Apply the permutation: entry e now holds the e-th smallest reversed key
+    for (int e = 0; e < nterms; e++) {
+        offsets[e] = r->key_off[order[e]];
+        r->term_id[e] = order[e];
+    }
+    memcpy(r->key_off, offsets, sizeof(int) * nterms);
+    free(order);
+    free(offsets);
+
+    if (build_range_max_arena(&r->rm, nterms, reversed_weight, r, arena) != 0) {
+        free_reverse_index(r);
+        return;
+    }
+    *idx = r;
+}
+
+/*
+ * suffix_range():
+ *   - Sets [*lo, *hi) to the index entries whose term ends with suffix.
+ *   - Returns the number of matches; an empty suffix matches nothing.
+ *
+ * Requirements: O(|suffix| log(nterms)) time.
+ */
+int suffix_range(const struct reverse_index *idx, const char *suffix, int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (!idx || !suffix || suffix[0] == '\0') {
+        return 0;
+    }
+
+    char reversed[sizeof(((struct term *)0)->term)];
+    size_t len = strlen(suffix);
+    if (len >= sizeof(reversed)) {
+        return 0;   // longer than any stored term
+    }
+    reverse_copy(reversed, suffix, len);
+    return sorted_prefix_range(idx->n, reversed_key, idx, reversed, lo, hi);
+}
+
+/*
+ * suffix_autocomplete():
+ *   - Returns the k heaviest terms ending with suffix, best first.
+ *     Pass k >= nterms to list every match.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void suffix_autocomplete(struct term **answer, int *n_answer,
+                         const struct reverse_index *idx, const char *suffix, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = suffix_range(idx, suffix, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    k = top_k_ranges(&idx->rm, &lo, &hi, 1, k, NULL, NULL, ids);
+    for (int i = 0; i < k; i++) {
+        ids[i] = idx->term_id[ids[i]];
+    }
+    terms_from_ids(answer, n_answer, idx->terms, ids, k);
+    free(ids);
+}
+
+void free_reverse_index(struct reverse_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    arena_free(idx->arena, idx->pool);
+    arena_free(idx->arena, idx->key_off);
+    arena_free(idx->arena, idx->term_id);
+    free_range_max(&idx->rm);
+    arena_free(idx->arena, idx);
+}
@@ -0,0 +1,32 @@
+#if !defined(REVERSE_H)
+#define REVERSE_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * Optional second index over the reversed term strings.
+ * "ends with ', Canada'" becomes "starts with 'adanaC ,'" on the reversed
+ * keys, so suffix queries use the same fused range search and range_max
+ * top-k as prefix queries. Entries refer to terms by position and must be
+ * rebuilt if the term array is reordered.
+ */
+typedef struct reverse_index{
+    int n;
+    char *pool;          // reversed terms, NUL-terminated
+    int *key_off;        // reversed key of entry i in pool, entries in sorted order
+    int *term_id;        // term each entry reverses
+    struct range_max rm; // best term weight over ranges of entries
+    struct term *terms;
+    struct arena *arena; // where the index lives, NULL for the heap
+} reverse_index;
+
+void build_reverse_index(struct reverse_index **idx, struct term *terms, int nterms);
+void build_reverse_index_arena(struct reverse_index **idx, struct term *terms, int nterms,
+                               struct arena *arena);
+int suffix_range(const struct reverse_index *idx, const char *suffix, int *lo, int *hi);
+void suffix_autocomplete(struct term **answer, int *n_answer,
+                         const struct reverse_index *idx, const char *suffix, int k);
+void free_reverse_index(struct reverse_index *idx);
+
+#endif
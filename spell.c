@@ -0,0 +1,566 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spell.h"
+#include "arena.h"
+
+/*
+ * Number of strings generated from an L-byte prefix with up to d deletes:
+ * sum of C(L, j) for j = 0..d.
+ */
+static int count_deletes(int L, int d)
+{
+    int total = 0, c = 1;
+    for (int j = 0; j <= d && j <= L; j++) {
+        total += c;
+        c = c * (L - j) / (j + 1);
+    }
+    return total;
+}
+
+static uint32_t hash_key(const char *s, int len, int level)
+{
+    uint32_t h = 2166136261u ^ (uint32_t)level;
+    for (int i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Slot holding the entry for (s, level), or the empty slot where it belongs.
+ */
+static int find_slot(const struct spell_index *idx, const char *s, int len, int level, uint32_t h)
+{
+    int mask = idx->nslots - 1;
+    int slot = (int)(h & (uint32_t)mask);
+    while (idx->slots[slot] != -1) {
+        const struct spell_entry *e = &idx->entries[idx->slots[slot]];
+        if (e->hash == h && e->len == len && e->level == level
+            && memcmp(idx->pool + e->key_off, s, len) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/*
+ * Build-time state: the index being filled plus growable arrays.
+ */
+typedef struct spell_builder{
+    struct spell_index *idx;
+    int entries_cap;
+    size_t pool_used, pool_cap;
+    int *pairs;           // (entry, group) pairs, flattened
+    int npairs, pairs_cap;
+    int *last_group;      // last group added to each entry
+    int last_group_cap;
+    int group;            // group being expanded
+    int level;
+} spell_builder;
+
+static int grow(void **p, int *cap, int need, size_t size)
+{
+    if (need <= *cap) {
+        return 0;
+    }
+    int cap2 = *cap ? *cap : 64;
+    while (cap2 < need) {
+        cap2 *= 2;
+    }
+    void *q = realloc(*p, size * (size_t)cap2);
+    if (!q) {
+        return -1;
+    }
+    *p = q;
+    *cap = cap2;
+    return 0;
+}
+
+static int rehash(struct spell_index *idx, int nslots)
+{
+    int *slots = malloc(sizeof(int) * nslots);
+    if (!slots) {
+        return -1;
+    }
+    for (int i = 0; i < nslots; i++) {
+        slots[i] = -1;
+    }
+    free(idx->slots);
+    idx->slots = slots;
+    idx->nslots = nslots;
+    for (int e = 0; e < idx->nentries; e++) {
+        const struct spell_entry *en = &idx->entries[e];
+        int slot = (int)(en->hash & (uint32_t)(nslots - 1));
+        while (slots[slot] != -1) {
+            slot = (slot + 1) & (nslots - 1);
+        }
+        slots[slot] = e;
+    }
+    return 0;
+}
+
+// Records that delete string s maps to the current group
+static int add_delete(spell_builder *b, const char *s, int len)
+{
+    struct spell_index *idx = b->idx;
+    uint32_t h = hash_key(s, len, b->level);
+    int slot = find_slot(idx, s, len, b->level, h);
+    int e = idx->slots[slot];
+
+    if (e == -1) {
+        if (grow((void **)&idx->entries, &b->entries_cap, idx->nentries + 1, sizeof(struct spell_entry)) != 0) {
+            return -1;
+        }
+        if (grow((void **)&b->last_group, &b->last_group_cap, idx->nentries + 1, sizeof(int)) != 0) {
+            return -1;
+        }
+        if (b->pool_used + len > b->pool_cap) {
+            size_t cap2 = b->pool_cap ? b->pool_cap * 2 : 4096;
+            char *pool = realloc(idx->pool, cap2);
+            if (!pool) {
+                return -1;
+            }
+            idx->pool = pool;
+            b->pool_cap = cap2;
+        }
+        memcpy(idx->pool + b->pool_used, s, len);
+
+        e = idx->nentries++;
+        idx->entries[e].hash = h;
+        idx->entries[e].key_off = (int)b->pool_used;
+        idx->entries[e].len = (unsigned char)len;
+        idx->entries[e].level = (unsigned char)b->level;
+        idx->entries[e].count = 0;
+        b->last_group[e] = -1;
+        b->pool_used += len;
+        idx->slots[slot] = e;
+
+        if (idx->nentries * 2 > idx->nslots && rehash(idx, idx->nslots * 2) != 0) {
+            return -1;
+        }
+    }
+
+    // The same delete can come from two deletion sets ("aab" -> "ab")
+    if (b->last_group[e] == b->group) {
+        return 0;
+    }
+    b->last_group[e] = b->group;
+    if (grow((void **)&b->pairs, &b->pairs_cap, 2 * (b->npairs + 1), sizeof(int)) != 0) {
+        return -1;
+    }
+    b->pairs[2 * b->npairs] = e;
+    b->pairs[2 * b->npairs + 1] = b->group;
+    b->npairs++;
+    idx->entries[e].count++;
+    return 0;
+}
+
+typedef int (*delete_fn)(void *ctx, const char *s, int len);
+
+/*
+ * Calls visit on s and on every string made by deleting up to depth bytes
+ * from it. Deleting positions in increasing order visits each deletion set once.
+ */
+static int visit_deletes(const char *s, int len, int from, int depth, delete_fn visit, void *ctx)
+{
+    if (visit(ctx, s, len) != 0) {
+        return -1;
+    }
+    if (depth == 0) {
+        return 0;
+    }
+    char shorter[SPELL_MAX_PREFIX];
+    for (int i = from; i < len; i++) {
+        memcpy(shorter, s, i);
+        memcpy(shorter + i, s + i + 1, len - i - 1);
+        if (visit_deletes(shorter, len - 1, i, depth - 1, visit, ctx) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int build_delete(void *ctx, const char *s, int len)
+{
+    return add_delete((spell_builder *)ctx, s, len);
+}
+
+/*
+ * Term ranges sharing an L-byte prefix; terms shorter than L are skipped.
+ * Writes up to cap ranges (if lo/hi are not NULL) and returns the count.
+ */
+static int collect_groups(const struct term *terms, int nterms, int L, int *lo, int *hi, int cap)
+{
+    int n = 0;
+    int i = 0;
+    while (i < nterms) {
+        if ((int)strlen(terms[i].term) < L) {
+            i++;
+            continue;
+        }
+        int j = i + 1;
+        while (j < nterms && strncmp(terms[j].term, terms[i].term, L) == 0) {
+            j++;
+        }
+        if (lo && n < cap) {
+            lo[n] = i;
+            hi[n] = j;
+        }
+        n++;
+        i = j;
+    }
+    return n;
+}
+
+static int compare_pair(const void *a, const void *b)
+{
+    const int *p1 = (const int *)a;
+    const int *p2 = (const int *)b;
+    if (p1[0] != p2[0]) return p1[0] < p2[0] ? -1 : 1;
+    return p1[1] - p2[1];
+}
+
+/*
+ * build_spell_index():
+ *   - Indexes prefixes of SPELL_MIN_PREFIX..SPELL_MAX_PREFIX bytes with up
+ *     to max_distance (1 or 2) deletes.
+ *   - Levels are added shortest first; a level whose worst-case size would
+ *     push the index past max_bytes (0 = no cap) is not built, and neither
+ *     are the longer ones. idx->max_level records the last level built.
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *idx = NULL.
+ */
+void build_spell_index(struct spell_index **idx, struct term *terms, int nterms,
+                       int max_distance, size_t max_bytes)
+{
+    build_spell_index_arena(idx, terms, nterms, max_distance, max_bytes, NULL);
+}
+
+/*
+ * Copies an index built on the heap into arena, every array at its exact
+ * size (pool_len bytes of delete strings, npairs group list entries).
+ * Returns NULL if the arena is out of memory.
+ */
+static struct spell_index *spell_to_arena(const struct spell_index *s, size_t pool_len, int npairs,
+                                          struct arena *arena)
+{
+    struct spell_index *m = arena_alloc(arena, sizeof(struct spell_index));
+    if (!m) {
+        return NULL;
+    }
+    *m = *s;
+    m->arena = arena;
+    m->group_lo = arena_alloc(arena, sizeof(int) * s->ngroups);
+    m->group_hi = arena_alloc(arena, sizeof(int) * s->ngroups);
+    m->group_len = arena_alloc(arena, s->ngroups);
+    m->entries = arena_alloc(arena, sizeof(struct spell_entry) * s->nentries);
+    m->slots = arena_alloc(arena, sizeof(int) * s->nslots);
+    m->groups = arena_alloc(arena, sizeof(int) * npairs);
+    m->pool = arena_alloc(arena, pool_len);
+    if (!m->group_lo || !m->group_hi || !m->group_len || !m->entries || !m->slots
+        || !m->groups || !m->pool) {
+        return NULL;
+    }
+    memcpy(m->group_lo, s->group_lo, sizeof(int) * s->ngroups);
+    memcpy(m->group_hi, s->group_hi, sizeof(int) * s->ngroups);
+    memcpy(m->group_len, s->group_len, s->ngroups);
+    memcpy(m->entries, s->entries, sizeof(struct spell_entry) * s->nentries);
+    memcpy(m->slots, s->slots, sizeof(int) * s->nslots);
+    memcpy(m->groups, s->groups, sizeof(int) * npairs);
+    memcpy(m->pool, s->pool, pool_len);
+    m->memory = sizeof(struct spell_index)
+              + (size_t)s->ngroups * (2 * sizeof(int) + 1)
+              + (size_t)s->nentries * sizeof(struct spell_entry)
+              + (size_t)s->nslots * sizeof(int)
+              + (size_t)npairs * sizeof(int)
+              + pool_len;
+    return m;
+}
+
+/*
+ * build_spell_index_arena():
+ *   - build_spell_index() with the index allocated from arena (malloc if
+ *     NULL). Its tables grow on the heap while the deletes are enumerated
+ *     and are copied into the arena at their final size.
+ */
+void build_spell_index_arena(struct spell_index **idx, struct term *terms, int nterms,
+                             int max_distance, size_t max_bytes, struct arena *arena)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+    if (max_distance < 1) max_distance = 1;
+    if (max_distance > SPELL_MAX_DISTANCE) max_distance = SPELL_MAX_DISTANCE;
+
+    struct spell_index *s = calloc(1, sizeof(struct spell_index));
+    if (!s || rehash(s, 1024) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for spelling index.\n");
+        free(s);
+        return;
+    }
+    s->max_distance = max_distance;
+    s->max_level = SPELL_MIN_PREFIX - 1;
+    s->terms = terms;
+    s->nterms = nterms;
+
+    spell_builder b;
+    memset(&b, 0, sizeof(b));
+    b.idx = s;
+
+    int lo_cap = 0, hi_cap = 0, len_cap = 0;
+    int failed = 0;
+    size_t estimate = 0;
+    for (int L = SPELL_MIN_PREFIX; L <= SPELL_MAX_PREFIX && !failed; L++) {
+        int n = collect_groups(terms, nterms, L, NULL, NULL, 0);
+        // Worst case: every delete is a new entry with its own slots and key
+        size_t per_delete = sizeof(struct spell_entry) + 2 * 2 * sizeof(int) + sizeof(int) + L;
+        size_t level_bytes = (size_t)n * (2 * sizeof(int) + 1
+                                          + count_deletes(L, max_distance) * per_delete);
+        if (max_bytes && estimate + level_bytes > max_bytes) {
+            break;
+        }
+        estimate += level_bytes;
+
+        int first = s->ngroups;
+        failed = grow((void **)&s->group_lo, &lo_cap, first + n, sizeof(int)) != 0
+              || grow((void **)&s->group_hi, &hi_cap, first + n, sizeof(int)) != 0
+              || grow((void **)&s->group_len, &len_cap, first + n, 1) != 0;
+        if (failed) {
+            break;
+        }
+        collect_groups(terms, nterms, L, s->group_lo + first, s->group_hi + first, n);
+
+        b.level = L;
+        for (int g = first; g < first + n && !failed; g++) {
+            s->group_len[g] = (unsigned char)L;
+            b.group = g;
+            failed = visit_deletes(terms[s->group_lo[g]].term, L, 0, max_distance, build_delete, &b) != 0;
+        }
+        s->ngroups = first + n;
+        s->max_level = L;
+    }
+
+    // Turn the (entry, group) pairs into one contiguous group list per entry
+    if (!failed) {
+        qsort(b.pairs, b.npairs, 2 * sizeof(int), compare_pair);
+        s->groups = malloc(sizeof(int) * (b.npairs > 0 ? b.npairs : 1));
+        failed = !s->groups;
+    }
+    if (!failed) {
+        int start = 0;
+        for (int e = 0; e < s->nentries; e++) {
+            s->entries[e].start = start;
+            start += s->entries[e].count;
+        }
+        for (int p = 0; p < b.npairs; p++) {
+            s->groups[p] = b.pairs[2 * p + 1];
+        }
+    }
+    free(b.pairs);
+    free(b.last_group);
+
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for spelling index.\n");
+        free_spell_index(s);
+        return;
+    }
+
+    s->memory = sizeof(struct spell_index)
+              + (size_t)s->ngroups * (2 * sizeof(int) + 1)
+              + (size_t)b.entries_cap * sizeof(struct spell_entry)
+              + (size_t)s->nslots * sizeof(int)
+              + (size_t)b.npairs * sizeof(int)
+              + b.pool_cap;
+    if (arena) {
+        struct spell_index *moved = spell_to_arena(s, b.pool_used, b.npairs, arena);
+        free_spell_index(s);
+        if (!moved) {
+            fprintf(stderr, "Error: Could not allocate memory for spelling index.\n");
+            return;
+        }
+        s = moved;
+    }
+    *idx = s;
+}
+
+/*
+ * spell_index_memory():
+ *   - Returns the bytes held by the index (0 for NULL).
+ */
+size_t spell_index_memory(const struct spell_index *idx)
+{
+    return idx ? idx->memory : 0;
+}
+
+/*
+ * Optimal string alignment distance (Levenshtein plus adjacent swaps)
+ * between two strings of at most SPELL_MAX_PREFIX bytes.
+ */
+static int edit_distance(const char *a, int na, const char *b, int nb)
+{
+    int d[SPELL_MAX_PREFIX + 1][SPELL_MAX_PREFIX + 1];
+    for (int i = 0; i <= na; i++) d[i][0] = i;
+    for (int j = 0; j <= nb; j++) d[0][j] = j;
+    for (int i = 1; i <= na; i++) {
+        for (int j = 1; j <= nb; j++) {
+            int best = d[i - 1][j - 1] + (a[i - 1] != b[j - 1]);
+            if (d[i - 1][j] + 1 < best) best = d[i - 1][j] + 1;
+            if (d[i][j - 1] + 1 < best) best = d[i][j - 1] + 1;
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]
+                && d[i - 2][j - 2] + 1 < best) {
+                best = d[i - 2][j - 2] + 1;
+            }
+            d[i][j] = best;
+        }
+    }
+    return d[na][nb];
+}
+
+typedef struct spell_query{
+    const struct spell_index *idx;
+    int level;
+    int *cands;
+    int ncands, cap;
+} spell_query;
+
+static int query_delete(void *ctx, const char *s, int len)
+{
+    spell_query *q = (spell_query *)ctx;
+    const struct spell_index *idx = q->idx;
+    int e = idx->slots[find_slot(idx, s, len, q->level, hash_key(s, len, q->level))];
+    if (e == -1) {
+        return 0;
+    }
+    const struct spell_entry *en = &idx->entries[e];
+    if (grow((void **)&q->cands, &q->cap, q->ncands + en->count, sizeof(int)) != 0) {
+        return -1;
+    }
+    memcpy(q->cands + q->ncands, idx->groups + en->start, sizeof(int) * en->count);
+    q->ncands += en->count;
+    return 0;
+}
+
+static int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static double term_weight(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+/*
+ * Writes the k heaviest terms of the ranges to out (best first) and
+ * returns the count; uses rm when available, scans otherwise.
+ */
+static int top_k_of_ranges(const struct spell_index *idx, const struct range_max *rm,
+                           const int *lo, const int *hi, int n, int k, int *out)
+{
+    if (rm) {
+        return top_k_ranges(rm, lo, hi, n, k, NULL, NULL, out);
+    }
+    return top_k_scan_ranges(lo, hi, n, k, term_weight, idx->terms, out);
+}
+
+/*
+ * spell_suggest():
+ *   - Meant for queries where prefix_range() finds nothing: returns up to
+ *     k terms whose prefix is within max_distance edits of the query's,
+ *     closest first and heaviest first within the same distance.
+ *   - Only the first idx->max_level bytes of the query are compared.
+ *   - rm is the optional range_max of the main array.
+ *
+ * Cost: at most count_deletes(L, max_distance) hash probes (29 for L = 7,
+ *       distance 2) plus one top-k per distance, independent of nterms.
+ *
+ * Edge cases:
+ *   - Queries shorter than SPELL_MIN_PREFIX get no suggestions.
+ */
+void spell_suggest(struct term **answer, int *n_answer, const struct spell_index *idx,
+                   const struct range_max *rm, const char *query, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!idx || !query || k <= 0) {
+        return;
+    }
+    int m = (int)strlen(query);
+    int L = m < idx->max_level ? m : idx->max_level;
+    if (L < SPELL_MIN_PREFIX) {
+        return;
+    }
+    if (k > idx->nterms) {
+        k = idx->nterms;
+    }
+
+    spell_query q = { idx, L, NULL, 0, 0 };
+    int *ids = malloc(sizeof(int) * k);
+    int *lo = NULL, *hi = NULL, *dist = NULL;
+    int failed = !ids || visit_deletes(query, L, 0, idx->max_distance, query_delete, &q) != 0;
+
+    // Distinct candidate groups, each with its distance to the query
+    int n = 0;
+    if (!failed && q.ncands > 0) {
+        qsort(q.cands, q.ncands, sizeof(int), compare_int);
+        for (int i = 0; i < q.ncands; i++) {
+            if (n == 0 || q.cands[i] != q.cands[n - 1]) {
+                q.cands[n++] = q.cands[i];
+            }
+        }
+    }
+    if (!failed) {
+        lo = malloc(sizeof(int) * (n + 1));
+        hi = malloc(sizeof(int) * (n + 1));
+        dist = malloc(sizeof(int) * (n + 1));
+        failed = !lo || !hi || !dist;
+    }
+    for (int c = 0; c < n && !failed; c++) {
+        int g = q.cands[c];
+        dist[c] = edit_distance(query, L, idx->terms[idx->group_lo[g]].term, L);
+    }
+
+    int count = 0;
+    for (int d = 0; d <= idx->max_distance && count < k && !failed; d++) {
+        int nr = 0;
+        for (int c = 0; c < n; c++) {
+            if (dist[c] == d) {
+                lo[nr] = idx->group_lo[q.cands[c]];
+                hi[nr] = idx->group_hi[q.cands[c]];
+                nr++;
+            }
+        }
+        count += top_k_of_ranges(idx, rm, lo, hi, nr, k - count, ids + count);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for suggestions.\n");
+    } else {
+        terms_from_ids(answer, n_answer, idx->terms, ids, count);
+    }
+    free(q.cands);
+    free(ids);
+    free(lo);
+    free(hi);
+    free(dist);
+}
+
+void free_spell_index(struct spell_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    arena_free(idx->arena, idx->group_lo);
+    arena_free(idx->arena, idx->group_hi);
+    arena_free(idx->arena, idx->group_len);
+    arena_free(idx->arena, idx->entries);
+    arena_free(idx->arena, idx->slots);
+    arena_free(idx->arena, idx->groups);
+    arena_free(idx->arena, idx->pool);
+    arena_free(idx->arena, idx);
+}
@@ -0,0 +1,59 @@
+#if !defined(SPELL_H)
+#define SPELL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+// Shortest and longest term prefixes that are indexed (SymSpell's "prefix length").
+#define SPELL_MIN_PREFIX 3
+#define SPELL_MAX_PREFIX 7
+// Largest supported edit distance.
+#define SPELL_MAX_DISTANCE 2
+
+/*
+ * Symmetric-delete ("SymSpell") index for "did you mean" suggestions.
+ * For every prefix length L, each distinct L-byte term prefix is a group
+ * covering a contiguous range of the sorted terms. Every string obtained by
+ * deleting up to max_distance bytes from a group's prefix maps to that
+ * group, so a misspelt query finds its candidates by generating its own
+ * deletes and looking them up: a bounded number of hash probes whatever
+ * the dictionary size.
+ */
+typedef struct spell_entry{
+    uint32_t hash;
+    int key_off;          // delete string in pool
+    unsigned char len;    // length of the delete string
+    unsigned char level;  // prefix length L it was generated from
+    int start, count;     // its groups: groups[start .. start + count)
+} spell_entry;
+
+typedef struct spell_index{
+    int max_distance;
+    int max_level;            // longest prefix actually indexed (the cap may lower it)
+    int ngroups;
+    int *group_lo, *group_hi; // term range of every group
+    unsigned char *group_len; // prefix length L of every group
+    int nentries;
+    struct spell_entry *entries;
+    int *slots;               // open-addressing table of entry numbers, -1 if empty
+    int nslots;
+    int *groups;              // concatenated group lists of all entries
+    char *pool;               // delete strings
+    size_t memory;            // bytes held by this index
+    struct term *terms;
+    int nterms;
+    struct arena *arena;      // where the index lives, NULL for the heap
+} spell_index;
+
+void build_spell_index(struct spell_index **idx, struct term *terms, int nterms,
+                       int max_distance, size_t max_bytes);
+void build_spell_index_arena(struct spell_index **idx, struct term *terms, int nterms,
+                             int max_distance, size_t max_bytes, struct arena *arena);
+size_t spell_index_memory(const struct spell_index *idx);
+void spell_suggest(struct term **answer, int *n_answer, const struct spell_index *idx,
+                   const struct range_max *rm, const char *query, int k);
+void free_spell_index(struct spell_index *idx);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "static_dict.h"
+
+static const char *static_key(const void *ctx, int i)
+{
+    const struct static_dictionary *sd = (const struct static_dictionary *)ctx;
+    return sd->pool + sd->offsets[i];
+}
+
+// prefix_range() over the string pool.
+static int static_prefix_range(const struct static_dictionary *sd, const char *substr,
+                               int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (sd->nterms <= 0 || !substr || substr[0] == '\0') {
+        return 0;
+    }
+    return sorted_prefix_range(sd->nterms, static_key, sd, substr, lo, hi);
+}
+
+/*
+ * static_autocomplete():
+ *   - autocomplete_top_k() over a compiled-in dictionary: the k heaviest
+ *     terms starting with substr, best first.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void static_autocomplete(struct term **answer, int *n_answer, const struct static_dictionary *sd,
+                         const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    int count = static_prefix_range(sd, substr, &lo, &hi);
+    if (count == 0 || k <= 0) {
+        return;
+    }
+    if (k > count) {
+        k = count;
+    }
+
+    int *ids = malloc(sizeof(int) * k);
+    struct term *out = malloc(sizeof(struct term) * k);
+    if (!ids || !out) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(ids);
+        free(out);
+        return;
+    }
+    k = top_k_ranges(&sd->rm, &lo, &hi, 1, k, NULL, NULL, ids);
+    for (int i = 0; i < k; i++) {
+        strcpy(out[i].term, static_key(sd, ids[i]));
+        out[i].weight = sd->weights[ids[i]];
+    }
+    free(ids);
+    *answer = out;
+    *n_answer = k;
+}
+
+/*
+ * static_prefix_stats():
+ *   - prefix_stats() over a compiled-in dictionary.
+ */
+void static_prefix_stats(struct match_stats *stats, const struct static_dictionary *sd,
+                         const char *substr)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->best = -1;
+
+    int lo, hi;
+    stats->count = static_prefix_range(sd, substr, &lo, &hi);
+    if (stats->count == 0) {
+        return;
+    }
+    stats->weight_sum = sd->sums[hi] - sd->sums[lo];
+    stats->best = range_max_query(&sd->rm, lo, hi);
+    stats->max_weight = sd->weights[stats->best];
+}
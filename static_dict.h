@@ -0,0 +1,38 @@
+#if !defined(STATIC_DICT_H)
+#define STATIC_DICT_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * A dictionary compiled into the executable by gen_static: the sorted
+ * terms, the range_max tree and the weight sums are const arrays in a
+ * generated C file, so a program linked with it starts without parsing or
+ * sorting anything, and every process running it shares the same
+ * read-only pages.
+ *
+ * The terms are packed back to back in one string pool instead of
+ * struct term's fixed 200 bytes, with their weights in a column of their
+ * own; answers are still returned as struct term.
+ *
+ *   ./gen_static cities.txt cities_data.c cities
+ *   extern const struct static_dictionary cities;   // in the program
+ *
+ * The data is read-only: range_max_update() and other writers must not be
+ * used on it.
+ */
+typedef struct static_dictionary{
+    const char *pool;           // sorted terms, as read_in_terms() leaves them, each NUL-ended
+    const int *offsets;         // term i starts at pool + offsets[i]
+    const double *weights;      // weight of term i
+    int nterms;
+    struct range_max rm;        // over weights; its tree is const data too
+    const double *sums;         // running weight totals, see build_weight_sums()
+} static_dictionary;
+
+void static_autocomplete(struct term **answer, int *n_answer, const struct static_dictionary *sd,
+                         const char *substr, int k);
+void static_prefix_stats(struct match_stats *stats, const struct static_dictionary *sd,
+                         const char *substr);
+
+#endif
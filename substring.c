@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "substring.h"
+#include "arena.h"
+
+typedef struct suffix{
+    int term_id;
+    unsigned char offset;
+} suffix;
+
+// Term array being sorted by build_substring_index() (qsort has no context argument)
+static const struct term *sort_terms;
+
+static int compare_suffix(const void *a, const void *b)
+{
+    const suffix *s1 = (const suffix *)a;
+    const suffix *s2 = (const suffix *)b;
+    int cmp = strcmp(sort_terms[s1->term_id].term + s1->offset,
+                     sort_terms[s2->term_id].term + s2->offset);
+    if (cmp != 0) return cmp;
+    // Equal suffixes: keep term order so ranges stay deterministic
+    return s1->term_id - s2->term_id;
+}
+
+static double suffix_weight(const void *ctx, int i)
+{
+    const struct substring_index *idx = (const struct substring_index *)ctx;
+    return idx->terms[idx->term_id[i]].weight;
+}
+
+static int suffix_term(const void *ctx, int i)
+{
+    return ((const struct substring_index *)ctx)->term_id[i];
+}
+
+/*
+ * build_substring_index():
+ *   - Enumerates every suffix of every term and sorts them lexicographically.
+ *   - Builds a range_max over suffix ranks so top-k never scans a whole range.
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *idx = NULL.
+ */
+void build_substring_index(struct substring_index **idx, struct term *terms, int nterms)
+{
+    build_substring_index_arena(idx, terms, nterms, NULL);
+}
+
+/*
+ * build_substring_index_arena():
+ *   - build_substring_index() allocating the index from arena (malloc if
+ *     NULL); the sort buffer is temporary and comes from the heap.
+ */
+void build_substring_index_arena(struct substring_index **idx, struct term *terms, int nterms,
+                                 struct arena *arena)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    long long total = 0;
+    for (int i = 0; i < nterms; i++) {
+        total += (long long)strlen(terms[i].term);
+    }
+    if (total > 0x7fffffff) {
+        fprintf(stderr, "Error: Too many characters for a substring index.\n");
+        return;
+    }
+
+    struct substring_index *s = arena_calloc(arena, 1, sizeof(struct substring_index));
+    suffix *sorted = malloc(sizeof(suffix) * (total > 0 ? total : 1));
+    if (!s || !sorted) {
+        fprintf(stderr, "Error: Could not allocate memory for substring index.\n");
+        arena_free(arena, s);
+        free(sorted);
+        return;
+    }
+    s->arena = arena;
+
+    int n = 0;
+    for (int i = 0; i < nterms; i++) {
+        int len = (int)strlen(terms[i].term);
+        for (int off = 0; off < len; off++) {
+            sorted[n].term_id = i;
+            sorted[n].offset = (unsigned char)off;
+            n++;
+        }
+    }
+    sort_terms = terms;
+    qsort(sorted, n, sizeof(suffix), compare_suffix);
+    sort_terms = NULL;
+
+    s->nsuffixes = n;
+    s->terms = terms;
+    s->nterms = nterms;
+    s->term_id = arena_alloc(arena, sizeof(int) * (n > 0 ? n : 1));
+    s->offset = arena_alloc(arena, n > 0 ? n : 1);
+    if (!s->term_id || !s->offset) {
+        fprintf(stderr, "Error: Could not allocate memory for substring index.\n");
+        free(sorted);
+        free_substring_index(s);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        s->term_id[i] = sorted[i].term_id;
+        s->offset[i] = sorted[i].offset;
+    }
+    free(sorted);
+
+    if (build_range_max_arena(&s->rm, n, suffix_weight, s, arena) != 0) {
+        free_substring_index(s);
+        return;
+    }
+    *idx = s;
+}
+
+static const char *suffix_at(const struct substring_index *idx, int i)
+{
+    return idx->terms[idx->term_id[i]].term + idx->offset[i];
+}
+
+/*
+ * Compares the first m bytes of the suffix with fragment, starting at byte
+ * 'skip' which is already known to match. Stores the new match length in
+ * *lcp and returns <0, 0 or >0 like strncmp.
+ */
+static int compare_from(const char *suf, const char *fragment, int m, int skip, int *lcp)
+{
+    int i = skip;
+    while (i < m && suf[i] == fragment[i]) {
+        i++;
+    }
+    *lcp = i;
+    if (i == m) return 0;
+    return (unsigned char)suf[i] - (unsigned char)fragment[i];
+}
+
+/*
+ * First suffix rank whose leading m bytes compare >= fragment (upper == 0)
+ * or > fragment (upper == 1).
+ *
+ * Bytes already known to match both ends of the search window are skipped
+ * (the Manber-Myers lcp trick), so probes rarely re-read the fragment.
+ */
+static int suffix_bound(const struct substring_index *idx, const char *fragment, int m, int upper)
+{
+    int left = 0;
+    int right = idx->nsuffixes;   // answer lies in [left, right]
+    int llcp = 0, rlcp = 0;       // matched bytes at the left / right boundary
+
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        int skip = llcp < rlcp ? llcp : rlcp;
+        int lcp;
+        int cmp = compare_from(suffix_at(idx, mid), fragment, m, skip, &lcp);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            left = mid + 1;
+            llcp = lcp;
+        } else {
+            right = mid;
+            rlcp = lcp;
+        }
+    }
+    return left;
+}
+
+/*
+ * substring_range():
+ *   - Sets [*lo, *hi) to the suffix ranks that start with fragment.
+ *   - Returns the number of matching suffixes (a term can match several times).
+ *
+ * Requirements: O(|fragment| log(nsuffixes)) time, usually much less.
+ */
+int substring_range(const struct substring_index *idx, const char *fragment, int *lo, int *hi)
+{
+    *lo = *hi = 0;
+    if (!idx || !fragment || fragment[0] == '\0') {
+        return 0;
+    }
+
+    int m = (int)strlen(fragment);
+    *lo = suffix_bound(idx, fragment, m, 0);
+    *hi = suffix_bound(idx, fragment, m, 1);
+    return *hi - *lo;
+}
+
+/*
+ * substring_autocomplete():
+ *   - Returns the k heaviest terms containing fragment anywhere, best first.
+ *   - Every term is reported once even if fragment occurs in it repeatedly.
+ *
+ * Edge cases:
+ *   - If no term contains fragment, or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void substring_autocomplete(struct term **answer, int *n_answer,
+                            const struct substring_index *idx, const char *fragment, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+
+    int lo, hi;
+    if (k <= 0 || substring_range(idx, fragment, &lo, &hi) == 0) {
+        return;
+    }
+
+    if (k > idx->nterms) {
+        k = idx->nterms;
+    }
+    int *ids = malloc(sizeof(int) * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+
+    int count = top_k_ranges(&idx->rm, &lo, &hi, 1, k, suffix_term, idx, ids);
+    for (int i = 0; i < count; i++) {
+        ids[i] = idx->term_id[ids[i]];
+    }
+    terms_from_ids(answer, n_answer, idx->terms, ids, count);
+    free(ids);
+}
+
+void free_substring_index(struct substring_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    arena_free(idx->arena, idx->term_id);
+    arena_free(idx->arena, idx->offset);
+    free_range_max(&idx->rm);
+    arena_free(idx->arena, idx);
+}
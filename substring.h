@@ -0,0 +1,33 @@
+#if !defined(SUBSTRING_H)
+#define SUBSTRING_H
+
+#include "autocomplete.h"
+#include "topk.h"
+
+/*
+ * Suffix array over every term of a sorted term array.
+ * A suffix is stored as (term id, start offset) instead of a text position,
+ * so no concatenated copy of the strings is kept: 5 bytes per indexed
+ * character plus a small range_max over suffix ranks.
+ * The index refers to terms by position and must be rebuilt if the term
+ * array is reordered.
+ */
+typedef struct substring_index{
+    int nsuffixes;
+    int *term_id;          // term each suffix belongs to, in suffix order
+    unsigned char *offset; // start of each suffix inside its term
+    struct range_max rm;   // best term weight over ranges of suffixes
+    struct term *terms;
+    int nterms;
+    struct arena *arena;   // where the index lives, NULL for the heap
+} substring_index;
+
+void build_substring_index(struct substring_index **idx, struct term *terms, int nterms);
+void build_substring_index_arena(struct substring_index **idx, struct term *terms, int nterms,
+                                 struct arena *arena);
+int substring_range(const struct substring_index *idx, const char *fragment, int *lo, int *hi);
+void substring_autocomplete(struct term **answer, int *n_answer,
+                            const struct substring_index *idx, const char *fragment, int k);
+void free_substring_index(struct substring_index *idx);
+
+#endif
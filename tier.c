@@ -0,0 +1,351 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tier.h"
+#include "arena.h"
+
+#define COLD_MAGIC "ACCOLD2"
+
+typedef struct cold_header{
+    char magic[8];
+    int n;
+    int nblocks, size;  // of the range_max tree
+    int reserved;
+    double max_weight;
+} cold_header;
+
+static double term_weight(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+static const char *cold_key(const void *ctx, int i)
+{
+    const struct tiered_index *ti = (const struct tiered_index *)ctx;
+    return ti->cold_text + ti->cold_off[i];
+}
+
+static double cold_weight(const void *ctx, int i)
+{
+    return ((const struct tiered_index *)ctx)->cold_weight[i];
+}
+
+static double array_value(const void *ctx, int i)
+{
+    return ((const double *)ctx)[i];
+}
+
+/*
+ * Writes the terms not marked hot, in their sorted order, as a cold tier
+ * file with their range_max tree. Returns 0, or -1 after printing an error.
+ */
+static int write_cold_tier(const char *path, struct term *terms, int nterms, const char *hot)
+{
+    struct cold_header h;
+    memset(&h, 0, sizeof(h));
+    strcpy(h.magic, COLD_MAGIC);
+    double *weight = malloc(sizeof(double) * nterms);
+    if (!weight) {
+        fprintf(stderr, "Error: Could not allocate memory for tiered index.\n");
+        return -1;
+    }
+    for (int i = 0; i < nterms; i++) {
+        if (!hot[i]) {
+            if (h.n == 0 || terms[i].weight > h.max_weight) {
+                h.max_weight = terms[i].weight;
+            }
+            weight[h.n++] = terms[i].weight;
+        }
+    }
+    struct range_max rm;
+    if (build_range_max(&rm, h.n, array_value, weight) != 0) {
+        free(weight);
+        return -1;
+    }
+    h.nblocks = rm.nblocks;
+    h.size = rm.size;
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not create cold tier file %s.\n", path);
+        free_range_max(&rm);
+        free(weight);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1
+          && fwrite(weight, sizeof(double), h.n, fp) == (size_t)h.n
+          && fwrite(rm.tree, sizeof(int), 2 * (size_t)h.size, fp) == 2 * (size_t)h.size;
+    free_range_max(&rm);
+    free(weight);
+    int off = 0;
+    for (int i = 0; i < nterms && ok; i++) {
+        if (!hot[i]) {
+            ok = fwrite(&off, sizeof(int), 1, fp) == 1;
+            off += (int)strlen(terms[i].term) + 1;
+        }
+    }
+    ok = ok && fwrite(&off, sizeof(int), 1, fp) == 1;
+    for (int i = 0; i < nterms && ok; i++) {
+        if (!hot[i]) {
+            ok = fwrite(terms[i].term, strlen(terms[i].term) + 1, 1, fp) == 1;
+        }
+    }
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write cold tier file %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Maps a cold tier file read-only and points ti's cold fields into it.
+ * Returns 0, or -1 after printing an error.
+ */
+static int map_cold_tier(struct tiered_index *ti, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: Could not open cold tier file %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t len = (size_t)st.st_size;
+    void *map = len >= sizeof(struct cold_header)
+              ? mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    const struct cold_header *h = (const struct cold_header *)map;
+    size_t tables = 0;
+    int blocks = 0;
+    if (map != MAP_FAILED && h->n >= 0) {
+        blocks = (h->n + RANGE_MAX_BLOCK - 1) / RANGE_MAX_BLOCK;
+        tables = sizeof(*h) + (size_t)h->n * sizeof(double) + 2 * (size_t)h->size * sizeof(int)
+               + ((size_t)h->n + 1) * sizeof(int);
+    }
+    if (map == MAP_FAILED || memcmp(h->magic, COLD_MAGIC, sizeof(COLD_MAGIC)) != 0
+        || h->n < 0 || h->nblocks != blocks || h->size < blocks || h->size < 1
+        || (h->size & (h->size - 1)) != 0 || tables > len) {
+        fprintf(stderr, "Error: %s is not a cold tier file.\n", path);
+        if (map != MAP_FAILED) {
+            munmap(map, len);
+        }
+        return -1;
+    }
+    ti->map = map;
+    ti->map_len = len;
+    ti->ncold = h->n;
+    ti->cold_max = h->max_weight;
+    ti->cold_weight = (const double *)((const char *)map + sizeof(*h));
+    const int *tree = (const int *)(ti->cold_weight + h->n);
+    ti->cold_off = tree + 2 * h->size;
+    ti->cold_text = (const char *)(ti->cold_off + h->n + 1);
+    int bad = (size_t)ti->cold_off[h->n] > len - tables;
+    for (int i = 0; i < 2 * h->size && !bad; i++) {
+        bad = tree[i] < -1 || tree[i] >= h->n;
+    }
+    if (bad) {
+        fprintf(stderr, "Error: %s is not a cold tier file.\n", path);
+        return -1;
+    }
+    // The tree is only read: the mapping stands in for range_max's own array
+    ti->cold_rm.n = h->n;
+    ti->cold_rm.nblocks = h->nblocks;
+    ti->cold_rm.size = h->size;
+    ti->cold_rm.tree = (int *)tree;
+    ti->cold_rm.value = cold_weight;
+    ti->cold_rm.ctx = ti;
+    ti->cold_rm.arena = NULL;
+    // Binary searches touch scattered pages: read-ahead would only waste I/O
+    posix_madvise(map, len, POSIX_MADV_RANDOM);
+    return 0;
+}
+
+/*
+ * build_tiered_index():
+ *   - Keeps the nhot heaviest terms (TIER_HOT_FRACTION of them if
+ *     nhot <= 0) in memory, writes all others to cold_path and maps it.
+ *     The caller may free terms afterwards; the file stays on disk.
+ *
+ * Edge cases addressed:
+ *   - nhot >= nterms leaves an empty cold tier.
+ *   - On failure prints an error and sets *ti = NULL.
+ */
+void build_tiered_index(struct tiered_index **ti, struct term *terms, int nterms, int nhot,
+                        const char *cold_path)
+{
+    build_tiered_index_arena(ti, terms, nterms, nhot, cold_path, NULL);
+}
+
+/*
+ * build_tiered_index_arena():
+ *   - build_tiered_index() with the hot tier allocated from arena (malloc
+ *     if NULL); the cold tier is a mapping either way.
+ */
+void build_tiered_index_arena(struct tiered_index **ti, struct term *terms, int nterms, int nhot,
+                              const char *cold_path, struct arena *arena)
+{
+    *ti = NULL;
+    if (!terms || nterms <= 0 || !cold_path) {
+        return;
+    }
+    if (nhot <= 0) {
+        nhot = (int)(nterms * TIER_HOT_FRACTION);
+        if (nhot < 1) {
+            nhot = 1;
+        }
+    }
+    if (nhot > nterms) {
+        nhot = nterms;
+    }
+
+    struct tiered_index *t = arena_calloc(arena, 1, sizeof(struct tiered_index));
+    int *ids = malloc(sizeof(int) * nhot);
+    char *hot = calloc(nterms, 1);
+    if (t) {
+        t->arena = arena;
+        t->hot = arena_alloc(arena, sizeof(struct term) * nhot);
+    }
+    if (!t || !ids || !hot || !t->hot) {
+        fprintf(stderr, "Error: Could not allocate memory for tiered index.\n");
+        free(ids);
+        free(hot);
+        free_tiered_index(t);
+        return;
+    }
+
+    // Ties at the cut go to the lower position, as in every top-k
+    int count = top_k_scan(0, nterms, nhot, term_weight, terms, ids);
+    for (int i = 0; i < count; i++) {
+        hot[ids[i]] = 1;
+    }
+    free(ids);
+    for (int i = 0; i < nterms; i++) {
+        if (hot[i]) {
+            t->hot[t->nhot++] = terms[i];
+        }
+    }
+
+    int failed = build_range_max_arena(&t->hot_rm, t->nhot, term_weight, t->hot, arena) != 0;
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for tiered index.\n");
+    } else {
+        failed = write_cold_tier(cold_path, terms, nterms, hot) != 0
+              || map_cold_tier(t, cold_path) != 0;
+    }
+    free(hot);
+    if (failed) {
+        free_tiered_index(t);
+        return;
+    }
+    *ti = t;
+}
+
+/*
+ * Merges the hot and cold candidates (each best first) into answer,
+ * heaviest first; equal weights keep the sorted order of the terms.
+ */
+static int merge_tiers(struct term *answer, int k, const struct tiered_index *ti,
+                       const int *hot, int nhot, const int *cold, int ncold)
+{
+    int n = 0, a = 0, b = 0;
+    while (n < k && (a < nhot || b < ncold)) {
+        int take_hot;
+        if (b == ncold) {
+            take_hot = 1;
+        } else if (a == nhot) {
+            take_hot = 0;
+        } else {
+            double wh = ti->hot[hot[a]].weight;
+            double wc = ti->cold_weight[cold[b]];
+            take_hot = wh != wc ? wh > wc
+                     : strcmp(ti->hot[hot[a]].term, cold_key(ti, cold[b])) < 0;
+        }
+        if (take_hot) {
+            answer[n++] = ti->hot[hot[a++]];
+        } else {
+            strncpy(answer[n].term, cold_key(ti, cold[b]), sizeof(answer[n].term) - 1);
+            answer[n].term[sizeof(answer[n].term) - 1] = '\0';
+            answer[n++].weight = ti->cold_weight[cold[b++]];
+        }
+    }
+    return n;
+}
+
+/*
+ * tiered_autocomplete():
+ *   - Returns the k heaviest terms starting with substr, best first; the
+ *     same answer as autocomplete_top_k() over the full dictionary.
+ *   - The cold tier is searched only when fewer than k hot terms match
+ *     or the k-th of them is not heavier than cold_max.
+ *
+ * Edge cases:
+ *   - If no match or k <= 0, sets *answer = NULL, *n_answer = 0.
+ */
+void tiered_autocomplete(struct term **answer, int *n_answer, struct tiered_index *ti,
+                         const char *substr, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!ti || !substr || substr[0] == '\0' || k <= 0) {
+        return;
+    }
+    ti->queries++;
+
+    int *ids = malloc(sizeof(int) * 2 * k);
+    if (!ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    int *hot = ids, *cold = ids + k;
+    int nhot = 0, ncold = 0;
+    int lo, hi;
+    if (prefix_range(ti->hot, ti->nhot, substr, &lo, &hi) > 0) {
+        nhot = top_k_ranges(&ti->hot_rm, &lo, &hi, 1, k, NULL, NULL, hot);
+    }
+    int hot_enough = nhot == k && ti->hot[hot[k - 1]].weight > ti->cold_max;
+    if (!hot_enough && ti->ncold > 0) {
+        ti->cold_queries++;
+        if (sorted_prefix_range(ti->ncold, cold_key, ti, substr, &lo, &hi) > 0) {
+            ncold = top_k_ranges(&ti->cold_rm, &lo, &hi, 1, k, NULL, NULL, cold);
+        }
+    }
+
+    if (nhot + ncold > 0) {
+        int n = nhot + ncold < k ? nhot + ncold : k;
+        *answer = malloc(sizeof(struct term) * n);
+        if (!(*answer)) {
+            fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        } else {
+            *n_answer = merge_tiers(*answer, n, ti, hot, nhot, cold, ncold);
+        }
+    }
+    free(ids);
+}
+
+/*
+ * free_tiered_index():
+ *   - Frees the hot tier and unmaps the cold tier; the file is kept.
+ */
+void free_tiered_index(struct tiered_index *ti)
+{
+    if (!ti) {
+        return;
+    }
+    if (ti->map) {
+        munmap(ti->map, ti->map_len);
+    }
+    free_range_max(&ti->hot_rm);
+    arena_free(ti->arena, ti->hot);
+    arena_free(ti->arena, ti);
+}
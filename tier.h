@@ -0,0 +1,51 @@
+#if !defined(TIER_H)
+#define TIER_H
+
+#include <stddef.h>
+#include "autocomplete.h"
+#include "topk.h"
+
+// Share of the terms (by weight) kept in the hot tier when none is given.
+#define TIER_HOT_FRACTION 0.01
+
+/*
+ * Two-tier dictionary: the heaviest terms (the hot tier) stay in memory as
+ * a small sorted term array with its range_max, and every other term goes
+ * to a cold tier file that is mmap'd and only read when the hot tier
+ * cannot answer alone. No cold term outweighs a hot one, so a query that
+ * finds k hot matches heavier than cold_max never touches the file. The
+ * cold tier's range_max tree is stored in the file too, so a cold query
+ * reads O(k) blocks of its matches rather than all of them.
+ *
+ * Cold tier file, native byte order:
+ *   header    "ACCOLD2\0", int n, int nblocks, int size, int 0, double max_weight
+ *   double    weight[n]
+ *   int       tree[2 * size]  // range_max tree over weight (see topk.h)
+ *   int       off[n + 1]      // term i is text + off[i], NUL-terminated
+ *   char      text[off[n]]
+ */
+typedef struct tiered_index{
+    int nhot;
+    struct term *hot;           // hot terms in sorted order
+    struct range_max hot_rm;
+    int ncold;
+    double cold_max;            // heaviest cold term, 0 if there is none
+    const double *cold_weight;  // these three point into the mapping
+    const int *cold_off;
+    const char *cold_text;
+    struct range_max cold_rm;   // its tree is in the mapping too, never freed
+    void *map;
+    size_t map_len;
+    long queries, cold_queries; // queries answered, and how many read the cold tier
+    struct arena *arena;        // where the hot tier lives, NULL for the heap
+} tiered_index;
+
+void build_tiered_index(struct tiered_index **ti, struct term *terms, int nterms, int nhot,
+                        const char *cold_path);
+void build_tiered_index_arena(struct tiered_index **ti, struct term *terms, int nterms, int nhot,
+                              const char *cold_path, struct arena *arena);
+void tiered_autocomplete(struct term **answer, int *n_answer, struct tiered_index *ti,
+                         const char *substr, int k);
+void free_tiered_index(struct tiered_index *ti);
+
+#endif
@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "tokens.h"
+#include "arena.h"
+#include "topk.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// A posting list this many times longer than the candidates is verified
+// against the term text instead of being merged and intersected.
+#define VERIFY_RATIO 16
+
+static int is_separator(char c)
+{
+    return c == ',' || isspace((unsigned char)c);
+}
+
+/*
+ * Copies the next token of *s (case folded, at most cap-1 bytes) into buf
+ * and advances *s past it. Returns the token length, 0 when none is left.
+ */
+static int next_token(const char **s, char *buf, int cap)
+{
+    const char *p = *s;
+    while (*p && is_separator(*p)) {
+        p++;
+    }
+    int len = 0;
+    while (*p && !is_separator(*p)) {
+        if (len < cap - 1) {
+            buf[len++] = (char)tolower((unsigned char)*p);
+        }
+        p++;
+    }
+    buf[len] = '\0';
+    *s = p;
+    return len;
+}
+
+// Term array being ranked by build_token_index() (qsort has no context argument)
+static const struct term *sort_terms;
+static const char *sort_pool;
+
+static int compare_rank(const void *a, const void *b)
+{
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    if (sort_terms[j].weight > sort_terms[i].weight) return 1;
+    if (sort_terms[j].weight < sort_terms[i].weight) return -1;
+    return i - j;
+}
+
+typedef struct token_pair{
+    int off;        // token text in sort_pool
+    uint32_t rank;
+} token_pair;
+
+static int compare_pair(const void *a, const void *b)
+{
+    const token_pair *p1 = (const token_pair *)a;
+    const token_pair *p2 = (const token_pair *)b;
+    int cmp = strcmp(sort_pool + p1->off, sort_pool + p2->off);
+    if (cmp != 0) return cmp;
+    return p1->rank < p2->rank ? -1 : p1->rank > p2->rank;
+}
+
+/*
+ * build_token_index():
+ *   - Ranks the terms by descending weight.
+ *   - Splits every term into tokens and sorts (token, rank) pairs, which
+ *     yields the token dictionary and its sorted posting lists in one pass.
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *idx = NULL.
+ */
+void build_token_index(struct token_index **idx, struct term *terms, int nterms)
+{
+    build_token_index_arena(idx, terms, nterms, NULL);
+}
+
+/*
+ * build_token_index_arena():
+ *   - build_token_index() allocating the index from arena (malloc if
+ *     NULL); the token pairs being sorted are temporary heap memory.
+ */
+void build_token_index_arena(struct token_index **idx, struct term *terms, int nterms,
+                             struct arena *arena)
+{
+    *idx = NULL;
+    if (!terms || nterms <= 0) {
+        return;
+    }
+
+    struct token_index *t = arena_calloc(arena, 1, sizeof(struct token_index));
+    size_t pool_size = 0;
+    for (int i = 0; i < nterms; i++) {
+        pool_size += strlen(terms[i].term) + 1;
+    }
+    char *tmp_pool = malloc(pool_size + 1);
+    // Every token takes at least 2 bytes of a term ("a,"), hence pool_size/2 pairs
+    token_pair *pairs = malloc(sizeof(token_pair) * (pool_size / 2 + 1));
+    if (t) {
+        t->arena = arena;
+        t->rank_term = arena_alloc(arena, sizeof(int) * nterms);
+    }
+    if (!t || !tmp_pool || !pairs || !t->rank_term) {
+        fprintf(stderr, "Error: Could not allocate memory for token index.\n");
+        free(tmp_pool);
+        free(pairs);
+        free_token_index(t);
+        return;
+    }
+    t->terms = terms;
+    t->nterms = nterms;
+
+    for (int i = 0; i < nterms; i++) {
+        t->rank_term[i] = i;
+    }
+    sort_terms = terms;
+    qsort(t->rank_term, nterms, sizeof(int), compare_rank);
+    sort_terms = NULL;
+
+    int npairs = 0;
+    int used = 0;
+    for (int r = 0; r < nterms; r++) {
+        const char *s = terms[t->rank_term[r]].term;
+        char buf[sizeof(terms[0].term)];
+        int len;
+        while ((len = next_token(&s, buf, sizeof(buf))) > 0) {
+            memcpy(tmp_pool + used, buf, len + 1);
+            pairs[npairs].off = used;
+            pairs[npairs].rank = (uint32_t)r;
+            npairs++;
+            used += len + 1;
+        }
+    }
+    sort_pool = tmp_pool;
+    qsort(pairs, npairs, sizeof(token_pair), compare_pair);
+    sort_pool = NULL;
+
+    // Count distinct tokens and the pool they need
+    int ntokens = 0;
+    size_t final_size = 0;
+    for (int i = 0; i < npairs; i++) {
+        if (i == 0 || strcmp(tmp_pool + pairs[i].off, tmp_pool + pairs[i - 1].off) != 0) {
+            ntokens++;
+            final_size += strlen(tmp_pool + pairs[i].off) + 1;
+        }
+    }
+
+    t->pool = arena_alloc(arena, final_size + 1);
+    t->token_off = arena_alloc(arena, sizeof(int) * (ntokens + 1));
+    t->post_start = arena_alloc(arena, sizeof(int) * (ntokens + 1));
+    t->post = arena_alloc(arena, sizeof(uint32_t) * (npairs + 1));
+    if (!t->pool || !t->token_off || !t->post_start || !t->post) {
+        fprintf(stderr, "Error: Could not allocate memory for token index.\n");
+        free(tmp_pool);
+        free(pairs);
+        free_token_index(t);
+        return;
+    }
+
+    int tok = -1;
+    int npost = 0;
+    int pool_used = 0;
+    for (int i = 0; i < npairs; i++) {
+        const char *s = tmp_pool + pairs[i].off;
+        if (tok < 0 || strcmp(s, t->pool + t->token_off[tok]) != 0) {
+            tok++;
+            int len = (int)strlen(s);
+            memcpy(t->pool + pool_used, s, len + 1);
+            t->token_off[tok] = pool_used;
+            t->post_start[tok] = npost;
+            pool_used += len + 1;
+        } else if (t->post[npost - 1] == pairs[i].rank) {
+            continue;   // same token twice in one term
+        }
+        t->post[npost++] = pairs[i].rank;
+    }
+    t->ntokens = ntokens;
+    t->post_start[ntokens] = npost;
+    t->token_off[ntokens] = pool_used;
+
+    free(tmp_pool);
+    free(pairs);
+    *idx = t;
+}
+
+/*
+ * Sets [*lo, *hi) to the dictionary tokens starting with prefix.
+ */
+static void token_range(const struct token_index *idx, const char *prefix, int *lo, int *hi)
+{
+    size_t m = strlen(prefix);
+    int left = 0, right = idx->ntokens;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (strncmp(idx->pool + idx->token_off[mid], prefix, m) < 0) left = mid + 1;
+        else right = mid;
+    }
+    *lo = left;
+    right = idx->ntokens;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (strncmp(idx->pool + idx->token_off[mid], prefix, m) <= 0) left = mid + 1;
+        else right = mid;
+    }
+    *hi = left;
+}
+
+/*
+ * Union of the posting lists of tokens [lo, hi), ascending and without
+ * duplicates, stopping after limit ranks. Returns the count written to out.
+ */
+static int merge_postings(const struct token_index *idx, int lo, int hi, uint32_t *out, int limit)
+{
+    int nlists = hi - lo;
+    int n = 0;
+    if (nlists == 1) {
+        int len = idx->post_start[hi] - idx->post_start[lo];
+        n = len < limit ? len : limit;
+        memcpy(out, idx->post + idx->post_start[lo], sizeof(uint32_t) * n);
+        return n;
+    }
+
+    // Min-heap of list cursors, ordered by the rank each one points at
+    int *heap = malloc(sizeof(int) * nlists);
+    int *pos = malloc(sizeof(int) * nlists);
+    if (!heap || !pos) {
+        free(heap);
+        free(pos);
+        return -1;
+    }
+    int size = 0;
+    for (int l = 0; l < nlists; l++) {
+        pos[l] = idx->post_start[lo + l];
+        int c = size++;
+        heap[c] = l;
+        while (c > 0 && idx->post[pos[heap[(c - 1) / 2]]] > idx->post[pos[heap[c]]]) {
+            int p = (c - 1) / 2;
+            int tmp = heap[p]; heap[p] = heap[c]; heap[c] = tmp;
+            c = p;
+        }
+    }
+
+    while (size > 0 && n < limit) {
+        int l = heap[0];
+        uint32_t r = idx->post[pos[l]];
+        if (n == 0 || out[n - 1] != r) {
+            out[n++] = r;
+        }
+        if (++pos[l] == idx->post_start[lo + l + 1]) {
+            heap[0] = heap[--size];
+        }
+        int i = 0;
+        for (;;) {
+            int a = 2 * i + 1, b = a + 1, m = i;
+            if (a < size && idx->post[pos[heap[a]]] < idx->post[pos[heap[m]]]) m = a;
+            if (b < size && idx->post[pos[heap[b]]] < idx->post[pos[heap[m]]]) m = b;
+            if (m == i) break;
+            int tmp = heap[i]; heap[i] = heap[m]; heap[m] = tmp;
+            i = m;
+        }
+    }
+    free(heap);
+    free(pos);
+    return n;
+}
+
+/*
+ * Intersects ascending lists a (the shorter) and b into out, which may
+ * alias a. Stops after limit results. Returns the number written.
+ *
+ * Each element of a skips b four ranks at a time and is then compared with
+ * a whole block at once (SSE2 when available). When b is much longer than a
+ * the skip gallops instead.
+ */
+static int intersect_postings(const uint32_t *a, int na, const uint32_t *b, int nb,
+                              uint32_t *out, int limit)
+{
+    int n = 0;
+    int j = 0;
+    int gallop = nb / (na > 0 ? na : 1) >= 32;
+
+    for (int i = 0; i < na && n < limit; i++) {
+        uint32_t x = a[i];
+        if (gallop) {
+            int step = 1;
+            while (j + step < nb && b[j + step] < x) {
+                j += step;
+                step *= 2;
+            }
+        }
+        while (j + 4 <= nb && b[j + 3] < x) {
+            j += 4;
+        }
+        if (j + 4 <= nb) {
+#if defined(__SSE2__)
+            __m128i block = _mm_loadu_si128((const __m128i *)(b + j));
+            __m128i eq = _mm_cmpeq_epi32(block, _mm_set1_epi32((int)x));
+            if (_mm_movemask_epi8(eq)) {
+                out[n++] = x;
+            }
+#else
+            if (b[j] == x || b[j + 1] == x || b[j + 2] == x || b[j + 3] == x) {
+                out[n++] = x;
+            }
+#endif
+            continue;
+        }
+        while (j < nb && b[j] < x) {
+            j++;
+        }
+        if (j < nb && b[j] == x) {
+            out[n++] = x;
+        }
+    }
+    return n;
+}
+
+/*
+ * Returns 1 if some token of the term starts with the (folded) query token.
+ */
+static int term_has_token_prefix(const char *term, const char *qtok)
+{
+    char buf[sizeof(((struct term *)0)->term)];
+    size_t m = strlen(qtok);
+    while (next_token(&term, buf, sizeof(buf)) > 0) {
+        if (strncmp(buf, qtok, m) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct query_token{
+    char text[sizeof(((struct term *)0)->term)];
+    int lo, hi;     // dictionary tokens it matches
+    int size;       // total length of their posting lists
+} query_token;
+
+static int compare_query_size(const void *a, const void *b)
+{
+    return ((const query_token *)a)->size - ((const query_token *)b)->size;
+}
+
+/*
+ * token_autocomplete():
+ *   - Splits query into tokens; a term matches if every query token is a
+ *     prefix of one of its tokens ("san fr" matches "San Francisco, ...").
+ *   - Returns the k heaviest matches, best first.
+ *
+ * Approach:
+ *   - The rarest query token supplies the candidate ranks.
+ *   - Other tokens with comparable list sizes are merged and intersected;
+ *     much larger ones are checked against the candidate's text instead.
+ *   - Candidates are visited in rank (= weight) order, so the work stops
+ *     as soon as k of them survive.
+ *
+ * Edge cases:
+ *   - If query has no tokens or nothing matches, sets *answer = NULL, *n_answer = 0.
+ */
+void token_autocomplete(struct term **answer, int *n_answer,
+                        const struct token_index *idx, const char *query, int k)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (!idx || !query || k <= 0) {
+        return;
+    }
+
+    query_token q[TOKEN_QUERY_MAX];
+    int nq = 0;
+    while (nq < TOKEN_QUERY_MAX && next_token(&query, q[nq].text, sizeof(q[nq].text)) > 0) {
+        token_range(idx, q[nq].text, &q[nq].lo, &q[nq].hi);
+        q[nq].size = idx->post_start[q[nq].hi] - idx->post_start[q[nq].lo];
+        if (q[nq].size == 0) {
+            return;
+        }
+        nq++;
+    }
+    if (nq == 0) {
+        return;
+    }
+    qsort(q, nq, sizeof(query_token), compare_query_size);
+
+    // Intersections only shrink, so the rarest token bounds the candidate count
+    uint32_t *cand = malloc(sizeof(uint32_t) * q[0].size);
+    uint32_t *list = nq > 1 ? malloc(sizeof(uint32_t) * q[nq - 1].size) : NULL;
+    int *ids = malloc(sizeof(int) * k);
+    if (!cand || (nq > 1 && !list) || !ids) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        free(cand);
+        free(list);
+        free(ids);
+        return;
+    }
+
+    // Tokens [nmerge, nq) are too common to intersect and are verified per candidate
+    int nmerge = 1;
+    while (nmerge < nq && q[nmerge].size <= VERIFY_RATIO * q[0].size) {
+        nmerge++;
+    }
+
+    int ncand = merge_postings(idx, q[0].lo, q[0].hi, cand, nq == 1 ? k : q[0].size);
+    for (int i = 1; i < nmerge && ncand > 0; i++) {
+        int nlist = merge_postings(idx, q[i].lo, q[i].hi, list, q[i].size);
+        if (nlist < 0) {
+            ncand = -1;
+            break;
+        }
+        int limit = (i == nmerge - 1 && nmerge == nq) ? k : ncand;
+        ncand = intersect_postings(cand, ncand, list, nlist, cand, limit);
+    }
+    if (ncand < 0) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        ncand = 0;
+    }
+
+    int count = 0;
+    for (int c = 0; c < ncand && count < k; c++) {
+        int id = idx->rank_term[cand[c]];
+        int ok = 1;
+        for (int i = nmerge; i < nq && ok; i++) {
+            ok = term_has_token_prefix(idx->terms[id].term, q[i].text);
+        }
+        if (ok) {
+            ids[count++] = id;
+        }
+    }
+
+    terms_from_ids(answer, n_answer, idx->terms, ids, count);
+    free(cand);
+    free(list);
+    free(ids);
+}
+
+void free_token_index(struct token_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    arena_free(idx->arena, idx->pool);
+    arena_free(idx->arena, idx->token_off);
+    arena_free(idx->arena, idx->post_start);
+    arena_free(idx->arena, idx->post);
+    arena_free(idx->arena, idx->rank_term);
+    arena_free(idx->arena, idx);
+}
@@ -0,0 +1,37 @@
+#if !defined(TOKENS_H)
+#define TOKENS_H
+
+#include <stdint.h>
+#include "autocomplete.h"
+
+// Most tokens a query may contain; extra tokens are ignored.
+#define TOKEN_QUERY_MAX 16
+
+/*
+ * Inverted index from the tokens of every term (split on whitespace and
+ * commas, ASCII case folded) to the terms containing them.
+ * Posting lists hold weight ranks rather than term ids: rank 0 is the
+ * heaviest term, so a list sorted for intersection is also sorted by
+ * descending weight and the first k survivors of an intersection are the
+ * answer. The index must be rebuilt if weights or the term array change.
+ */
+typedef struct token_index{
+    int ntokens;
+    char *pool;          // NUL-terminated tokens, in sorted order
+    int *token_off;      // start of token t in pool
+    int *post_start;     // postings of token t: post[post_start[t] .. post_start[t+1])
+    uint32_t *post;      // term ranks, ascending
+    int *rank_term;      // term id of every rank
+    struct term *terms;
+    int nterms;
+    struct arena *arena; // where the index lives, NULL for the heap
+} token_index;
+
+void build_token_index(struct token_index **idx, struct term *terms, int nterms);
+void build_token_index_arena(struct token_index **idx, struct term *terms, int nterms,
+                             struct arena *arena);
+void token_autocomplete(struct term **answer, int *n_answer,
+                        const struct token_index *idx, const char *query, int k);
+void free_token_index(struct token_index *idx);
+
+#endif
@@ -0,0 +1,1023 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "topk.h"
+#include "arena.h"
+
+/*
+ * Returns 1 if item a ranks strictly above item b.
+ * Ties on value are broken by position so results are deterministic.
+ * -1 stands for "no item" and ranks below everything.
+ */
+static int ranks_above(item_value_fn value, const void *ctx, int a, int b)
+{
+    if (a < 0) return 0;
+    if (b < 0) return 1;
+    double va = value(ctx, a);
+    double vb = value(ctx, b);
+    if (va != vb) return va > vb;
+    return a < b;
+}
+
+/*
+ * Position of the best item in [lo, hi) by linear scan, -1 if empty.
+ */
+static int scan_max(const struct range_max *rm, int lo, int hi)
+{
+    int best = -1;
+    for (int i = lo; i < hi; i++) {
+        if (ranks_above(rm->value, rm->ctx, i, best)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int better_of(const struct range_max *rm, int a, int b)
+{
+    return ranks_above(rm->value, rm->ctx, a, b) ? a : b;
+}
+
+/*
+ * build_range_max():
+ *   - Summarises items [0, n) whose values are read through value(ctx, i).
+ *   - Returns 0 on success, -1 if memory could not be allocated.
+ *
+ * The caller keeps ctx alive for as long as the structure is used and calls
+ * range_max_update() whenever the value of an item changes.
+ */
+int build_range_max(struct range_max *rm, int n, item_value_fn value, const void *ctx)
+{
+    return build_range_max_arena(rm, n, value, ctx, NULL);
+}
+
+/*
+ * build_range_max_arena():
+ *   - build_range_max() with the tree allocated from arena (malloc if NULL);
+ *     free_range_max() then leaves it to arena_release().
+ */
+int build_range_max_arena(struct range_max *rm, int n, item_value_fn value, const void *ctx,
+                          struct arena *arena)
+{
+    memset(rm, 0, sizeof(*rm));
+    rm->arena = arena;
+    rm->n = n > 0 ? n : 0;
+    rm->value = value;
+    rm->ctx = ctx;
+    rm->nblocks = (rm->n + RANGE_MAX_BLOCK - 1) / RANGE_MAX_BLOCK;
+    rm->size = 1;
+    while (rm->size < rm->nblocks) {
+        rm->size *= 2;
+    }
+
+    rm->tree = arena_alloc(arena, sizeof(int) * 2 * rm->size);
+    if (!rm->tree) {
+        fprintf(stderr, "Error: Could not allocate memory for range max.\n");
+        rm->n = rm->nblocks = 0;
+        return -1;
+    }
+
+    for (int i = 0; i < 2 * rm->size; i++) {
+        rm->tree[i] = -1;
+    }
+    for (int b = 0; b < rm->nblocks; b++) {
+        int hi = (b + 1) * RANGE_MAX_BLOCK;
+        rm->tree[rm->size + b] = scan_max(rm, b * RANGE_MAX_BLOCK, hi < rm->n ? hi : rm->n);
+    }
+    for (int node = rm->size - 1; node >= 1; node--) {
+        rm->tree[node] = better_of(rm, rm->tree[2 * node], rm->tree[2 * node + 1]);
+    }
+    return 0;
+}
+
+static double term_weight_value(const void *ctx, int i)
+{
+    return ((const struct term *)ctx)[i].weight;
+}
+
+/*
+ * build_term_range_max():
+ *   - Convenience wrapper ranking the sorted term array by weight.
+ */
+int build_term_range_max(struct range_max *rm, struct term *terms, int nterms)
+{
+    return build_range_max(rm, nterms, term_weight_value, terms);
+}
+
+/*
+ * Best block in [blo, bhi) using the tree.
+ */
+static int tree_query(const struct range_max *rm, int blo, int bhi)
+{
+    int best = -1;
+    int l = blo + rm->size;
+    int r = bhi + rm->size;
+    while (l < r) {
+        if (l & 1) best = better_of(rm, rm->tree[l++], best);
+        if (r & 1) best = better_of(rm, rm->tree[--r], best);
+        l /= 2;
+        r /= 2;
+    }
+    return best;
+}
+
+/*
+ * range_max_query():
+ *   - Returns the position of the highest ranked item in [lo, hi),
+ *     or -1 if the range is empty.
+ *
+ * Cost: O(RANGE_MAX_BLOCK + log(n / RANGE_MAX_BLOCK)) value reads.
+ */
+int range_max_query(const struct range_max *rm, int lo, int hi)
+{
+    if (lo < 0) lo = 0;
+    if (hi > rm->n) hi = rm->n;
+    if (lo >= hi) {
+        return -1;
+    }
+
+    int blo = (lo + RANGE_MAX_BLOCK - 1) / RANGE_MAX_BLOCK; // first whole block
+    int bhi = hi / RANGE_MAX_BLOCK;                          // one past last whole block
+    if (blo >= bhi) {
+        return scan_max(rm, lo, hi);
+    }
+
+    int best = tree_query(rm, blo, bhi);
+    best = better_of(rm, scan_max(rm, lo, blo * RANGE_MAX_BLOCK), best);
+    best = better_of(rm, scan_max(rm, bhi * RANGE_MAX_BLOCK, hi), best);
+    return best;
+}
+
+/*
+ * range_max_update():
+ *   - Must be called after the value of item i changed.
+ *   - Rescans i's block and walks up the tree: O(RANGE_MAX_BLOCK + log n).
+ */
+void range_max_update(struct range_max *rm, int i)
+{
+    if (i < 0 || i >= rm->n) {
+        return;
+    }
+    int b = i / RANGE_MAX_BLOCK;
+    int hi = (b + 1) * RANGE_MAX_BLOCK;
+    int node = rm->size + b;
+    rm->tree[node] = scan_max(rm, b * RANGE_MAX_BLOCK, hi < rm->n ? hi : rm->n);
+    for (node /= 2; node >= 1; node /= 2) {
+        rm->tree[node] = better_of(rm, rm->tree[2 * node], rm->tree[2 * node + 1]);
+    }
+}
+
+void free_range_max(struct range_max *rm)
+{
+    if (!rm) {
+        return;
+    }
+    arena_free(rm->arena, rm->tree);
+    rm->tree = NULL;
+    rm->n = rm->nblocks = rm->size = 0;
+}
+
+static int heap_above(const struct range_heap *h, int a, int b)
+{
+    return ranks_above(h->rm->value, h->rm->ctx, h->items[a].best, h->items[b].best);
+}
+
+static void heap_swap(struct range_heap *h, int a, int b)
+{
+    struct range_entry tmp = h->items[a];
+    h->items[a] = h->items[b];
+    h->items[b] = tmp;
+}
+
+static int heap_insert(struct range_heap *h, int lo, int hi, int best)
+{
+    if (h->n == h->cap) {
+        int cap = h->cap ? h->cap * 2 : 16;
+        struct range_entry *items = realloc(h->items, sizeof(struct range_entry) * cap);
+        if (!items) {
+            return -1;
+        }
+        h->items = items;
+        h->cap = cap;
+    }
+    int i = h->n++;
+    h->items[i].lo = lo;
+    h->items[i].hi = hi;
+    h->items[i].best = best;
+    while (i > 0 && heap_above(h, i, (i - 1) / 2)) {
+        heap_swap(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    return 0;
+}
+
+static int heap_push(struct range_heap *h, int lo, int hi)
+{
+    int best = range_max_query(h->rm, lo, hi);
+    return best < 0 ? 0 : heap_insert(h, lo, hi, best);
+}
+
+static struct range_entry heap_pop(struct range_heap *h)
+{
+    struct range_entry top = h->items[0];
+    h->items[0] = h->items[--h->n];
+    int i = 0;
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < h->n && heap_above(h, l, m)) m = l;
+        if (r < h->n && heap_above(h, r, m)) m = r;
+        if (m == i) break;
+        heap_swap(h, i, m);
+        i = m;
+    }
+    return top;
+}
+
+/*
+ * Open-addressing set of non-negative ids, used to de-duplicate results.
+ */
+typedef struct id_set{
+    int *slots;
+    int mask;
+} id_set;
+
+static int id_set_init(struct id_set *s, int k)
+{
+    int cap = 16;
+    while (cap < 2 * k) {
+        cap *= 2;
+    }
+    s->slots = malloc(sizeof(int) * cap);
+    if (!s->slots) {
+        return -1;
+    }
+    for (int i = 0; i < cap; i++) {
+        s->slots[i] = -1;
+    }
+    s->mask = cap - 1;
+    return 0;
+}
+
+// Inserts id; returns 1 if it was new, 0 if already present.
+static int id_set_insert(struct id_set *s, int id)
+{
+    unsigned h = ((unsigned)id * 2654435761u) & (unsigned)s->mask;
+    while (s->slots[h] != -1) {
+        if (s->slots[h] == id) {
+            return 0;
+        }
+        h = (h + 1) & (unsigned)s->mask;
+    }
+    s->slots[h] = id;
+    return 1;
+}
+
+/*
+ * Heap selection behind top_k_ranges() and top_k_ranges_by_id().
+ */
+static int select_ranges(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                         int k, item_id_fn id, const void *id_ctx, int ties_by_id, int *out)
+{
+    if (!rm || k <= 0) {
+        return 0;
+    }
+
+    struct range_heap heap = { NULL, 0, 0, rm, -1, 0 };
+    struct id_set seen = { NULL, 0 };
+    if (id && id_set_init(&seen, k) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for top-k selection.\n");
+        return 0;
+    }
+
+    int count = 0;
+    int failed = 0;
+    for (int r = 0; r < nranges && !failed; r++) {
+        failed = heap_push(&heap, lo[r], hi[r]) != 0;
+    }
+
+    while (!failed && heap.n > 0) {
+        if (count == k && (!ties_by_id
+                           || rm->value(rm->ctx, heap.items[0].best)
+                              != rm->value(rm->ctx, out[k - 1]))) {
+            break;
+        }
+        struct range_entry e = heap_pop(&heap);
+        int item_id = id ? id(id_ctx, e.best) : 0;
+        if (count == k && item_id > id(id_ctx, out[k - 1])) {
+            item_id = -1;   // a tie that ranks below the last item kept
+        }
+        if (!id || (item_id >= 0 && id_set_insert(&seen, item_id))) {
+            int j = count < k ? count++ : k - 1;   // when full, replaces the last item
+            while (ties_by_id && j > 0
+                   && rm->value(rm->ctx, out[j - 1]) == rm->value(rm->ctx, e.best)
+                   && id(id_ctx, out[j - 1]) > item_id) {
+                out[j] = out[j - 1];
+                j--;
+            }
+            out[j] = e.best;
+        }
+        failed = heap_push(&heap, e.lo, e.best) != 0
+              || heap_push(&heap, e.best + 1, e.hi) != 0;
+    }
+
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for top-k selection.\n");
+    }
+    free(heap.items);
+    free(seen.slots);
+    return count;
+}
+
+/*
+ * top_k_ranges():
+ *   - Writes into out[] the positions of the k highest ranked items of the
+ *     union of ranges [lo[r], hi[r]), best first. The ranges must not overlap.
+ *   - If id is not NULL, items are de-duplicated on id(id_ctx, position) and
+ *     only the first (best) item of every id is kept. A negative id
+ *     rejects the item, which lets callers filter while they de-duplicate.
+ *   - Returns the number of positions written (<= k).
+ *
+ * Approach:
+ *   - A heap holds pending ranges keyed by their best item (range_max).
+ *   - Popping a range emits its best item and pushes the two halves around it,
+ *     so k results cost O(k log k) range_max queries regardless of range size.
+ */
+int top_k_ranges(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                 int k, item_id_fn id, const void *id_ctx, int *out)
+{
+    return select_ranges(rm, lo, hi, nranges, k, id, id_ctx, 0, out);
+}
+
+/*
+ * top_k_ranges_by_id():
+ *   - Same as top_k_ranges() with an id, except that items of equal value
+ *     rank by id rather than by position. Once positions are mapped to
+ *     their ids, out[] is in the (value desc, id asc) order merge_top_k()
+ *     expects, and a tie at the k-th place keeps the lowest id.
+ *   - Settling a tie at the k-th place pops every item of that value in
+ *     the ranges, so prefer top_k_ranges() when id follows position.
+ */
+int top_k_ranges_by_id(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                       int k, item_id_fn id, const void *id_ctx, int *out)
+{
+    if (!id) {
+        return 0;
+    }
+    return select_ranges(rm, lo, hi, nranges, k, id, id_ctx, 1, out);
+}
+
+/*
+ * build_global_top():
+ *   - Precomputes the best k + GLOBAL_TOP_SLACK items of rm, in
+ *     O(k log k) range_max queries. Returns 0, or -1 on allocation failure.
+ *   - The caller then updates items through range_max_update_top(), or
+ *     calls global_top_update() after every range_max_update().
+ */
+int build_global_top(struct global_top *g, const struct range_max *rm, int k)
+{
+    memset(g, 0, sizeof(*g));
+    g->rm = rm;
+    g->k = k > 0 ? k : 0;
+    g->cap = g->k + GLOBAL_TOP_SLACK;
+    g->ids = malloc(sizeof(int) * g->cap);
+    if (!g->ids) {
+        fprintf(stderr, "Error: Could not allocate memory for global top-k.\n");
+        return -1;
+    }
+    int lo = 0, hi = rm->n;
+    g->n = top_k_ranges(rm, &lo, &hi, 1, g->cap, NULL, NULL, g->ids);
+    return 0;
+}
+
+/*
+ * global_top_update():
+ *   - Must be called after the value of item i changed (and rm was updated).
+ *   - O(cap) work, except when demotions have left fewer than k entries:
+ *     the list is then rebuilt with O(cap log cap) range_max queries.
+ *
+ * Every item outside the list ranks below the list's last entry, which is
+ * what keeps the list exact:
+ *   - a member that still ranks above the last other entry moves to its
+ *     new place;
+ *   - a member that fell below it is dropped, since an outsider might now
+ *     rank above it;
+ *   - an outsider that rises above the last entry is inserted, pushing the
+ *     last entry out if the list is full.
+ */
+void global_top_update(struct global_top *g, int i)
+{
+    if (!g->ids || i < 0 || i >= g->rm->n) {
+        return;
+    }
+    item_value_fn value = g->rm->value;
+    const void *ctx = g->rm->ctx;
+
+    int at = -1;
+    for (int j = 0; j < g->n; j++) {
+        if (g->ids[j] == i) {
+            at = j;
+            break;
+        }
+    }
+
+    if (at >= 0) {
+        memmove(g->ids + at, g->ids + at + 1, sizeof(int) * (g->n - at - 1));
+        g->n--;
+        // Outsiders rank below every remaining entry, including the last
+        int floor = g->n > 0 ? g->ids[g->n - 1] : -1;
+        if (floor < 0 || !ranks_above(value, ctx, i, floor)) {
+            if (g->n < g->k && g->n < g->rm->n) {
+                global_top_reset(g);
+            }
+            return;
+        }
+    } else if (g->n == 0 || !ranks_above(value, ctx, i, g->ids[g->n - 1])) {
+        return;
+    } else if (g->n == g->cap) {
+        g->n--;   // the last entry leaves to make room
+    }
+
+    int pos = g->n;
+    while (pos > 0 && ranks_above(value, ctx, i, g->ids[pos - 1])) {
+        pos--;
+    }
+    memmove(g->ids + pos + 1, g->ids + pos, sizeof(int) * (g->n - pos));
+    g->ids[pos] = i;
+    g->n++;
+}
+
+/*
+ * global_top_reset():
+ *   - Recomputes the list from the range_max, for when rm was rebuilt
+ *     (e.g. over a merged terms array) rather than updated item by item.
+ *   - O(cap log cap) range_max queries; the list keeps its memory.
+ */
+void global_top_reset(struct global_top *g)
+{
+    if (!g->ids) {
+        return;
+    }
+    int lo = 0, hi = g->rm->n;
+    g->n = top_k_ranges(g->rm, &lo, &hi, 1, g->cap, NULL, NULL, g->ids);
+}
+
+/*
+ * range_max_update_top():
+ *   - The one call to make after the value of item i changed:
+ *     range_max_update() on rm, then global_top_update() on g, the global
+ *     top built over rm (NULL if there is none).
+ */
+void range_max_update_top(struct range_max *rm, struct global_top *g, int i)
+{
+    range_max_update(rm, i);
+    if (g) {
+        global_top_update(g, i);
+    }
+}
+
+/*
+ * global_top_ids():
+ *   - Writes the positions of the best k items to out, best first, and
+ *     returns how many were written. Up to the k given at build time this
+ *     is a copy of the list; beyond it falls back to top_k_ranges().
+ */
+int global_top_ids(const struct global_top *g, int k, int *out)
+{
+    if (!g->ids || k <= 0) {
+        return 0;
+    }
+    if (k <= g->n) {
+        memcpy(out, g->ids, sizeof(int) * k);
+        return k;
+    }
+    int lo = 0, hi = g->rm->n;
+    return top_k_ranges(g->rm, &lo, &hi, 1, k, NULL, NULL, out);
+}
+
+void free_global_top(struct global_top *g)
+{
+    if (!g) {
+        return;
+    }
+    free(g->ids);
+    g->ids = NULL;
+    g->n = 0;
+}
+
+/*
+ * range_iter_init():
+ *   - Starts an iterator over the union of ranges [lo[r], hi[r]), which
+ *     must not overlap. Returns 0, or -1 if memory could not be allocated.
+ */
+int range_iter_init(struct range_heap *it, const struct range_max *rm,
+                    const int *lo, const int *hi, int nranges)
+{
+    it->items = NULL;
+    it->n = it->cap = 0;
+    it->rm = rm;
+    it->last = -1;
+    it->last_value = 0;
+    for (int r = 0; r < nranges; r++) {
+        if (heap_push(it, lo[r], hi[r]) != 0) {
+            range_iter_free(it);
+            fprintf(stderr, "Error: Could not allocate memory for result iterator.\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * range_iter_next():
+ *   - Returns the position of the next item in rank order (the order of
+ *     top_k_ranges()), or -1 once every item has been returned.
+ *   - O(log pending) heap work plus two range_max queries per item.
+ */
+int range_iter_next(struct range_heap *it)
+{
+    if (it->n == 0) {
+        return -1;
+    }
+    struct range_entry e = heap_pop(it);
+    if (heap_push(it, e.lo, e.best) != 0 || heap_push(it, e.best + 1, e.hi) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for result iterator.\n");
+        it->n = 0;   // stop rather than skip items silently
+    }
+    it->last = e.best;
+    it->last_value = it->rm->value(it->rm->ctx, e.best);
+    return e.best;
+}
+
+/*
+ * range_iter_save():
+ *   - Writes the iterator state to buf as a printable cursor of constant
+ *     size: the value and position of the last item returned as
+ *     "value@position" (value in C99 hex-float notation, so it reads back
+ *     exactly), "end" once the iterator is exhausted, or "" if it has not
+ *     returned anything yet.
+ *   - Like snprintf(), returns the cursor length; if that is >= cap the
+ *     cursor was truncated. RANGE_ITER_CURSOR bytes always suffice.
+ */
+int range_iter_save(const struct range_heap *it, char *buf, size_t cap)
+{
+    if (it->n == 0) {
+        return snprintf(buf, cap, "end");
+    }
+    if (it->last < 0) {
+        return snprintf(buf, cap, "%s", "");
+    }
+    return snprintf(buf, cap, "%a@%d", it->last_value, it->last);
+}
+
+// Returns 1 if item i ranks at or above the item of value v at position p.
+static int at_or_above(const struct range_max *rm, int i, double v, int p)
+{
+    double vi = rm->value(rm->ctx, i);
+    if (vi != v) return vi > v;
+    return i <= p;
+}
+
+/*
+ * range_iter_load():
+ *   - Rebuilds an iterator over [lo, hi), normally the query's match range,
+ *     from a cursor written by range_iter_save(): it yields the items of
+ *     [lo, hi) that rank below the cursor's item, in rank order.
+ *   - Returns 0, or -1 on a malformed cursor, a cursor item outside
+ *     [lo, hi), or allocation failure.
+ *
+ * Approach:
+ *   - Descends the range_max: a range whose best item ranks at or above
+ *     the cursor is split around that item, any other range is pending.
+ *     Resuming costs one range_max query per item already returned from
+ *     [lo, hi), and reads nothing but the constant-size cursor.
+ */
+int range_iter_load(struct range_heap *it, const struct range_max *rm, const char *cursor,
+                    int lo, int hi)
+{
+    it->items = NULL;
+    it->n = it->cap = 0;
+    it->rm = rm;
+    it->last = -1;
+    it->last_value = 0;
+    if (strcmp(cursor, "end") == 0) {
+        return 0;
+    }
+    if (cursor[0] == '\0') {
+        return range_iter_init(it, rm, &lo, &hi, 1);
+    }
+
+    char *end;
+    double v = strtod(cursor, &end);
+    const char *s = end;
+    long p = *s == '@' ? strtol(s + 1, &end, 10) : -1;
+    if (s == cursor || *s != '@' || end == s + 1 || *end != '\0' || p < lo || p >= hi
+        || v != v) {
+        fprintf(stderr, "Error: Invalid result cursor \"%s\"\n", cursor);
+        return -1;
+    }
+
+    // Ranges still to be split, at most one per item ranking above the cursor plus one
+    struct range_entry *stack = malloc(sizeof(struct range_entry) * 16);
+    int top = 0, stack_cap = 16;
+    int failed = !stack;
+    if (stack) {
+        stack[top++] = (struct range_entry){ lo, hi, -1 };
+    }
+    while (!failed && top > 0) {
+        struct range_entry e = stack[--top];
+        int best = range_max_query(rm, e.lo, e.hi);
+        if (best < 0) {
+            continue;
+        }
+        if (!at_or_above(rm, best, v, (int)p)) {
+            failed = heap_insert(it, e.lo, e.hi, best) != 0;
+            continue;
+        }
+        if (top + 2 > stack_cap) {
+            struct range_entry *grown = realloc(stack, sizeof(struct range_entry) * stack_cap * 2);
+            if (!grown) {
+                failed = 1;
+                break;
+            }
+            stack = grown;
+            stack_cap *= 2;
+        }
+        stack[top++] = (struct range_entry){ e.lo, best, -1 };
+        stack[top++] = (struct range_entry){ best + 1, e.hi, -1 };
+    }
+    free(stack);
+    if (failed) {
+        fprintf(stderr, "Error: Could not allocate memory for result iterator.\n");
+        range_iter_free(it);
+        return -1;
+    }
+    it->last = (int)p;
+    it->last_value = v;
+    return 0;
+}
+
+void range_iter_free(struct range_heap *it)
+{
+    free(it->items);
+    it->items = NULL;
+    it->n = it->cap = 0;
+}
+
+/*
+ * build_range_iter_cache():
+ *   - Allocates an empty cache of parked iterators.
+ *
+ * Edge cases addressed:
+ *   - On allocation failure prints an error and sets *cache = NULL.
+ */
+void build_range_iter_cache(struct range_iter_cache **cache)
+{
+    *cache = calloc(1, sizeof(struct range_iter_cache));
+    if (!*cache) {
+        fprintf(stderr, "Error: Could not allocate memory for iterator cache.\n");
+        return;
+    }
+    pthread_mutex_init(&(*cache)->lock, NULL);
+    (*cache)->next_handle = 1;
+}
+
+/*
+ * range_iter_park():
+ *   - Moves it into the cache, leaving it empty, and returns the handle
+ *     to resume it with; tag, lo and hi must match on resume.
+ *   - Returns 0 (and frees it) if there is no cache or it is exhausted.
+ *   - With every slot taken, the least recently parked iterator is freed;
+ *     its cursor then resumes through range_iter_load().
+ */
+unsigned range_iter_park(struct range_iter_cache *cache, struct range_heap *it, unsigned tag,
+                         int lo, int hi)
+{
+    if (!cache || it->n == 0) {
+        range_iter_free(it);
+        return 0;
+    }
+    pthread_mutex_lock(&cache->lock);
+    struct range_iter_slot *slot = NULL;
+    for (int s = 0; s < RANGE_ITER_CACHE_SLOTS; s++) {
+        struct range_iter_slot *x = &cache->slots[s];
+        if (x->handle == 0) {
+            slot = x;
+            break;
+        }
+        if (!slot || x->parked < slot->parked) {
+            slot = x;
+        }
+    }
+    if (slot->handle != 0) {
+        range_iter_free(&slot->it);
+    }
+    slot->handle = cache->next_handle++;
+    if (cache->next_handle == 0) {
+        cache->next_handle = 1;   // 0 means "not parked"
+    }
+    slot->tag = tag;
+    slot->lo = lo;
+    slot->hi = hi;
+    slot->parked = ++cache->clock;
+    slot->it = *it;
+    unsigned handle = slot->handle;
+    pthread_mutex_unlock(&cache->lock);
+
+    it->items = NULL;
+    it->n = it->cap = 0;
+    return handle;
+}
+
+/*
+ * range_iter_resume():
+ *   - Takes the iterator parked under handle out of the cache into it,
+ *     provided it was parked with the same tag, rm and range and its
+ *     range_iter_save() state is still cursor. O(RANGE_ITER_CACHE_SLOTS).
+ *   - Returns 0, or -1 if it is not there (never parked, evicted, or
+ *     already resumed by an earlier use of the cursor); the caller then
+ *     falls back to range_iter_load().
+ */
+int range_iter_resume(struct range_iter_cache *cache, struct range_heap *it, unsigned handle,
+                      unsigned tag, const struct range_max *rm, int lo, int hi,
+                      const char *cursor)
+{
+    if (!cache || handle == 0) {
+        return -1;
+    }
+    int found = 0;
+    pthread_mutex_lock(&cache->lock);
+    for (int s = 0; s < RANGE_ITER_CACHE_SLOTS; s++) {
+        struct range_iter_slot *x = &cache->slots[s];
+        if (x->handle != handle) {
+            continue;
+        }
+        char state[RANGE_ITER_CURSOR];
+        range_iter_save(&x->it, state, sizeof(state));
+        if (x->tag == tag && x->it.rm == rm && x->lo == lo && x->hi == hi
+            && strcmp(state, cursor) == 0) {
+            *it = x->it;
+            x->handle = 0;
+            found = 1;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return found ? 0 : -1;
+}
+
+void free_range_iter_cache(struct range_iter_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+    for (int s = 0; s < RANGE_ITER_CACHE_SLOTS; s++) {
+        if (cache->slots[s].handle != 0) {
+            range_iter_free(&cache->slots[s].it);
+        }
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/*
+ * Bounded min-heap of scored items for top_k_scored(): the root is the
+ * worst item kept so far. Equal scores rank the lower position first.
+ */
+static int scored_above(double sa, int a, double sb, int b)
+{
+    if (sa != sb) return sa > sb;
+    return a < b;
+}
+
+static void scored_sift_down(int *ids, double *scores, int n, int i)
+{
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && scored_above(scores[m], ids[m], scores[l], ids[l])) m = l;
+        if (r < n && scored_above(scores[m], ids[m], scores[r], ids[r])) m = r;
+        if (m == i) break;
+        int ti = ids[i];
+        ids[i] = ids[m];
+        ids[m] = ti;
+        double ts = scores[i];
+        scores[i] = scores[m];
+        scores[m] = ts;
+        i = m;
+    }
+}
+
+// Offers item i with score s to a heap of *n items holding at most k.
+static void scored_offer(int *ids, double *scores, int *n, int k, int i, double s)
+{
+    if (*n < k) {
+        int c = (*n)++;
+        ids[c] = i;
+        scores[c] = s;
+        while (c > 0 && scored_above(scores[(c - 1) / 2], ids[(c - 1) / 2], scores[c], ids[c])) {
+            int p = (c - 1) / 2;
+            int ti = ids[p];
+            ids[p] = ids[c];
+            ids[c] = ti;
+            double ts = scores[p];
+            scores[p] = scores[c];
+            scores[c] = ts;
+            c = p;
+        }
+    } else if (scored_above(s, i, scores[0], ids[0])) {
+        ids[0] = i;
+        scores[0] = s;
+        scored_sift_down(ids, scores, *n, 0);
+    }
+}
+
+/*
+ * top_k_scored():
+ *   - Writes into out[] the positions of the k items of the union of ranges
+ *     [lo[r], hi[r]) with the highest score(ctx, i), best first, and their
+ *     scores into scores[] (both hold k entries). Returns the number written.
+ *   - rm ranks the same items by a value that bound(ctx, value) turns into
+ *     an upper bound on their score. Without rm or bound every item is
+ *     scored once.
+ *
+ * Approach (WAND-style threshold):
+ *   - Ranges are visited through the top_k_ranges() heap, i.e. by
+ *     decreasing value, and each popped item is scored.
+ *   - Once k items are held and the bound of the best pending value falls
+ *     below the k-th score, no unread item can enter the result and the
+ *     search stops. With a tight bound that is a few dozen items even for
+ *     a prefix that covers the whole dictionary.
+ */
+int top_k_scored(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                 int k, item_score_fn score, score_bound_fn bound, const void *ctx,
+                 int *out, double *scores)
+{
+    if (k <= 0 || !score) {
+        return 0;
+    }
+
+    int n = 0;
+    if (!rm || !bound) {
+        for (int r = 0; r < nranges; r++) {
+            for (int i = lo[r]; i < hi[r]; i++) {
+                scored_offer(out, scores, &n, k, i, score(ctx, i));
+            }
+        }
+    } else {
+        struct range_heap heap = { NULL, 0, 0, rm, -1, 0 };
+        int failed = 0;
+        for (int r = 0; r < nranges && !failed; r++) {
+            failed = heap_push(&heap, lo[r], hi[r]) != 0;
+        }
+        while (!failed && heap.n > 0) {
+            if (n == k && bound(ctx, rm->value(rm->ctx, heap.items[0].best)) < scores[0]) {
+                break;
+            }
+            struct range_entry e = heap_pop(&heap);
+            scored_offer(out, scores, &n, k, e.best, score(ctx, e.best));
+            failed = heap_push(&heap, e.lo, e.best) != 0
+                  || heap_push(&heap, e.best + 1, e.hi) != 0;
+        }
+        if (failed) {
+            fprintf(stderr, "Error: Could not allocate memory for top-k selection.\n");
+        }
+        free(heap.items);
+    }
+
+    // Heap-sort in place: repeatedly move the worst item to the back
+    for (int end = n - 1; end > 0; end--) {
+        int ti = out[0];
+        out[0] = out[end];
+        out[end] = ti;
+        double ts = scores[0];
+        scores[0] = scores[end];
+        scores[end] = ts;
+        scored_sift_down(out, scores, end, 0);
+    }
+    return n;
+}
+
+/*
+ * merge_top_k():
+ *   - a and b are term ids ordered by descending weight (e.g. two top_k_*
+ *     results). Writes the k heaviest distinct ids of both lists to out,
+ *     which must not alias a or b, and returns the number written.
+ *   - On equal weight the lower term id comes first, as everywhere else.
+ */
+int merge_top_k(const struct term *terms, const int *a, int na, const int *b, int nb,
+                int k, int *out)
+{
+    struct id_set seen;
+    if (k <= 0 || id_set_init(&seen, na + nb) != 0) {
+        return 0;
+    }
+
+    int n = 0, i = 0, j = 0;
+    while (n < k && (i < na || j < nb)) {
+        int take;
+        if (j >= nb || (i < na && ranks_above(term_weight_value, terms, a[i], b[j]))) {
+            take = a[i++];
+        } else {
+            take = b[j++];
+        }
+        if (id_set_insert(&seen, take)) {
+            out[n++] = take;
+        }
+    }
+    free(seen.slots);
+    return n;
+}
+
+/*
+ * Min-heap helpers for top_k_scan_ranges(): the root is the worst item kept so far.
+ */
+static void sift_down_worst(int *heap, int n, int i, item_value_fn value, const void *ctx)
+{
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && ranks_above(value, ctx, heap[m], heap[l])) m = l;
+        if (r < n && ranks_above(value, ctx, heap[m], heap[r])) m = r;
+        if (m == i) break;
+        int tmp = heap[i];
+        heap[i] = heap[m];
+        heap[m] = tmp;
+        i = m;
+    }
+}
+
+/*
+ * top_k_scan_ranges():
+ *   - Same contract as top_k_ranges(), but without any index: scans every
+ *     range once keeping the best k in a bounded heap.
+ *   - O(total length * log k) time, O(1) extra memory (out doubles as the heap).
+ */
+int top_k_scan_ranges(const int *lo, const int *hi, int nranges, int k,
+                      item_value_fn value, const void *ctx, int *out)
+{
+    int n = 0;
+    if (k <= 0) {
+        return 0;
+    }
+
+    for (int r = 0; r < nranges; r++) {
+        for (int i = lo[r]; i < hi[r]; i++) {
+            if (n < k) {
+                // Sift the new item up towards the root while it ranks below its parent
+                int c = n++;
+                out[c] = i;
+                while (c > 0 && ranks_above(value, ctx, out[(c - 1) / 2], out[c])) {
+                    int p = (c - 1) / 2;
+                    int tmp = out[p];
+                    out[p] = out[c];
+                    out[c] = tmp;
+                    c = p;
+                }
+            } else if (ranks_above(value, ctx, i, out[0])) {
+                out[0] = i;
+                sift_down_worst(out, n, 0, value, ctx);
+            }
+        }
+    }
+
+    // Heap-sort in place: repeatedly move the worst item to the back
+    for (int end = n - 1; end > 0; end--) {
+        int tmp = out[0];
+        out[0] = out[end];
+        out[end] = tmp;
+        sift_down_worst(out, end, 0, value, ctx);
+    }
+    return n;
+}
+
+/*
+ * top_k_scan():
+ *   - top_k_scan_ranges() for the single range [lo, hi).
+ */
+int top_k_scan(int lo, int hi, int k, item_value_fn value, const void *ctx, int *out)
+{
+    return top_k_scan_ranges(&lo, &hi, 1, k, value, ctx, out);
+}
+
+/*
+ * terms_from_ids():
+ *   - Allocates *answer and copies terms[ids[i]] for i in [0, n), in order.
+ *   - On failure or n == 0 sets *answer = NULL, *n_answer = 0.
+ */
+void terms_from_ids(struct term **answer, int *n_answer, const struct term *terms,
+                    const int *ids, int n)
+{
+    *answer = NULL;
+    *n_answer = 0;
+    if (n <= 0) {
+        return;
+    }
+
+    *answer = malloc(sizeof(struct term) * n);
+    if (!(*answer)) {
+        fprintf(stderr, "Error: Could not allocate memory for autocomplete list.\n");
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        (*answer)[i] = terms[ids[i]];
+    }
+    *n_answer = n;
+}
@@ -0,0 +1,152 @@
+#if !defined(TOPK_H)
+#define TOPK_H
+
+#include <pthread.h>
+#include "autocomplete.h"
+
+// Number of items summarised by one leaf of a range_max tree.
+#define RANGE_MAX_BLOCK 32
+
+/*
+ * Returns the ranking value of item i (larger ranks first).
+ * ctx is whatever the caller passed alongside the function.
+ */
+typedef double (*item_value_fn)(const void *ctx, int i);
+
+/*
+ * Maps item i to the id used for de-duplication (e.g. the term an index
+ * entry points at). Items that map to an id already emitted are skipped,
+ * and items that map to a negative id are rejected.
+ */
+typedef int (*item_id_fn)(const void *ctx, int i);
+
+/*
+ * Range-maximum structure over n items.
+ * Items are grouped in blocks of RANGE_MAX_BLOCK; a segment tree stores the
+ * position of the largest item of every block and of every run of blocks.
+ * Values are never copied, they are read back through value(ctx, i), so the
+ * structure costs about 8 bytes per block no matter what the items are.
+ */
+typedef struct range_max{
+    int n;              // number of items
+    int nblocks;        // number of blocks
+    int size;           // number of leaves in the tree (power of two >= nblocks)
+    int *tree;          // argmax item of every tree node, -1 if empty
+    item_value_fn value;
+    const void *ctx;
+    struct arena *arena; // where tree lives, NULL for the heap
+} range_max;
+
+/*
+ * Max-heap of pending ranges, keyed by the value of each range's best item.
+ * top_k_ranges() drains one internally; as a range_iter it yields items of
+ * any number of ranges in rank order on demand, and its cursor is just the
+ * last item it returned.
+ */
+typedef struct range_entry{
+    int lo, hi;
+    int best;           // position of the range's best item
+} range_entry;
+
+typedef struct range_heap{
+    struct range_entry *items;
+    int n, cap;
+    const struct range_max *rm;
+    int last;           // position of the last item returned, -1 if none
+    double last_value;  // and its value when it was returned
+} range_heap, range_iter;
+
+// Bytes that always hold a cursor written by range_iter_save().
+#define RANGE_ITER_CURSOR 48
+
+// Iterators a range_iter_cache holds before it evicts the least recently parked.
+#define RANGE_ITER_CACHE_SLOTS 64
+
+typedef struct range_iter_slot{
+    unsigned handle;        // 0 if the slot is free
+    unsigned tag;           // caller's key, e.g. a hash of the query
+    int lo, hi;             // range the iterator was started on
+    unsigned long parked;   // cache clock when parked, for eviction
+    struct range_heap it;
+} range_iter_slot;
+
+/*
+ * Iterators parked between calls under a handle, so that the next page of
+ * a query continues its heap where the previous page stopped instead of
+ * rebuilding it from a cursor (see range_iter_load()). A parked iterator
+ * is taken out to be resumed, so each one serves exactly one cursor.
+ * Safe to share between threads; entries assume the range_max is not
+ * updated while they are parked.
+ */
+typedef struct range_iter_cache{
+    pthread_mutex_t lock;
+    unsigned next_handle;
+    unsigned long clock;
+    struct range_iter_slot slots[RANGE_ITER_CACHE_SLOTS];
+} range_iter_cache;
+
+// Extra entries a global_top keeps beyond the k asked for, to absorb demotions.
+#define GLOBAL_TOP_SLACK 32
+
+// k of the global_top dictionaries keep for empty-prefix queries.
+#define GLOBAL_TOP_K 100
+
+/*
+ * The best items of a whole range_max, best first, kept exact across
+ * weight updates: for empty-prefix ("most popular") queries without
+ * scanning the dictionary. Always the exact top n items; a demotion may
+ * shrink the list, and it is refilled from the range_max once it falls
+ * below k.
+ */
+typedef struct global_top{
+    int k;        // entries guaranteed to callers
+    int cap;      // k + GLOBAL_TOP_SLACK
+    int n;
+    int *ids;     // positions, best first
+    const struct range_max *rm;
+} global_top;
+
+int build_range_max(struct range_max *rm, int n, item_value_fn value, const void *ctx);
+int build_range_max_arena(struct range_max *rm, int n, item_value_fn value, const void *ctx,
+                          struct arena *arena);
+int build_term_range_max(struct range_max *rm, struct term *terms, int nterms);
+int range_max_query(const struct range_max *rm, int lo, int hi);
+void range_max_update(struct range_max *rm, int i);
+void free_range_max(struct range_max *rm);
+
+int top_k_ranges(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                 int k, item_id_fn id, const void *id_ctx, int *out);
+int top_k_ranges_by_id(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                       int k, item_id_fn id, const void *id_ctx, int *out);
+int top_k_scored(const struct range_max *rm, const int *lo, const int *hi, int nranges,
+                 int k, item_score_fn score, score_bound_fn bound, const void *ctx,
+                 int *out, double *scores);
+int range_iter_init(struct range_heap *it, const struct range_max *rm,
+                    const int *lo, const int *hi, int nranges);
+int range_iter_next(struct range_heap *it);
+int range_iter_save(const struct range_heap *it, char *buf, size_t cap);
+int range_iter_load(struct range_heap *it, const struct range_max *rm, const char *cursor,
+                    int lo, int hi);
+void range_iter_free(struct range_heap *it);
+void build_range_iter_cache(struct range_iter_cache **cache);
+unsigned range_iter_park(struct range_iter_cache *cache, struct range_heap *it, unsigned tag,
+                         int lo, int hi);
+int range_iter_resume(struct range_iter_cache *cache, struct range_heap *it, unsigned handle,
+                      unsigned tag, const struct range_max *rm, int lo, int hi,
+                      const char *cursor);
+void free_range_iter_cache(struct range_iter_cache *cache);
+int build_global_top(struct global_top *g, const struct range_max *rm, int k);
+void global_top_update(struct global_top *g, int i);
+void global_top_reset(struct global_top *g);
+void range_max_update_top(struct range_max *rm, struct global_top *g, int i);
+int global_top_ids(const struct global_top *g, int k, int *out);
+void free_global_top(struct global_top *g);
+int merge_top_k(const struct term *terms, const int *a, int na, const int *b, int nb,
+                int k, int *out);
+int top_k_scan_ranges(const int *lo, const int *hi, int nranges, int k,
+                      item_value_fn value, const void *ctx, int *out);
+int top_k_scan(int lo, int hi, int k, item_value_fn value, const void *ctx, int *out);
+void terms_from_ids(struct term **answer, int *n_answer, const struct term *terms,
+                    const int *ids, int n);
+
+#endif
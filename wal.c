@@ -0,0 +1,467 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "wal.h"
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void init_crc_table(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int b = 0; b < 8; b++) {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+/*
+ * wal_crc32():
+ *   - CRC-32 (IEEE) of data, continuing from crc; start with 0.
+ */
+uint32_t wal_crc32(uint32_t crc, const void *data, size_t len)
+{
+    pthread_once(&crc_once, init_crc_table);
+    const unsigned char *p = (const unsigned char *)data;
+    crc = ~crc;
+    while (len--) {
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/*
+ * wal_encode():
+ *   - Writes rec to buf (at least WAL_MAX_RECORD bytes) and returns the
+ *     number of bytes written.
+ */
+size_t wal_encode(const struct wal_record *rec, unsigned char *buf)
+{
+    size_t tlen = strlen(rec->term);
+    if (tlen > sizeof(rec->term) - 1) {
+        tlen = sizeof(rec->term) - 1;
+    }
+    uint32_t plen = (uint32_t)(1 + sizeof(double) + 1 + tlen);
+    unsigned char *p = buf + WAL_HEADER;
+    p[0] = (unsigned char)rec->op;
+    memcpy(p + 1, &rec->weight, sizeof(double));
+    p[1 + sizeof(double)] = (unsigned char)tlen;
+    memcpy(p + 2 + sizeof(double), rec->term, tlen);
+
+    memcpy(buf + 4, &plen, 4);
+    memcpy(buf + 8, &rec->lsn, 8);
+    uint32_t crc = wal_crc32(0, buf + 4, WAL_HEADER - 4 + plen);
+    memcpy(buf, &crc, 4);
+    return WAL_HEADER + plen;
+}
+
+/*
+ * wal_decode():
+ *   - Reads the record at the start of buf (len bytes available) into rec.
+ *   - Returns its size in bytes, 0 if buf ends before the record does, or
+ *     -1 if the bytes are not a valid record.
+ */
+int wal_decode(const unsigned char *buf, size_t len, struct wal_record *rec)
+{
+    if (len < WAL_HEADER) {
+        return 0;
+    }
+    uint32_t crc, plen;
+    memcpy(&crc, buf, 4);
+    memcpy(&plen, buf + 4, 4);
+    if (plen < 2 + sizeof(double) || plen > WAL_MAX_RECORD - WAL_HEADER) {
+        return -1;
+    }
+    if (len < WAL_HEADER + plen) {
+        return 0;
+    }
+    const unsigned char *p = buf + WAL_HEADER;
+    size_t tlen = p[1 + sizeof(double)];
+    if (wal_crc32(0, buf + 4, WAL_HEADER - 4 + plen) != crc
+        || 2 + sizeof(double) + tlen != plen) {
+        return -1;
+    }
+    memcpy(&rec->lsn, buf + 8, 8);
+    rec->op = p[0];
+    memcpy(&rec->weight, p + 1, sizeof(double));
+    memcpy(rec->term, p + 2 + sizeof(double), tlen);
+    rec->term[tlen] = '\0';
+    return (int)(WAL_HEADER + plen);
+}
+
+/*
+ * wal_replay():
+ *   - Calls apply(ctx, rec) for every record of the log at path with an
+ *     lsn above after, in order, and sets *last_lsn to the lsn of the last
+ *     valid record (after if there is none).
+ *   - Returns the number of records applied, or -1 if the log could not
+ *     be read or apply failed.
+ *
+ * Edge cases addressed:
+ *   - A missing log is an empty one.
+ *   - Replay stops at the first torn or corrupt record (a crash during an
+ *     append), and the log is truncated there so new records follow the
+ *     last valid one.
+ */
+long wal_replay(const char *path, uint64_t after, wal_apply_fn apply, void *ctx,
+                uint64_t *last_lsn)
+{
+    *last_lsn = after;
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        fprintf(stderr, "Error: Could not open log %s.\n", path);
+        return -1;
+    }
+
+    unsigned char *buf = malloc(1 << 16);
+    if (!buf) {
+        fprintf(stderr, "Error: Could not allocate memory for log replay.\n");
+        close(fd);
+        return -1;
+    }
+    size_t have = 0;
+    off_t valid_end = 0;
+    long applied = 0;
+    int done = 0, failed = 0;
+    while (!done) {
+        ssize_t got = read(fd, buf + have, (1 << 16) - have);
+        if (got < 0) {
+            failed = 1;
+            break;
+        }
+        have += (size_t)got;
+        size_t pos = 0;
+        for (;;) {
+            struct wal_record rec;
+            int used = wal_decode(buf + pos, have - pos, &rec);
+            if (used == 0 && got > 0) {
+                break;   // read more
+            }
+            if (used <= 0) {
+                done = 1;   // end of log, or a torn record
+                break;
+            }
+            pos += (size_t)used;
+            valid_end += used;
+            if (rec.lsn > *last_lsn) {
+                *last_lsn = rec.lsn;
+            }
+            if (rec.lsn > after) {
+                applied++;
+                if (apply(ctx, &rec) != 0) {
+                    failed = done = 1;
+                    break;
+                }
+            }
+        }
+        memmove(buf, buf + pos, have - pos);
+        have -= pos;
+    }
+    free(buf);
+
+    if (!failed && lseek(fd, 0, SEEK_END) > valid_end) {
+        failed = ftruncate(fd, valid_end) != 0 || fsync(fd) != 0;
+    }
+    close(fd);
+    if (failed) {
+        fprintf(stderr, "Error: Could not read log %s.\n", path);
+        return -1;
+    }
+    return applied;
+}
+
+/*
+ * open_wal():
+ *   - Opens (creating if needed) the log at path for appending; the first
+ *     new record gets next_lsn. Replay the log before opening it.
+ *
+ * Edge cases addressed:
+ *   - On failure prints an error and sets *w = NULL.
+ */
+void open_wal(struct wal **w, const char *path, uint64_t next_lsn)
+{
+    *w = NULL;
+    struct wal *l = calloc(1, sizeof(struct wal));
+    if (!l) {
+        fprintf(stderr, "Error: Could not allocate memory for log.\n");
+        return;
+    }
+    l->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    l->path = strdup(path);
+    if (l->fd < 0 || !l->path) {
+        fprintf(stderr, "Error: Could not open log %s.\n", path);
+        if (l->fd >= 0) {
+            close(l->fd);
+        }
+        free(l->path);
+        free(l);
+        return;
+    }
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->flushed, NULL);
+    l->next_lsn = next_lsn > 0 ? next_lsn : 1;
+    l->durable_lsn = l->next_lsn - 1;
+    *w = l;
+}
+
+/*
+ * wal_append():
+ *   - Buffers one record and returns its lsn, or 0 on failure. The record
+ *     is not durable until wal_sync() for that lsn returns.
+ */
+uint64_t wal_append(struct wal *w, int op, const char *term, double weight)
+{
+    struct wal_record rec;
+    rec.op = op;
+    rec.weight = weight;
+    strncpy(rec.term, term, sizeof(rec.term) - 1);
+    rec.term[sizeof(rec.term) - 1] = '\0';
+
+    pthread_mutex_lock(&w->lock);
+    if (w->failed) {
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+    if (w->len + WAL_MAX_RECORD > w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 4096;
+        unsigned char *buf = realloc(w->buf, cap);
+        if (!buf) {
+            pthread_mutex_unlock(&w->lock);
+            fprintf(stderr, "Error: Could not allocate memory for log.\n");
+            return 0;
+        }
+        w->buf = buf;
+        w->cap = cap;
+    }
+    rec.lsn = w->next_lsn++;
+    w->len += wal_encode(&rec, w->buf + w->len);
+    pthread_mutex_unlock(&w->lock);
+    return rec.lsn;
+}
+
+/*
+ * wal_sync():
+ *   - Returns once every record up to lsn is on disk: 0, or -1 if the
+ *     log failed.
+ *
+ * Approach:
+ *   - Group commit: if no flush is running, this thread takes everything
+ *     buffered so far (its own record and those of any other updater),
+ *     writes it and calls fdatasync() once; otherwise it waits for the
+ *     running flush and checks again.
+ */
+int wal_sync(struct wal *w, uint64_t lsn)
+{
+    pthread_mutex_lock(&w->lock);
+    if (lsn >= w->next_lsn) {
+        lsn = w->next_lsn - 1;   // nothing beyond the last append to wait for
+    }
+    while (w->durable_lsn < lsn && !w->failed) {
+        if (w->flushing) {
+            pthread_cond_wait(&w->flushed, &w->lock);
+            continue;
+        }
+        // Swap buffers so appends continue while this batch is written
+        unsigned char *batch = w->buf;
+        size_t batch_len = w->len, batch_cap = w->cap;
+        uint64_t upto = w->next_lsn - 1;
+        w->buf = w->spare;
+        w->cap = w->spare_cap;
+        w->len = 0;
+        w->flushing = 1;
+        pthread_mutex_unlock(&w->lock);
+
+        int ok = 1;
+        for (size_t off = 0; off < batch_len && ok;) {
+            ssize_t n = write(w->fd, batch + off, batch_len - off);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = n > 0;
+            off += ok ? (size_t)n : 0;
+        }
+        ok = ok && fdatasync(w->fd) == 0;
+
+        pthread_mutex_lock(&w->lock);
+        w->spare = batch;
+        w->spare_cap = batch_cap;
+        w->syncs++;
+        if (ok) {
+            if (upto > w->durable_lsn) {
+                w->durable_lsn = upto;
+            }
+        } else {
+            fprintf(stderr, "Error: Could not write log.\n");
+            w->failed = 1;
+        }
+        w->flushing = 0;
+        pthread_cond_broadcast(&w->flushed);
+    }
+    int result = w->durable_lsn >= lsn ? 0 : -1;
+    pthread_mutex_unlock(&w->lock);
+    return result;
+}
+
+// fsync() of the directory holding path, so a rename in it is durable.
+static int sync_parent_dir(const char *path)
+{
+    char dir[1024];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else if ((size_t)(slash - path) < sizeof(dir)) {
+        memcpy(dir, path, slash - path);
+        dir[slash - path] = '\0';
+    } else {
+        return -1;
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+/*
+ * Replaces the log file by one holding only its records above lsn: they
+ * are copied to path.tmp, which is synced and renamed over the log, so a
+ * crash leaves either file. Called under w->lock with no flush running.
+ */
+static int keep_records_after(struct wal *w, uint64_t lsn)
+{
+    off_t size = lseek(w->fd, 0, SEEK_END);
+    unsigned char *data = size > 0 ? malloc(size) : NULL;
+    int rfd = open(w->path, O_RDONLY);
+    int ok = data && rfd >= 0 && pread(rfd, data, size, 0) == size;
+    if (rfd >= 0) {
+        close(rfd);
+    }
+    size_t keep = 0;
+    struct wal_record rec;
+    int used;
+    while (ok && keep < (size_t)size
+           && (used = wal_decode(data + keep, size - keep, &rec)) > 0 && rec.lsn <= lsn) {
+        keep += (size_t)used;
+    }
+
+    size_t plen = strlen(w->path);
+    char *tmp = ok ? malloc(plen + 5) : NULL;
+    int fd = -1;
+    if (tmp) {
+        memcpy(tmp, w->path, plen);
+        strcpy(tmp + plen, ".tmp");
+        fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    }
+    ok = fd >= 0;
+    for (size_t off = keep; off < (size_t)size && ok;) {
+        ssize_t n = write(fd, data + off, size - off);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = n > 0;
+        off += ok ? (size_t)n : 0;
+    }
+    ok = ok && fsync(fd) == 0 && rename(tmp, w->path) == 0 && sync_parent_dir(w->path) == 0;
+    if (ok) {
+        close(w->fd);
+        w->fd = fd;
+    } else if (fd >= 0) {
+        close(fd);
+        unlink(tmp);
+    }
+    free(tmp);
+    free(data);
+    return ok ? 0 : -1;
+}
+
+/*
+ * wal_reset():
+ *   - Drops the records up to lsn once a checkpoint holds them, buffered
+ *     ones too (their waiters return as durable). Records above lsn,
+ *     logged while the checkpoint was written, are kept.
+ *   - Returns 0, or -1 if the log could not be truncated.
+ */
+int wal_reset(struct wal *w, uint64_t lsn)
+{
+    pthread_mutex_lock(&w->lock);
+    while (w->flushing) {
+        pthread_cond_wait(&w->flushed, &w->lock);
+    }
+    size_t skip = 0;
+    struct wal_record rec;
+    int used;
+    while (skip < w->len && (used = wal_decode(w->buf + skip, w->len - skip, &rec)) > 0
+           && rec.lsn <= lsn) {
+        skip += (size_t)used;
+    }
+    if (skip > 0) {
+        memmove(w->buf, w->buf + skip, w->len - skip);
+        w->len -= skip;
+    }
+    int ok = w->durable_lsn <= lsn
+           ? ftruncate(w->fd, 0) == 0 && fsync(w->fd) == 0
+           : keep_records_after(w, lsn) == 0;
+    if (ok) {
+        if (lsn + 1 > w->next_lsn) {
+            w->next_lsn = lsn + 1;
+        }
+        if (lsn > w->durable_lsn) {
+            w->durable_lsn = lsn;
+        }
+    } else {
+        fprintf(stderr, "Error: Could not truncate log.\n");
+        w->failed = 1;
+    }
+    pthread_cond_broadcast(&w->flushed);
+    pthread_mutex_unlock(&w->lock);
+    return ok ? 0 : -1;
+}
+
+/*
+ * wal_fail():
+ *   - Marks the log unusable, e.g. because a logged record could not be
+ *     applied: later appends and syncs fail, so no lsn past that record
+ *     is ever handed out. Waiters in wal_sync() return -1.
+ */
+void wal_fail(struct wal *w)
+{
+    pthread_mutex_lock(&w->lock);
+    w->failed = 1;
+    pthread_cond_broadcast(&w->flushed);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*
+ * close_wal():
+ *   - Flushes buffered records and closes the log.
+ */
+void close_wal(struct wal *w)
+{
+    if (!w) {
+        return;
+    }
+    pthread_mutex_lock(&w->lock);
+    uint64_t last = w->next_lsn - 1;
+    pthread_mutex_unlock(&w->lock);
+    wal_sync(w, last);
+    close(w->fd);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->flushed);
+    free(w->buf);
+    free(w->spare);
+    free(w->path);
+    free(w);
+}
@@ -0,0 +1,70 @@
+#if !defined(WAL_H)
+#define WAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Record operations.
+#define WAL_SET_WEIGHT 1   // set the weight of a term, adding it if new
+
+// Bytes before the payload: crc, payload length, lsn.
+#define WAL_HEADER 16
+// Largest encoded record: header, op, weight, length byte and a 199-byte term.
+#define WAL_MAX_RECORD (WAL_HEADER + 1 + 8 + 1 + 199)
+
+/*
+ * One logged update. LSNs (log sequence numbers) start at 1 and grow by
+ * one per record.
+ */
+typedef struct wal_record{
+    uint64_t lsn;
+    int op;
+    double weight;
+    char term[200];
+} wal_record;
+
+/*
+ * Append-only update log with group commit. Records are encoded as
+ *   crc32 (4), payload length (4), lsn (8), op (1), weight (8),
+ *   term length (1), term
+ * in native byte order, the crc covering everything after it, so a torn
+ * write at the tail is detected and dropped on replay.
+ *
+ * wal_append() only buffers a record; wal_sync() makes it durable. The
+ * first thread to sync writes and fdatasync()s every buffered record while
+ * the others wait for it, so concurrent updaters share one disk flush.
+ */
+typedef struct wal{
+    int fd;
+    char *path;                  // for rewriting the log in wal_reset()
+    pthread_mutex_t lock;
+    pthread_cond_t flushed;
+    unsigned char *buf, *spare;  // records not yet written, and the flusher's buffer
+    size_t len, cap, spare_cap;
+    uint64_t next_lsn;           // lsn the next record gets
+    uint64_t durable_lsn;        // every record up to this one is on disk
+    int flushing;                // a thread is writing spare
+    int failed;                  // a write or sync failed; the log is unusable
+    long syncs;                  // fdatasync() calls, for group-commit stats
+} wal;
+
+/*
+ * Called by wal_replay() for each valid record, in log order. A nonzero
+ * return stops the replay and makes it fail.
+ */
+typedef int (*wal_apply_fn)(void *ctx, const struct wal_record *rec);
+
+uint32_t wal_crc32(uint32_t crc, const void *data, size_t len);
+size_t wal_encode(const struct wal_record *rec, unsigned char *buf);
+int wal_decode(const unsigned char *buf, size_t len, struct wal_record *rec);
+long wal_replay(const char *path, uint64_t after, wal_apply_fn apply, void *ctx,
+                uint64_t *last_lsn);
+void open_wal(struct wal **w, const char *path, uint64_t next_lsn);
+uint64_t wal_append(struct wal *w, int op, const char *term, double weight);
+int wal_sync(struct wal *w, uint64_t lsn);
+int wal_reset(struct wal *w, uint64_t lsn);
+void wal_fail(struct wal *w);
+void close_wal(struct wal *w);
+
+#endif